@@ -0,0 +1,543 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AI/AIPathSubsystem.h"
+#include "NavigationSystem.h"
+#include "NavMesh/NavMeshPath.h"
+#include "NavMesh/RecastNavMesh.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Metrics/WB2023Metrics.h"
+#include "WB2023/WB2023.h"
+
+namespace AIPath_Impl
+{
+	static FAutoConsoleCommandWithWorld StatsCommand(
+		TEXT("WB2023.AIPath.Stats"),
+		TEXT("Logs path requests, navmesh queries and shared paths handed out by the AI path subsystem"),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			if (UAIPathSubsystem* PathSubsystem = World ? World->GetSubsystem<UAIPathSubsystem>() : nullptr)
+			{
+				PathSubsystem->LogStats();
+			}
+		}));
+
+	static FAutoConsoleCommandWithWorld BenchmarkCommand(
+		TEXT("WB2023.AIPath.Benchmark"),
+		TEXT("Requests a path to the player for every other pawn at once and logs how many navmesh queries it took"),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			if (UAIPathSubsystem* PathSubsystem = World ? World->GetSubsystem<UAIPathSubsystem>() : nullptr)
+			{
+				PathSubsystem->StartBenchmark();
+			}
+		}));
+}
+
+void UAIPathSubsystem::Tick(float DeltaTime)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UAIPathSubsystem::Tick);
+	SCOPE_CYCLE_COUNTER(STAT_WB2023_PathRequests);
+
+	Super::Tick(DeltaTime);
+
+	const float Now = GetWorld()->GetTimeSeconds();
+	for (auto It = CachedPaths.CreateIterator(); It; ++It)
+	{
+		// Navmesh rebuilds invalidate paths
+		if (Now - It.Value().Time > CacheLifetime || !It.Value().Path->IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	// FindPathSync's queries since the last tick use up this frame's budget too
+	if (Queue.Num() == 0)
+	{
+		NumQueriesThisFrame = 0;
+		return;
+	}
+
+	// Delivering a path can queue new requests, they go after everything queued before this frame
+	TArray<FPathRequest> Processing = MoveTemp(Queue);
+	Queue.Reset();
+
+	TArray<FPathRequest> Deferred;
+	const double EndTime = FPlatformTime::Seconds() + FrameBudgetMs / 1000.0;
+
+	int32 Index = 0;
+	for (; Index < Processing.Num(); ++Index)
+	{
+		if (Index > 0 && FPlatformTime::Seconds() >= EndTime)
+		{
+			break;
+		}
+
+		if (!ProcessRequest(Processing[Index]))
+		{
+			Deferred.Add(MoveTemp(Processing[Index]));
+		}
+	}
+
+	for (; Index < Processing.Num(); ++Index)
+	{
+		Deferred.Add(MoveTemp(Processing[Index]));
+	}
+	Deferred.Append(MoveTemp(Queue));
+	Queue = MoveTemp(Deferred);
+
+	NumQueriesThisFrame = 0;
+}
+
+TStatId UAIPathSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UAIPathSubsystem, STATGROUP_Tickables);
+}
+
+void UAIPathSubsystem::Deinitialize()
+{
+	// The navigation system drops our delegates along with the world
+	Queue.Reset();
+	PendingQueries.Reset();
+	PendingQueryByKey.Reset();
+	CachedPaths.Reset();
+
+	Super::Deinitialize();
+}
+
+uint32 UAIPathSubsystem::RequestPath(const APawn* Querier, const FVector& GoalLocation, FAIPathReadyDelegate OnPathReady)
+{
+	if (!Querier)
+	{
+		return 0;
+	}
+
+	FPathRequest& Request = Queue.AddDefaulted_GetRef();
+	Request.RequestId = NextRequestId++;
+	Request.Querier = Querier;
+	Request.GoalLocation = GoalLocation;
+	Request.Key.GoalCell = GetCell(GoalLocation, GoalCellSize);
+	Request.Key.StartCell = GetCell(Querier->GetNavAgentLocation(), StartCellSize);
+	Request.OnPathReady = MoveTemp(OnPathReady);
+
+	++NumRequests;
+	return Request.RequestId;
+}
+
+void UAIPathSubsystem::CancelRequest(uint32 RequestId)
+{
+	if (RequestId == 0)
+	{
+		return;
+	}
+
+	auto MatchesRequest = [RequestId](const FPathRequest& Request) { return Request.RequestId == RequestId; };
+	if (Queue.RemoveAll(MatchesRequest) > 0)
+	{
+		return;
+	}
+
+	for (TPair<uint32, FPendingQuery>& Pair : PendingQueries)
+	{
+		FPendingQuery& PendingQuery = Pair.Value;
+		if (PendingQuery.Request.RequestId == RequestId)
+		{
+			// The query still runs for the requests waiting on it
+			PendingQuery.Request.OnPathReady.Unbind();
+			return;
+		}
+
+		if (PendingQuery.Waiting.RemoveAll(MatchesRequest) > 0)
+		{
+			return;
+		}
+	}
+}
+
+FNavPathSharedPtr UAIPathSubsystem::FindPathSync(const APawn& Querier, const FPathFindingQuery& Query)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UAIPathSubsystem::FindPathSync);
+	SCOPE_CYCLE_COUNTER(STAT_WB2023_PathRequests);
+
+	++NumRequests;
+	++NumSyncRequests;
+
+	FPathKey Key;
+	Key.GoalCell = GetCell(Query.EndLocation, GoalCellSize);
+	Key.StartCell = GetCell(Querier.GetNavAgentLocation(), StartCellSize);
+
+	// Cached paths come from queries with the navmesh's default filter, only those are interchangeable
+	const ANavigationData* NavData = Query.NavData.Get();
+	const bool bShareable = NavData && Query.QueryFilter == NavData->GetDefaultQueryFilter();
+	if (bShareable)
+	{
+		if (const FCachedPath* CachedPath = CachedPaths.Find(Key))
+		{
+			bool bRaycastJoin = false;
+			FNavPathSharedPtr Path = JoinPath(*CachedPath->Path, Querier, bRaycastJoin);
+			if (Path.IsValid())
+			{
+				++NumSharedPaths;
+				NumRaycastJoins += bRaycastJoin ? 1 : 0;
+				WB2023Metrics::PathsShared.Add();
+				return Path;
+			}
+		}
+	}
+
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (!NavSys)
+	{
+		return nullptr;
+	}
+
+	const FPathFindingResult Result = NavSys->FindPathSync(Query);
+
+	++NumQueriesThisFrame;
+	++NumQueries;
+	WB2023Metrics::PathQueries.Add();
+
+	if (!Result.IsSuccessful() || !Result.Path.IsValid())
+	{
+		++NumFailed;
+		return nullptr;
+	}
+
+	// The querier follows its own copy, the mover's repaths would change the cached one
+	bool bRaycastJoin = false;
+	FNavPathSharedPtr QuerierPath = JoinPath(*Result.Path, Querier, bRaycastJoin);
+	if (!bShareable || !QuerierPath.IsValid())
+	{
+		return Result.Path;
+	}
+
+	if (!CachedPaths.Contains(Key))
+	{
+		FCachedPath& CachedPath = CachedPaths.Add(Key);
+		CachedPath.Path = Result.Path;
+		CachedPath.Time = GetWorld()->GetTimeSeconds();
+	}
+	return QuerierPath;
+}
+
+void UAIPathSubsystem::LogStats() const
+{
+	UE_LOG(LogWB2023, Display, TEXT("AIPath: Requests=%d (%d sync) Queries=%d (%.2f per request) SharedPaths=%d RaycastJoins=%d Failed=%d Queued=%d InFlight=%d Cached=%d"),
+		NumRequests, NumSyncRequests, NumQueries, NumRequests > 0 ? static_cast<float>(NumQueries) / NumRequests : 0.0f, NumSharedPaths, NumRaycastJoins, NumFailed,
+		Queue.Num(), PendingQueries.Num(), CachedPaths.Num());
+}
+
+void UAIPathSubsystem::StartBenchmark()
+{
+	if (BenchmarkRequestsLeft > 0)
+	{
+		UE_LOG(LogWB2023, Warning, TEXT("AIPath benchmark: %d requests of the last run are still in flight"), BenchmarkRequestsLeft);
+		return;
+	}
+
+	const APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	const APawn* PlayerPawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+	if (!PlayerPawn)
+	{
+		UE_LOG(LogWB2023, Warning, TEXT("AIPath benchmark: needs a player pawn to path to"));
+		return;
+	}
+
+	// Cold start, every group has to run its query
+	CachedPaths.Reset();
+
+	BenchmarkNumAgents = 0;
+	BenchmarkNumFailed = 0;
+	BenchmarkStartQueries = NumQueries;
+	BenchmarkStartShared = NumSharedPaths;
+	BenchmarkStartRaycastJoins = NumRaycastJoins;
+	BenchmarkStartTime = FPlatformTime::Seconds();
+
+	for (TActorIterator<APawn> It(GetWorld()); It; ++It)
+	{
+		if (*It != PlayerPawn && !It->IsPlayerControlled())
+		{
+			++BenchmarkNumAgents;
+			RequestPath(*It, PlayerPawn->GetActorLocation(), FAIPathReadyDelegate::CreateUObject(this, &UAIPathSubsystem::OnBenchmarkPathReady));
+		}
+	}
+
+	BenchmarkRequestsLeft = BenchmarkNumAgents;
+	UE_LOG(LogWB2023, Display, TEXT("AIPath benchmark: requested paths for %d agents"), BenchmarkNumAgents);
+}
+
+void UAIPathSubsystem::OnBenchmarkPathReady(FNavPathSharedPtr Path)
+{
+	BenchmarkNumFailed += Path.IsValid() ? 0 : 1;
+	if (--BenchmarkRequestsLeft > 0)
+	{
+		return;
+	}
+
+	const int32 Queries = NumQueries - BenchmarkStartQueries;
+	UE_LOG(LogWB2023, Display, TEXT("AIPath benchmark: %d agents took %d navmesh queries (%.2f per agent), %d shared paths of which %d raycast joins, %d failed, %.1fms"),
+		BenchmarkNumAgents, Queries, BenchmarkNumAgents > 0 ? static_cast<float>(Queries) / BenchmarkNumAgents : 0.0f,
+		NumSharedPaths - BenchmarkStartShared, NumRaycastJoins - BenchmarkStartRaycastJoins, BenchmarkNumFailed,
+		(FPlatformTime::Seconds() - BenchmarkStartTime) * 1000.0);
+}
+
+bool UAIPathSubsystem::ProcessRequest(FPathRequest& Request)
+{
+	const APawn* Querier = Request.Querier.Get();
+	if (!Querier)
+	{
+		return true;
+	}
+
+	if (!Request.bNeedsOwnQuery)
+	{
+		if (const FCachedPath* CachedPath = CachedPaths.Find(Request.Key))
+		{
+			if (DeliverSharedPath(Request, *CachedPath->Path))
+			{
+				return true;
+			}
+
+			Request.bNeedsOwnQuery = true;
+		}
+		else if (const uint32* QueryId = PendingQueryByKey.Find(Request.Key))
+		{
+			PendingQueries[*QueryId].Waiting.Add(MoveTemp(Request));
+			return true;
+		}
+	}
+
+	if (NumQueriesThisFrame >= MaxQueriesPerFrame)
+	{
+		return false;
+	}
+
+	if (!StartQuery(Request))
+	{
+		DeliverPath(Request, nullptr);
+	}
+	return true;
+}
+
+bool UAIPathSubsystem::StartQuery(FPathRequest& Request)
+{
+	const APawn* Querier = Request.Querier.Get();
+	UNavigationSystemV1* NavSys = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (!Querier || !NavSys)
+	{
+		return false;
+	}
+
+	const FNavAgentProperties& AgentProperties = Querier->GetNavAgentPropertiesRef();
+	const FVector Start = Querier->GetNavAgentLocation();
+	const ANavigationData* NavData = NavSys->GetNavDataForProps(AgentProperties, Start);
+	if (!NavData)
+	{
+		return false;
+	}
+
+	FPathFindingQuery Query(Querier, *NavData, Start, Request.GoalLocation);
+	const uint32 QueryId = NavSys->FindPathAsync(AgentProperties, Query,
+		FNavPathQueryDelegate::CreateUObject(this, &UAIPathSubsystem::OnQueryFinished), EPathFindingMode::Regular);
+	if (QueryId == INVALID_NAVQUERYID)
+	{
+		return false;
+	}
+
+	++NumQueriesThisFrame;
+	++NumQueries;
+	WB2023Metrics::PathQueries.Add();
+
+	FPendingQuery& PendingQuery = PendingQueries.Add(QueryId);
+	PendingQuery.bShared = !Request.bNeedsOwnQuery && !PendingQueryByKey.Contains(Request.Key);
+	if (PendingQuery.bShared)
+	{
+		PendingQueryByKey.Add(Request.Key, QueryId);
+	}
+	PendingQuery.Request = MoveTemp(Request);
+	return true;
+}
+
+void UAIPathSubsystem::OnQueryFinished(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path)
+{
+	FPendingQuery PendingQuery;
+	if (!PendingQueries.RemoveAndCopyValue(QueryId, PendingQuery))
+	{
+		return;
+	}
+
+	const bool bSucceeded = Result == ENavigationQueryResult::Success && Path.IsValid() && Path->IsValid();
+	if (PendingQuery.bShared)
+	{
+		PendingQueryByKey.Remove(PendingQuery.Request.Key);
+		if (bSucceeded)
+		{
+			FCachedPath& CachedPath = CachedPaths.Add(PendingQuery.Request.Key);
+			CachedPath.Path = Path;
+			CachedPath.Time = GetWorld()->GetTimeSeconds();
+		}
+	}
+
+	// The querier follows its own copy so the cached path stays untouched
+	const APawn* Querier = PendingQuery.Request.Querier.Get();
+	bool bRaycastJoin = false;
+	FNavPathSharedPtr QuerierPath = bSucceeded && Querier ? JoinPath(*Path, *Querier, bRaycastJoin) : nullptr;
+	DeliverPath(PendingQuery.Request, QuerierPath.IsValid() ? QuerierPath : (bSucceeded ? Path : nullptr));
+	if (!bSucceeded)
+	{
+		++NumFailed;
+	}
+
+	for (FPathRequest& Request : PendingQuery.Waiting)
+	{
+		if (bSucceeded && DeliverSharedPath(Request, *Path))
+		{
+			continue;
+		}
+
+		if (Request.Querier.IsValid())
+		{
+			// Failed for the querier that ran it, or doesn't pass by this one
+			Request.bNeedsOwnQuery = true;
+			Queue.Add(MoveTemp(Request));
+		}
+	}
+}
+
+bool UAIPathSubsystem::DeliverSharedPath(FPathRequest& Request, const FNavigationPath& SharedPath)
+{
+	const APawn* Querier = Request.Querier.Get();
+	bool bRaycastJoin = false;
+	FNavPathSharedPtr Path = Querier ? JoinPath(SharedPath, *Querier, bRaycastJoin) : nullptr;
+	if (!Path.IsValid())
+	{
+		return false;
+	}
+
+	DeliverPath(Request, Path);
+	++NumSharedPaths;
+	NumRaycastJoins += bRaycastJoin ? 1 : 0;
+	WB2023Metrics::PathsShared.Add();
+	return true;
+}
+
+FNavPathSharedPtr UAIPathSubsystem::JoinPath(const FNavigationPath& SharedPath, const APawn& Querier, bool& bOutRaycastJoin) const
+{
+	bOutRaycastJoin = false;
+
+	const FNavMeshPath* SharedMeshPath = SharedPath.CastPath<FNavMeshPath>();
+	const ANavigationData* NavData = SharedPath.GetNavigationDataUsed();
+	if (!SharedMeshPath || !NavData || !SharedPath.IsValid())
+	{
+		return nullptr;
+	}
+
+	FNavLocation StartLocation;
+	if (!NavData->ProjectPoint(Querier.GetNavAgentLocation(), StartLocation, NavData->GetConfig().DefaultQueryExtent))
+	{
+		return nullptr;
+	}
+
+	const TArray<NavNodeRef>& Corridor = SharedMeshPath->PathCorridor;
+	const TArray<FNavPathPoint>& SharedPoints = SharedPath.GetPathPoints();
+	const bool bHasCorridorCost = SharedMeshPath->PathCorridorCost.Num() == Corridor.Num();
+
+	TSharedRef<FNavMeshPath> Path = MakeShared<FNavMeshPath>();
+	TArray<FNavPathPoint>& Points = Path->GetPathPoints();
+	Points.Add(FNavPathPoint(StartLocation.Location, StartLocation.NodeRef));
+
+	// On the corridor the part ahead of the querier is still a connected corridor
+	int32 CorridorIndex = Corridor.Find(StartLocation.NodeRef);
+	int32 JoinPointIndex = INDEX_NONE;
+	if (CorridorIndex == INDEX_NONE)
+	{
+#if WITH_RECAST
+		// Off it, a straight unobstructed move to the nearest path point in reach leads onto it
+		float JoinDistanceSquared = FMath::Square(MaxJoinDistance);
+		for (int32 PointIndex = 0; PointIndex < SharedPoints.Num(); ++PointIndex)
+		{
+			const float DistanceSquared = FVector::DistSquared(SharedPoints[PointIndex].Location, StartLocation.Location);
+			if (DistanceSquared <= JoinDistanceSquared)
+			{
+				JoinDistanceSquared = DistanceSquared;
+				JoinPointIndex = PointIndex;
+			}
+		}
+
+		const ARecastNavMesh* NavMesh = Cast<const ARecastNavMesh>(NavData);
+		if (JoinPointIndex == INDEX_NONE || !NavMesh)
+		{
+			return nullptr;
+		}
+
+		ARecastNavMesh::FRaycastResult RaycastResult;
+		FVector HitLocation;
+		if (ARecastNavMesh::NavMeshRaycast(NavMesh, StartLocation.NodeRef, StartLocation.Location, SharedPoints[JoinPointIndex].Location,
+			HitLocation, SharedPath.GetFilter(), &Querier, RaycastResult) || RaycastResult.CorridorPolysCount == 0)
+		{
+			return nullptr;
+		}
+
+		// The raycast's last poly is where it meets the corridor
+		CorridorIndex = Corridor.Find(RaycastResult.GetLastNodeRef());
+		if (CorridorIndex == INDEX_NONE)
+		{
+			return nullptr;
+		}
+
+		for (int32 PolyIndex = 0; PolyIndex < RaycastResult.CorridorPolysCount - 1; ++PolyIndex)
+		{
+			Path->PathCorridor.Add(RaycastResult.CorridorPolys[PolyIndex]);
+			if (bHasCorridorCost)
+			{
+				Path->PathCorridorCost.Add(RaycastResult.CorridorCost[PolyIndex]);
+			}
+		}
+
+		Points.Add(SharedPoints[JoinPointIndex]);
+		bOutRaycastJoin = true;
+#else
+		return nullptr;
+#endif
+	}
+
+	const int32 NumCorridorPolys = Corridor.Num() - CorridorIndex;
+	Path->PathCorridor.Append(Corridor.GetData() + CorridorIndex, NumCorridorPolys);
+	if (bHasCorridorCost)
+	{
+		Path->PathCorridorCost.Append(SharedMeshPath->PathCorridorCost.GetData() + CorridorIndex, NumCorridorPolys);
+	}
+
+	for (int32 PointIndex = FMath::Max(JoinPointIndex + 1, 1); PointIndex < SharedPoints.Num(); ++PointIndex)
+	{
+		// Points on polys up to the querier's (or the join point's) are behind it
+		const bool bLastPoint = PointIndex == SharedPoints.Num() - 1;
+		if (bLastPoint || Corridor.Find(SharedPoints[PointIndex].NodeRef) > CorridorIndex)
+		{
+			Points.Add(SharedPoints[PointIndex]);
+		}
+	}
+
+	Path->SetNavigationDataUsed(NavData);
+	Path->SetQuerier(&Querier);
+	Path->SetFilter(SharedPath.GetFilter());
+	Path->SetIsPartial(SharedPath.IsPartial());
+	Path->SetTimeStamp(SharedPath.GetTimeStamp());
+	Path->MarkReady();
+	return Path;
+}
+
+void UAIPathSubsystem::DeliverPath(FPathRequest& Request, FNavPathSharedPtr Path)
+{
+	Request.OnPathReady.ExecuteIfBound(Path);
+}
+
+FIntVector UAIPathSubsystem::GetCell(const FVector& Location, float CellSize)
+{
+	CellSize = FMath::Max(CellSize, 1.0f);
+	return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+}
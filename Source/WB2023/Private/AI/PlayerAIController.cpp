@@ -2,9 +2,176 @@
 
 
 #include "AI/PlayerAIController.h"
+#include "AI/AIPathSubsystem.h"
+#include "Character/CharBase.h"
+#include "Character/CharacterSpatialHashSubsystem.h"
+#include "Navigation/CrowdFollowingComponent.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "Engine/World.h"
 
-APlayerAIController::APlayerAIController()
+APlayerAIController::APlayerAIController(const FObjectInitializer& ObjectInitializer) :
+    Super(ObjectInitializer.SetDefaultSubobjectClass<UCrowdFollowingComponent>(TEXT("PathFollowingComponent")))
 {
     // If a new AI instance is created, it will have its own player state
     bWantsPlayerState = true;
 }
+
+void APlayerAIController::Tick(float DeltaSeconds)
+{
+    Super::Tick(DeltaSeconds);
+
+    const AActor* Goal = GoalActor.Get();
+    const APawn* ControlledPawn = GetPawn();
+    if (!Goal || !ControlledPawn || PathRequestId != 0 || GetWorld()->GetTimeSeconds() - LastPathRequestTime < RepathInterval)
+    {
+        return;
+    }
+
+    // Repath when the goal got away from the path, or the last move ended before reaching it
+    const FVector GoalLocation = Goal->GetActorLocation();
+    const bool bGoalMoved = FVector::DistSquared(GoalLocation, PathGoalLocation) > FMath::Square(RepathDistance);
+    const bool bStoppedShort = GetMoveStatus() == EPathFollowingStatus::Idle
+        && FVector::Dist(ControlledPawn->GetActorLocation(), GoalLocation) > GoalAcceptanceRadius;
+    if (bGoalMoved || bStoppedShort)
+    {
+        RequestGoalPath();
+    }
+}
+
+bool APlayerAIController::MoveToActorAsync(AActor* Goal, float AcceptanceRadius)
+{
+    if (!Goal || !GetPawn())
+    {
+        return false;
+    }
+
+    GoalActor = Goal;
+    GoalAcceptanceRadius = AcceptanceRadius;
+    RequestGoalPath();
+    return true;
+}
+
+bool APlayerAIController::MoveToNearestPlayer(float AcceptanceRadius)
+{
+    const APawn* ControlledPawn = GetPawn();
+    if (!ControlledPawn)
+    {
+        return false;
+    }
+
+    // Alive enemy from the spatial hash, for characters it knows about
+    const UCharacterSpatialHashSubsystem* SpatialHash = GetWorld()->GetSubsystem<UCharacterSpatialHashSubsystem>();
+    const ACharBase* ControlledCharacter = Cast<ACharBase>(ControlledPawn);
+    if (SpatialHash && ControlledCharacter && ControlledCharacter->SpatialHashIndex != INDEX_NONE)
+    {
+        return MoveToActorAsync(SpatialHash->FindNearestEnemy(ControlledCharacter, NearestPlayerSearchRadius), AcceptanceRadius);
+    }
+
+    APawn* NearestPawn = nullptr;
+    float NearestDistanceSquared = TNumericLimits<float>::Max();
+    for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+    {
+        APawn* PlayerPawn = It->Get() ? It->Get()->GetPawn() : nullptr;
+        if (!PlayerPawn)
+        {
+            continue;
+        }
+
+        const float DistanceSquared = FVector::DistSquared(PlayerPawn->GetActorLocation(), ControlledPawn->GetActorLocation());
+        if (DistanceSquared < NearestDistanceSquared)
+        {
+            NearestDistanceSquared = DistanceSquared;
+            NearestPawn = PlayerPawn;
+        }
+    }
+
+    return MoveToActorAsync(NearestPawn, AcceptanceRadius);
+}
+
+void APlayerAIController::StopAsyncMove()
+{
+    CancelPathRequest();
+    GoalActor.Reset();
+    StopMovement();
+}
+
+void APlayerAIController::OnUnPossess()
+{
+    // Pooled characters are unpossessed on release, don't let a late path move the next pawn
+    CancelPathRequest();
+    GoalActor.Reset();
+
+    Super::OnUnPossess();
+}
+
+bool APlayerAIController::FindPathForMoveRequest(const FAIMoveRequest& MoveRequest, FPathFindingQuery& Query, FNavPathSharedPtr& OutPath) const
+{
+    UAIPathSubsystem* PathSubsystem = GetWorld()->GetSubsystem<UAIPathSubsystem>();
+    const APawn* ControlledPawn = GetPawn();
+    if (!PathSubsystem || !ControlledPawn)
+    {
+        return Super::FindPathForMoveRequest(MoveRequest, Query, OutPath);
+    }
+
+    FNavPathSharedPtr Path = PathSubsystem->FindPathSync(*ControlledPawn, Query);
+    if (!Path.IsValid())
+    {
+        return false;
+    }
+
+    // What the default implementation sets up on the path it finds
+    if (MoveRequest.IsMoveToActorRequest())
+    {
+        Path->SetGoalActorObservation(*MoveRequest.GetGoalActor(), 100.0f);
+    }
+    Path->EnableRecalculationOnInvalidation(true);
+
+    OutPath = Path;
+    return true;
+}
+
+void APlayerAIController::RequestGoalPath()
+{
+    UAIPathSubsystem* PathSubsystem = GetWorld()->GetSubsystem<UAIPathSubsystem>();
+    const AActor* Goal = GoalActor.Get();
+    if (!PathSubsystem || !Goal)
+    {
+        return;
+    }
+
+    CancelPathRequest();
+
+    PathGoalLocation = Goal->GetActorLocation();
+    LastPathRequestTime = GetWorld()->GetTimeSeconds();
+    PathRequestId = PathSubsystem->RequestPath(GetPawn(), PathGoalLocation, FAIPathReadyDelegate::CreateUObject(this, &APlayerAIController::OnPathReady));
+}
+
+void APlayerAIController::OnPathReady(FNavPathSharedPtr Path)
+{
+    PathRequestId = 0;
+
+    AActor* Goal = GoalActor.Get();
+    if (!Path.IsValid() || !Goal)
+    {
+        return;
+    }
+
+    FAIMoveRequest MoveRequest(Goal);
+    MoveRequest.SetAcceptanceRadius(GoalAcceptanceRadius);
+    RequestMove(MoveRequest, Path);
+}
+
+void APlayerAIController::CancelPathRequest()
+{
+    if (PathRequestId == 0)
+    {
+        return;
+    }
+
+    if (UAIPathSubsystem* PathSubsystem = GetWorld()->GetSubsystem<UAIPathSubsystem>())
+    {
+        PathSubsystem->CancelRequest(PathRequestId);
+    }
+    PathRequestId = 0;
+}
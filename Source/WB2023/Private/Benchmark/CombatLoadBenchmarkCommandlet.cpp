@@ -0,0 +1,423 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Benchmark/CombatLoadBenchmarkCommandlet.h"
+#include "Abilities/GameplayAbility.h"
+#include "Character/CharBase.h"
+#include "Character/Abilities/CharacterAbilitySystemComponent.h"
+#include "Character/Abilities/AttributeSets/CharacterAttributeSetBase.h"
+#include "Character/Abilities/ExecutionCalculations/CharacterDamageExecCalculation.h"
+#include "Player/WB2023PlayerState.h"
+#include "WB2023GameplayTags.h"
+#include "AIController.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/WorldSettings.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "ProfilingDebugging/ScopedTimers.h"
+#include "Serialization/ArchiveCountMem.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+namespace CombatLoadBenchmark_Impl
+{
+	constexpr float FrameDeltaSeconds = 1.0f / 30.0f;
+	constexpr int32 WarmupFrames = 10;
+	constexpr float DamagePerHit = 10.0f;
+
+	// Every this many frames a tenth of the characters activate their abilities and are stunned for StunDurationFrames
+	constexpr int32 StunPeriodFrames = 90;
+	constexpr int32 StunDurationFrames = 30;
+
+	// High enough that nobody dies during the run, so N stays constant
+	constexpr float BenchmarkMaxHealth = 1.0e9f;
+
+	static double GetPercentile(TArray<double> SortedValues, double Percentile)
+	{
+		if (SortedValues.Num() == 0)
+		{
+			return 0.0;
+		}
+
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * SortedValues.Num()) - 1, 0, SortedValues.Num() - 1);
+		return SortedValues[Index];
+	}
+
+	static int64 GetUsedMemory()
+	{
+		return static_cast<int64>(FPlatformMemory::GetStats().UsedPhysical);
+	}
+
+	static int64 CountObjectBytes(UObject* Object)
+	{
+		if (!Object)
+		{
+			return 0;
+		}
+
+		FArchiveCountMem CountMem(Object);
+		return static_cast<int64>(CountMem.GetMax());
+	}
+
+	static int32 GetNumActiveAbilities(const UAbilitySystemComponent* AbilitySystem)
+	{
+		int32 NumActive = 0;
+		for (const FGameplayAbilitySpec& Spec : AbilitySystem->GetActivatableAbilities())
+		{
+			NumActive += Spec.IsActive() ? 1 : 0;
+		}
+		return NumActive;
+	}
+}
+
+UCombatLoadBenchmarkCommandlet::UCombatLoadBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = true;
+	LogToConsole = true;
+}
+
+int32 UCombatLoadBenchmarkCommandlet::Main(const FString& Params)
+{
+	using namespace CombatLoadBenchmark_Impl;
+
+	TArray<int32> Counts = { 10, 100, 1000 };
+	FString CountsParam;
+	if (FParse::Value(*Params, TEXT("Counts="), CountsParam))
+	{
+		TArray<FString> CountStrings;
+		CountsParam.ParseIntoArray(CountStrings, TEXT(","));
+
+		Counts.Reset();
+		for (const FString& CountString : CountStrings)
+		{
+			Counts.Add(FMath::Max(FCString::Atoi(*CountString), 1));
+		}
+	}
+
+	int32 NumFrames = 300;
+	FParse::Value(*Params, TEXT("Frames="), NumFrames);
+	NumFrames = FMath::Max(NumFrames, 1);
+
+	FString CharacterClassPath = DefaultCharacterClass.ToString();
+	FParse::Value(*Params, TEXT("CharacterClass="), CharacterClassPath);
+	CharacterClass = LoadClass<ACharBase>(nullptr, *CharacterClassPath);
+	if (!CharacterClass)
+	{
+		UE_LOG(LogWB2023, Error, TEXT("CombatLoadBenchmark: could not load character class '%s', set DefaultCharacterClass in DefaultGame.ini or pass -CharacterClass="), *CharacterClassPath);
+		return 1;
+	}
+
+	GrantedAbilityClasses.Reset();
+	for (const TSoftClassPtr<UGameplayAbility>& AbilityClassPtr : Abilities)
+	{
+		TSubclassOf<UGameplayAbility> AbilityClass = AbilityClassPtr.LoadSynchronous();
+		if (!AbilityClass)
+		{
+			UE_LOG(LogWB2023, Error, TEXT("CombatLoadBenchmark: could not load ability %s"), *AbilityClassPtr.ToString());
+			ReleaseRunAssets();
+			return 1;
+		}
+		GrantedAbilityClasses.Add(AbilityClass);
+	}
+
+	FString OutputPath = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / TEXT("CombatLoad.json");
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+
+	DamageEffect = NewObject<UGameplayEffect>(GetTransientPackage(), TEXT("GE_CombatLoadBenchmarkDamage"));
+	DamageEffect->DurationPolicy = EGameplayEffectDurationType::Instant;
+	FGameplayEffectExecutionDefinition& DamageExecution = DamageEffect->Executions.AddDefaulted_GetRef();
+	DamageExecution.CalculationClass = UCharacterDamageExecCalculation::StaticClass();
+
+	TArray<TSharedPtr<FJsonValue>> JsonResults;
+	for (const int32 NumCharacters : Counts)
+	{
+		const FRunResult Result = RunBenchmark(NumCharacters, NumFrames);
+		if (Result.NumCharacters == 0)
+		{
+			ReleaseRunAssets();
+			return 1;
+		}
+
+		UE_LOG(LogWB2023, Display, TEXT("CombatLoadBenchmark N=%d: Setup=%.2fms Grant=%.2fms Revoke=%.2fms Frame avg=%.3fms p50=%.3fms p95=%.3fms max=%.3fms Damage avg=%.3fms Stuns=%d Cancelled=%d MemGrowth=%lld B/frame ASC=%lld B AttributeSet=%lld B"),
+			Result.NumCharacters, Result.SetupMs, Result.GrantMs, Result.RevokeMs, Result.AverageFrameMs, Result.MedianFrameMs, Result.P95FrameMs, Result.MaxFrameMs,
+			Result.AverageDamageMs, Result.NumStuns, Result.NumAbilitiesCancelled, Result.MemoryGrowthPerFrame, Result.AbilitySystemBytesPerCharacter, Result.AttributeSetBytesPerCharacter);
+
+		TSharedRef<FJsonObject> JsonResult = MakeShared<FJsonObject>();
+		JsonResult->SetNumberField(TEXT("characters"), Result.NumCharacters);
+		JsonResult->SetNumberField(TEXT("setup_ms"), Result.SetupMs);
+		JsonResult->SetNumberField(TEXT("grant_ms"), Result.GrantMs);
+		JsonResult->SetNumberField(TEXT("revoke_ms"), Result.RevokeMs);
+		JsonResult->SetNumberField(TEXT("frame_avg_ms"), Result.AverageFrameMs);
+		JsonResult->SetNumberField(TEXT("frame_p50_ms"), Result.MedianFrameMs);
+		JsonResult->SetNumberField(TEXT("frame_p95_ms"), Result.P95FrameMs);
+		JsonResult->SetNumberField(TEXT("frame_max_ms"), Result.MaxFrameMs);
+		JsonResult->SetNumberField(TEXT("damage_avg_ms"), Result.AverageDamageMs);
+		JsonResult->SetNumberField(TEXT("stuns"), Result.NumStuns);
+		JsonResult->SetNumberField(TEXT("abilities_cancelled_by_stun"), Result.NumAbilitiesCancelled);
+		JsonResult->SetNumberField(TEXT("memory_growth_bytes_per_frame"), static_cast<double>(Result.MemoryGrowthPerFrame));
+		JsonResult->SetNumberField(TEXT("asc_bytes_per_character"), static_cast<double>(Result.AbilitySystemBytesPerCharacter));
+		JsonResult->SetNumberField(TEXT("attribute_set_bytes_per_character"), static_cast<double>(Result.AttributeSetBytesPerCharacter));
+		JsonResults.Add(MakeShared<FJsonValueObject>(JsonResult));
+	}
+
+	TSharedRef<FJsonObject> JsonRoot = MakeShared<FJsonObject>();
+	JsonRoot->SetStringField(TEXT("benchmark"), TEXT("CombatLoad"));
+	JsonRoot->SetStringField(TEXT("character_class"), CharacterClass->GetPathName());
+	JsonRoot->SetNumberField(TEXT("abilities_per_character"), GrantedAbilityClasses.Num());
+	JsonRoot->SetNumberField(TEXT("frames"), NumFrames);
+	JsonRoot->SetNumberField(TEXT("frame_delta_seconds"), FrameDeltaSeconds);
+	JsonRoot->SetArrayField(TEXT("results"), JsonResults);
+
+	ReleaseRunAssets();
+
+	FString JsonString;
+	TSharedRef<TJsonWriter<>> JsonWriter = TJsonWriterFactory<>::Create(&JsonString);
+	FJsonSerializer::Serialize(JsonRoot, JsonWriter);
+
+	if (!FFileHelper::SaveStringToFile(JsonString, *OutputPath))
+	{
+		UE_LOG(LogWB2023, Error, TEXT("CombatLoadBenchmark: could not write %s"), *OutputPath);
+		return 1;
+	}
+
+	UE_LOG(LogWB2023, Display, TEXT("CombatLoadBenchmark: wrote %s"), *OutputPath);
+	return 0;
+}
+
+UCombatLoadBenchmarkCommandlet::FRunResult UCombatLoadBenchmarkCommandlet::RunBenchmark(int32 NumCharacters, int32 NumFrames)
+{
+	using namespace CombatLoadBenchmark_Impl;
+
+	FRunResult Result;
+	Result.NumCharacters = NumCharacters;
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("CombatLoadBenchmark"));
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	World->InitializeActorsForPlay(FURL());
+	World->GetWorldSettings()->NotifyBeginPlay();
+
+	TArray<ACharBase*> Characters;
+	TArray<UCharacterAbilitySystemComponent*> AbilitySystems;
+	TArray<AActor*> SpawnedActors;
+
+	// Spawn and possess: InitializeAttributes, AddStartupEffects, AddCharacterAbilities
+	{
+		FDurationTimer SetupTimer(Result.SetupMs);
+		SetupTimer.Start();
+
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+		const int32 GridSize = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(NumCharacters)));
+		for (int32 Index = 0; Index < NumCharacters; ++Index)
+		{
+			const FVector Location((Index % GridSize) * 200.0f, (Index / GridSize) * 200.0f, 0.0f);
+			ACharBase* Character = World->SpawnActor<ACharBase>(CharacterClass, Location, FRotator::ZeroRotator, SpawnParameters);
+			AAIController* Controller = World->SpawnActor<AAIController>(SpawnParameters);
+			AWB2023PlayerState* PlayerState = World->SpawnActor<AWB2023PlayerState>(SpawnParameters);
+			if (!Character || !Controller || !PlayerState)
+			{
+				continue;
+			}
+
+			PlayerState->SetOwner(Controller);
+			Controller->PlayerState = PlayerState;
+			Controller->Possess(Character);
+
+			// No floor in this world
+			Character->GetCharacterMovement()->SetMovementMode(MOVE_Flying);
+
+			UCharacterAbilitySystemComponent* AbilitySystem = Cast<UCharacterAbilitySystemComponent>(PlayerState->GetAbilitySystemComponent());
+			if (Characters.Num() == 0 && AbilitySystem->GetNumericAttributeBase(UCharacterAttributeSetBase::GetMaxHealthAttribute()) <= 0.0f)
+			{
+				// Without default attributes there is nothing realistic to measure
+				UE_LOG(LogWB2023, Error, TEXT("CombatLoadBenchmark: %s initialized no attributes, use a class with DefaultAttributes or an attribute curve table group"),
+					*CharacterClass->GetName());
+				SpawnedActors.Append({ Character, Controller, PlayerState });
+				break;
+			}
+
+			AbilitySystem->SetNumericAttributeBase(UCharacterAttributeSetBase::GetMaxHealthAttribute(), BenchmarkMaxHealth);
+			AbilitySystem->SetNumericAttributeBase(UCharacterAttributeSetBase::GetHealthAttribute(), BenchmarkMaxHealth);
+
+			Characters.Add(Character);
+			AbilitySystems.Add(AbilitySystem);
+			SpawnedActors.Append({ Character, Controller, PlayerState });
+		}
+
+		SetupTimer.Stop();
+		Result.SetupMs *= 1000.0;
+	}
+
+	if (Characters.Num() == 0)
+	{
+		Result.NumCharacters = 0;
+		DestroyWorld(World, SpawnedActors);
+		return Result;
+	}
+
+	TArray<FGameplayAbilitySpecHandle> GrantedAbilities;
+	{
+		FDurationTimer GrantTimer(Result.GrantMs);
+		GrantTimer.Start();
+
+		for (int32 Index = 0; Index < AbilitySystems.Num(); ++Index)
+		{
+			for (const TSubclassOf<UGameplayAbility>& AbilityClass : GrantedAbilityClasses)
+			{
+				GrantedAbilities.Add(AbilitySystems[Index]->GiveAbility(FGameplayAbilitySpec(AbilityClass, 1, INDEX_NONE, Characters[Index])));
+			}
+		}
+
+		GrantTimer.Stop();
+		Result.GrantMs *= 1000.0;
+	}
+
+	TArray<double> FrameMs;
+	FrameMs.Reserve(NumFrames);
+	double TotalDamageSeconds = 0.0;
+	int64 MemoryAtStart = 0;
+
+	for (int32 Frame = 0; Frame < WarmupFrames + NumFrames; ++Frame)
+	{
+		const bool bMeasured = Frame >= WarmupFrames;
+		if (Frame == WarmupFrames)
+		{
+			MemoryAtStart = GetUsedMemory();
+		}
+
+		double FrameSeconds = 0.0;
+		double DamageSeconds = 0.0;
+		{
+			FScopedDurationTimer FrameTimer(FrameSeconds);
+
+			{
+				FScopedDurationTimer DamageTimer(DamageSeconds);
+
+				// Everyone hits their neighbour
+				for (int32 Index = 0; Index < AbilitySystems.Num(); ++Index)
+				{
+					UCharacterAbilitySystemComponent* Source = AbilitySystems[Index];
+					UCharacterAbilitySystemComponent* Target = AbilitySystems[(Index + 1) % AbilitySystems.Num()];
+
+					// DamageEffect is a transient instance, not a class, so the spec is made from it directly
+					FGameplayEffectSpec DamageSpec(DamageEffect, Source->MakeEffectContext(), 1.0f);
+					DamageSpec.SetSetByCallerMagnitude(WB2023GameplayTags::Data_Damage, DamagePerHit);
+					Source->ApplyGameplayEffectSpecToTarget(DamageSpec, Target);
+				}
+			}
+
+			// A tenth of the characters activate their abilities, then get stunned, which cancels them in StunTagChanged
+			const int32 StunPhase = Frame % StunPeriodFrames;
+			if (StunPhase == 0)
+			{
+				for (int32 Index = 0; Index < AbilitySystems.Num(); Index += 10)
+				{
+					UCharacterAbilitySystemComponent* AbilitySystem = AbilitySystems[Index];
+					for (int32 AbilityIndex = 0; AbilityIndex < GrantedAbilityClasses.Num(); ++AbilityIndex)
+					{
+						AbilitySystem->TryActivateAbility(GrantedAbilities[Index * GrantedAbilityClasses.Num() + AbilityIndex]);
+					}
+
+					const int32 NumActiveBeforeStun = GetNumActiveAbilities(AbilitySystem);
+					AbilitySystem->SetLooseGameplayTagCount(WB2023GameplayTags::State_Debuff_Stun, 1);
+					if (bMeasured)
+					{
+						++Result.NumStuns;
+						Result.NumAbilitiesCancelled += NumActiveBeforeStun - GetNumActiveAbilities(AbilitySystem);
+					}
+				}
+			}
+			else if (StunPhase == StunDurationFrames)
+			{
+				for (int32 Index = 0; Index < AbilitySystems.Num(); Index += 10)
+				{
+					AbilitySystems[Index]->SetLooseGameplayTagCount(WB2023GameplayTags::State_Debuff_Stun, 0);
+				}
+			}
+
+			World->Tick(LEVELTICK_All, FrameDeltaSeconds);
+		}
+
+		if (bMeasured)
+		{
+			FrameMs.Add(FrameSeconds * 1000.0);
+			TotalDamageSeconds += DamageSeconds;
+		}
+	}
+
+	Result.MemoryGrowthPerFrame = (GetUsedMemory() - MemoryAtStart) / NumFrames;
+	Result.AverageDamageMs = TotalDamageSeconds * 1000.0 / NumFrames;
+
+	FrameMs.Sort();
+	double TotalFrameMs = 0.0;
+	for (const double Ms : FrameMs)
+	{
+		TotalFrameMs += Ms;
+	}
+	Result.AverageFrameMs = FrameMs.Num() > 0 ? TotalFrameMs / FrameMs.Num() : 0.0;
+	Result.MedianFrameMs = GetPercentile(FrameMs, 0.5);
+	Result.P95FrameMs = GetPercentile(FrameMs, 0.95);
+	Result.MaxFrameMs = FrameMs.Num() > 0 ? FrameMs.Last() : 0.0;
+
+	if (AbilitySystems.Num() > 0)
+	{
+		int64 AbilitySystemBytes = 0;
+		int64 AttributeSetBytes = 0;
+		for (int32 Index = 0; Index < AbilitySystems.Num(); ++Index)
+		{
+			AbilitySystemBytes += CountObjectBytes(AbilitySystems[Index]);
+			AttributeSetBytes += CountObjectBytes(Characters[Index]->GetAttributeSetBase());
+		}
+
+		Result.AbilitySystemBytesPerCharacter = AbilitySystemBytes / AbilitySystems.Num();
+		Result.AttributeSetBytesPerCharacter = AttributeSetBytes / AbilitySystems.Num();
+	}
+
+	{
+		FDurationTimer RevokeTimer(Result.RevokeMs);
+		RevokeTimer.Start();
+
+		for (int32 Index = 0; Index < AbilitySystems.Num(); ++Index)
+		{
+			for (int32 AbilityIndex = 0; AbilityIndex < GrantedAbilityClasses.Num(); ++AbilityIndex)
+			{
+				AbilitySystems[Index]->ClearAbility(GrantedAbilities[Index * GrantedAbilityClasses.Num() + AbilityIndex]);
+			}
+		}
+
+		RevokeTimer.Stop();
+		Result.RevokeMs *= 1000.0;
+	}
+
+	DestroyWorld(World, SpawnedActors);
+
+	return Result;
+}
+
+void UCombatLoadBenchmarkCommandlet::DestroyWorld(UWorld* World, const TArray<AActor*>& SpawnedActors)
+{
+	for (AActor* Actor : SpawnedActors)
+	{
+		Actor->Destroy();
+	}
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
+
+void UCombatLoadBenchmarkCommandlet::ReleaseRunAssets()
+{
+	CharacterClass = nullptr;
+	GrantedAbilityClasses.Reset();
+	DamageEffect = nullptr;
+}
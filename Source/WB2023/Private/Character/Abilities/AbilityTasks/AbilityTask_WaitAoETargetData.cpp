@@ -0,0 +1,258 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Character/Abilities/AbilityTasks/AbilityTask_WaitAoETargetData.h"
+#include "AbilitySystemComponent.h"
+#include "Character/Abilities/TargetActors/CharacterAoETargetActor.h"
+#include "Character/Player/WB2023PlayerCharacter.h"
+#include "GameFramework/SpringArmComponent.h"
+#include "Player/WB2023PlayerState.h"
+#include "WB2023/WB2023.h"
+
+namespace AbilityTask_WaitAoETargetData_Impl
+{
+	// Slack for the avatar and the targets having moved between the client's query and the server receiving it
+	constexpr float ServerValidationTolerance = 200.0f;
+}
+
+UAbilityTask_WaitAoETargetData* UAbilityTask_WaitAoETargetData::WaitAoETargetData(UGameplayAbility* OwningAbility, FName TaskInstanceName,
+	TSubclassOf<ACharacterAoETargetActor> TargetActorClass, float Radius, float MaxRange)
+{
+	UAbilityTask_WaitAoETargetData* Task = NewAbilityTask<UAbilityTask_WaitAoETargetData>(OwningAbility, TaskInstanceName);
+	Task->TargetActorClass = TargetActorClass;
+	Task->Radius = Radius;
+	Task->MaxRange = MaxRange;
+	return Task;
+}
+
+void UAbilityTask_WaitAoETargetData::Activate()
+{
+	UAbilitySystemComponent* ASC = AbilitySystemComponent.Get();
+	if (!Ability || !ASC || !TargetActorClass)
+	{
+		EndTask();
+		return;
+	}
+
+	if (IsLocallyControlled())
+	{
+		ActivateLocal();
+		return;
+	}
+
+	// Remote client, wait for the target data it sends
+	const FGameplayAbilitySpecHandle SpecHandle = GetAbilitySpecHandle();
+	const FPredictionKey ActivationPredictionKey = GetActivationPredictionKey();
+	ASC->AbilityTargetDataSetDelegate(SpecHandle, ActivationPredictionKey).AddUObject(this, &UAbilityTask_WaitAoETargetData::OnReplicatedTargetDataReceived);
+	ASC->AbilityTargetDataCancelledDelegate(SpecHandle, ActivationPredictionKey).AddUObject(this, &UAbilityTask_WaitAoETargetData::OnReplicatedTargetDataCancelled);
+
+	// The data may have arrived before the task started
+	if (!ASC->CallReplicatedTargetDataDelegatesIfSet(SpecHandle, ActivationPredictionKey))
+	{
+		SetWaitingOnRemotePlayerData();
+	}
+}
+
+void UAbilityTask_WaitAoETargetData::ActivateLocal()
+{
+	UWorld* World = GetWorld();
+	const FGameplayAbilityActorInfo* ActorInfo = Ability->GetCurrentActorInfo();
+
+	TargetActor = World->SpawnActorDeferred<ACharacterAoETargetActor>(TargetActorClass, FTransform::Identity, nullptr, nullptr,
+		ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+	if (!TargetActor)
+	{
+		EndTask();
+		return;
+	}
+
+	TargetActor->PrimaryPC = ActorInfo->PlayerController.Get();
+	TargetActor->Radius = Radius;
+	TargetActor->MaxRange = MaxRange;
+	TargetActor->TargetDataReadyDelegate.AddUObject(this, &UAbilityTask_WaitAoETargetData::OnTargetDataReady);
+	TargetActor->CanceledDelegate.AddUObject(this, &UAbilityTask_WaitAoETargetData::OnTargetDataCancelled);
+	TargetActor->FinishSpawning(FTransform::Identity);
+
+	// Lets the ASC's target confirm/cancel calls reach it
+	AbilitySystemComponent->SpawnedTargetActors.Push(TargetActor);
+
+	TargetActor->StartTargeting(Ability);
+	TargetActor->BindToConfirmCancelInputs();
+
+	SetConfirmCancelUI(true);
+	SetLargeAoECamera(Radius >= LargeAoERadius);
+}
+
+void UAbilityTask_WaitAoETargetData::OnDestroy(bool bInOwnerFinished)
+{
+	if (UAbilitySystemComponent* ASC = AbilitySystemComponent.Get())
+	{
+		const FGameplayAbilitySpecHandle SpecHandle = GetAbilitySpecHandle();
+		const FPredictionKey ActivationPredictionKey = GetActivationPredictionKey();
+		ASC->AbilityTargetDataSetDelegate(SpecHandle, ActivationPredictionKey).RemoveAll(this);
+		ASC->AbilityTargetDataCancelledDelegate(SpecHandle, ActivationPredictionKey).RemoveAll(this);
+	}
+
+	if (TargetActor)
+	{
+		SetConfirmCancelUI(false);
+		SetLargeAoECamera(false);
+
+		TargetActor->Destroy();
+		TargetActor = nullptr;
+	}
+
+	Super::OnDestroy(bInOwnerFinished);
+}
+
+void UAbilityTask_WaitAoETargetData::OnTargetDataReady(const FGameplayAbilityTargetDataHandle& Data)
+{
+	UAbilitySystemComponent* ASC = AbilitySystemComponent.Get();
+	if (!Ability || !ASC)
+	{
+		return;
+	}
+
+	FScopedPredictionWindow ScopedPrediction(ASC, IsPredictingClient());
+
+	if (IsPredictingClient())
+	{
+		ASC->ServerSetReplicatedTargetData(GetAbilitySpecHandle(), GetActivationPredictionKey(), Data, FGameplayTag(), ASC->ScopedPredictionKey);
+	}
+
+	if (ShouldBroadcastAbilityTaskDelegates())
+	{
+		ValidData.Broadcast(Data);
+	}
+
+	EndTask();
+}
+
+void UAbilityTask_WaitAoETargetData::OnTargetDataCancelled(const FGameplayAbilityTargetDataHandle& Data)
+{
+	UAbilitySystemComponent* ASC = AbilitySystemComponent.Get();
+	if (!Ability || !ASC)
+	{
+		return;
+	}
+
+	FScopedPredictionWindow ScopedPrediction(ASC, IsPredictingClient());
+
+	if (IsPredictingClient())
+	{
+		ASC->ServerSetReplicatedTargetDataCancelled(GetAbilitySpecHandle(), GetActivationPredictionKey(), ASC->ScopedPredictionKey);
+	}
+
+	if (ShouldBroadcastAbilityTaskDelegates())
+	{
+		Cancelled.Broadcast(Data);
+	}
+
+	EndTask();
+}
+
+void UAbilityTask_WaitAoETargetData::OnReplicatedTargetDataReceived(const FGameplayAbilityTargetDataHandle& Data, FGameplayTag ActivationTag)
+{
+	UAbilitySystemComponent* ASC = AbilitySystemComponent.Get();
+	if (!ASC)
+	{
+		return;
+	}
+
+	ASC->ConsumeClientReplicatedTargetData(GetAbilitySpecHandle(), GetActivationPredictionKey());
+
+	FGameplayAbilityTargetDataHandle ValidatedData;
+	const bool bValid = ValidateTargetData(Data, ValidatedData);
+	if (!bValid)
+	{
+		UE_LOG(LogWB2023Ability, Warning, TEXT("%s rejected AoE target data from %s"), *GetNameSafe(Ability), *GetNameSafe(GetAvatarActor()));
+	}
+
+	if (ShouldBroadcastAbilityTaskDelegates())
+	{
+		if (bValid)
+		{
+			ValidData.Broadcast(ValidatedData);
+		}
+		else
+		{
+			Cancelled.Broadcast(Data);
+		}
+	}
+
+	EndTask();
+}
+
+void UAbilityTask_WaitAoETargetData::OnReplicatedTargetDataCancelled()
+{
+	if (ShouldBroadcastAbilityTaskDelegates())
+	{
+		Cancelled.Broadcast(FGameplayAbilityTargetDataHandle());
+	}
+
+	EndTask();
+}
+
+bool UAbilityTask_WaitAoETargetData::ValidateTargetData(const FGameplayAbilityTargetDataHandle& Data, FGameplayAbilityTargetDataHandle& OutData) const
+{
+	using namespace AbilityTask_WaitAoETargetData_Impl;
+
+	const FGameplayAbilityTargetData* RawData = Data.Get(0);
+	if (!RawData || RawData->GetScriptStruct() != FGameplayAbilityTargetData_ActorArray::StaticStruct())
+	{
+		return false;
+	}
+
+	const FGameplayAbilityTargetData_ActorArray* ClientData = static_cast<const FGameplayAbilityTargetData_ActorArray*>(RawData);
+	const FVector Center = ClientData->SourceLocation.LiteralTransform.GetLocation();
+
+	const AActor* Avatar = GetAvatarActor();
+	if (!Avatar || FVector::DistSquared2D(Avatar->GetActorLocation(), Center) > FMath::Square(MaxRange + ServerValidationTolerance))
+	{
+		return false;
+	}
+
+	FGameplayAbilityTargetData_ActorArray* ServerData = new FGameplayAbilityTargetData_ActorArray();
+	ServerData->SourceLocation = ClientData->SourceLocation;
+	ServerData->TargetActorArray.Reserve(ClientData->TargetActorArray.Num());
+
+	const float MaxDistanceSquared = FMath::Square(Radius + ServerValidationTolerance);
+	for (const TWeakObjectPtr<AActor>& Target : ClientData->TargetActorArray)
+	{
+		const AActor* TargetActorPtr = Target.Get();
+		if (TargetActorPtr && FVector::DistSquared(TargetActorPtr->GetActorLocation(), Center) <= MaxDistanceSquared)
+		{
+			ServerData->TargetActorArray.AddUnique(Target);
+		}
+	}
+
+	OutData = FGameplayAbilityTargetDataHandle(ServerData);
+	return true;
+}
+
+void UAbilityTask_WaitAoETargetData::SetConfirmCancelUI(bool bShow)
+{
+	if (AWB2023PlayerState* PS = Ability ? Cast<AWB2023PlayerState>(Ability->GetOwningActorFromActorInfo()) : nullptr)
+	{
+		PS->ShowAbilityConfirmCancelText(bShow);
+	}
+}
+
+void UAbilityTask_WaitAoETargetData::SetLargeAoECamera(bool bEnable)
+{
+	if (bEnable == bLargeAoECameraActive)
+	{
+		return;
+	}
+
+	AWB2023PlayerCharacter* PlayerCharacter = Cast<AWB2023PlayerCharacter>(GetAvatarActor());
+	USpringArmComponent* CameraBoom = PlayerCharacter ? PlayerCharacter->GetCameraBoom() : nullptr;
+	if (!CameraBoom)
+	{
+		return;
+	}
+
+	const float StartingArmLength = PlayerCharacter->GetStartingCameraBoomArmLength();
+	CameraBoom->TargetArmLength = bEnable ? StartingArmLength * LargeAoEArmLengthScale : StartingArmLength;
+	bLargeAoECameraActive = bEnable;
+}
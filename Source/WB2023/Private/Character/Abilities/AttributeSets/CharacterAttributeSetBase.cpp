@@ -2,7 +2,208 @@
 
 
 #include "Character/Abilities/AttributeSets/CharacterAttributeSetBase.h"
+#include "Character/Abilities/CharacterAbilitySystemComponent.h"
 #include "Net/UnrealNetwork.h"
+#include "GameplayEffectExtension.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+namespace CompactVitals_Impl
+{
+    // Health and Mana go over the wire in tenths
+    constexpr float FixedPointScale = 10.0f;
+
+    static void SerializeFixedPoint(FArchive& Ar, float& Value)
+    {
+        uint32 Packed = Ar.IsSaving() ? static_cast<uint32>(FMath::RoundToInt(FMath::Max(Value, 0.0f) * FixedPointScale)) : 0;
+        Ar.SerializeIntPacked(Packed);
+        if (Ar.IsLoading())
+        {
+            Value = Packed / FixedPointScale;
+        }
+    }
+
+    static void SerializeBaseAndCurrent(FArchive& Ar, float& BaseValue, float& CurrentValue)
+    {
+        SerializeFixedPoint(Ar, BaseValue);
+
+        // Current only differs from base while a duration effect modifies the attribute
+        uint8 bHasCurrent = Ar.IsSaving() ? (CurrentValue != BaseValue) : 0;
+        Ar.SerializeBits(&bHasCurrent, 1);
+        if (bHasCurrent)
+        {
+            SerializeFixedPoint(Ar, CurrentValue);
+        }
+        else if (Ar.IsLoading())
+        {
+            CurrentValue = BaseValue;
+        }
+    }
+}
+
+bool FCompactVitalAttributes::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+    using namespace CompactVitals_Impl;
+
+    Ar << Level;
+    SerializeBaseAndCurrent(Ar, HealthBase, HealthCurrent);
+    SerializeBaseAndCurrent(Ar, ManaBase, ManaCurrent);
+
+    bOutSuccess = true;
+    return true;
+}
+
+void UCharacterAttributeSetBase::PreAttributeChange(const FGameplayAttribute& Attribute, float& NewValue)
+{
+    Super::PreAttributeChange(Attribute, NewValue);
+
+    if (Attribute == GetHealthAttribute())
+    {
+        NewValue = FMath::Clamp(NewValue, 0.0f, GetMaxHealth());
+    }
+    else if (Attribute == GetManaAttribute())
+    {
+        NewValue = FMath::Clamp(NewValue, 0.0f, GetMaxMana());
+    }
+}
+
+void UCharacterAttributeSetBase::PostGameplayEffectExecute(const FGameplayEffectModCallbackData& Data)
+{
+    Super::PostGameplayEffectExecute(Data);
+
+    if (Data.EvaluatedData.Attribute == GetDamageAttribute())
+    {
+        // Damage only lives for the duration of the execution, consume it and reset
+        const float LocalDamageDone = GetDamage();
+        SetDamage(0.0f);
+
+        if (LocalDamageDone > 0.0f)
+        {
+            const float NewHealth = GetHealth() - LocalDamageDone;
+            SetHealth(FMath::Clamp(NewHealth, 0.0f, GetMaxHealth()));
+        }
+    }
+    else if (Data.EvaluatedData.Attribute == GetHealthAttribute())
+    {
+        SetHealth(FMath::Clamp(GetHealth(), 0.0f, GetMaxHealth()));
+    }
+    else if (Data.EvaluatedData.Attribute == GetManaAttribute())
+    {
+        SetMana(FMath::Clamp(GetMana(), 0.0f, GetMaxMana()));
+    }
+}
+
+void UCharacterAttributeSetBase::PostAttributeChange(const FGameplayAttribute& Attribute, float OldValue, float NewValue)
+{
+    Super::PostAttributeChange(Attribute, OldValue, NewValue);
+
+    MarkAttributeDirty(Attribute);
+}
+
+void UCharacterAttributeSetBase::InitializeBaseValues(TConstArrayView<FGameplayAttribute> Attributes, TConstArrayView<float> Values, TArray<FCharacterAttributeChange>& OutChanges)
+{
+    check(Attributes.Num() == Values.Num());
+
+    const int32 FirstChange = OutChanges.Num();
+    for (int32 Index = 0; Index < Attributes.Num(); ++Index)
+    {
+        if (FGameplayAttributeData* Data = Attributes[Index].GetGameplayAttributeData(this))
+        {
+            FCharacterAttributeChange& Change = OutChanges.AddDefaulted_GetRef();
+            Change.Attribute = Attributes[Index];
+            Change.OldValue = Data->GetCurrentValue();
+
+            Data->SetBaseValue(Values[Index]);
+            Data->SetCurrentValue(Values[Index]);
+        }
+    }
+
+    // What PreAttributeChange would have done, once all the max values are in
+    const float ClampedHealth = FMath::Clamp(GetHealth(), 0.0f, GetMaxHealth());
+    Health.SetBaseValue(ClampedHealth);
+    Health.SetCurrentValue(ClampedHealth);
+
+    const float ClampedMana = FMath::Clamp(GetMana(), 0.0f, GetMaxMana());
+    Mana.SetBaseValue(ClampedMana);
+    Mana.SetCurrentValue(ClampedMana);
+
+    for (int32 Index = OutChanges.Num() - 1; Index >= FirstChange; --Index)
+    {
+        FCharacterAttributeChange& Change = OutChanges[Index];
+        Change.NewValue = Change.Attribute.GetNumericValue(this);
+        if (Change.NewValue == Change.OldValue)
+        {
+            OutChanges.RemoveAt(Index, 1, false);
+            continue;
+        }
+
+        MarkAttributeDirty(Change.Attribute);
+    }
+}
+
+void UCharacterAttributeSetBase::PostAttributeBaseChange(const FGameplayAttribute& Attribute, float OldValue, float NewValue) const
+{
+    Super::PostAttributeBaseChange(Attribute, OldValue, NewValue);
+
+    // The replicated FGameplayAttributeData carries the base value too. Engine hook is const, the dirty state is not
+    const_cast<UCharacterAttributeSetBase*>(this)->MarkAttributeDirty(Attribute);
+}
+
+void UCharacterAttributeSetBase::OnAttributeAggregatorCreated(const FGameplayAttribute& Attribute, FAggregator* NewAggregator) const
+{
+    Super::OnAttributeAggregatorCreated(Attribute, NewAggregator);
+
+    AggregatedAttributes.AddUnique(Attribute);
+}
+
+bool UCharacterAttributeSetBase::HasAttributeAggregator(TConstArrayView<FGameplayAttribute> Attributes) const
+{
+    for (const FGameplayAttribute& Attribute : Attributes)
+    {
+        if (AggregatedAttributes.Contains(Attribute))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void UCharacterAttributeSetBase::MarkAttributeDirty(const FGameplayAttribute& Attribute)
+{
+    if (bCompactVitalsReplication && (Attribute == GetLevelAttribute() || Attribute == GetHealthAttribute() || Attribute == GetManaAttribute()))
+    {
+        CompactVitals.Level = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(Level.GetCurrentValue()), 0, MAX_uint8));
+        CompactVitals.HealthBase = Health.GetBaseValue();
+        CompactVitals.HealthCurrent = Health.GetCurrentValue();
+        CompactVitals.ManaBase = Mana.GetBaseValue();
+        CompactVitals.ManaCurrent = Mana.GetCurrentValue();
+        MARK_PROPERTY_DIRTY_FROM_NAME(UCharacterAttributeSetBase, CompactVitals, this);
+    }
+    else if (Attribute == GetLevelAttribute())
+    {
+        MARK_PROPERTY_DIRTY_FROM_NAME(UCharacterAttributeSetBase, Level, this);
+    }
+    else if (Attribute == GetHealthAttribute())
+    {
+        MARK_PROPERTY_DIRTY_FROM_NAME(UCharacterAttributeSetBase, Health, this);
+    }
+    else if (Attribute == GetMaxHealthAttribute())
+    {
+        MARK_PROPERTY_DIRTY_FROM_NAME(UCharacterAttributeSetBase, MaxHealth, this);
+    }
+    else if (Attribute == GetManaAttribute())
+    {
+        MARK_PROPERTY_DIRTY_FROM_NAME(UCharacterAttributeSetBase, Mana, this);
+    }
+    else if (Attribute == GetMaxManaAttribute())
+    {
+        MARK_PROPERTY_DIRTY_FROM_NAME(UCharacterAttributeSetBase, MaxMana, this);
+    }
+    else if (Attribute == GetArmorAttribute())
+    {
+        MARK_PROPERTY_DIRTY_FROM_NAME(UCharacterAttributeSetBase, Armor, this);
+    }
+}
 
 
 void UCharacterAttributeSetBase::OnRep_CharacterLevel(const FGameplayAttributeData& OldLevel)
@@ -30,14 +231,56 @@ void UCharacterAttributeSetBase::OnRep_MaxMana(const FGameplayAttributeData& Old
     GAMEPLAYATTRIBUTE_REPNOTIFY(UCharacterAttributeSetBase, MaxMana, OldMaxMana);
 }
 
+void UCharacterAttributeSetBase::OnRep_Armor(const FGameplayAttributeData& OldArmor)
+{
+    GAMEPLAYATTRIBUTE_REPNOTIFY(UCharacterAttributeSetBase, Armor, OldArmor);
+}
+
+void UCharacterAttributeSetBase::OnRep_CompactVitals()
+{
+    // Unpack into the real attributes and run the same notifies as full replication
+    const FGameplayAttributeData OldLevel = Level;
+    const FGameplayAttributeData OldHealth = Health;
+    const FGameplayAttributeData OldMana = Mana;
+
+    Level.SetBaseValue(CompactVitals.Level);
+    Level.SetCurrentValue(CompactVitals.Level);
+    Health.SetBaseValue(CompactVitals.HealthBase);
+    Health.SetCurrentValue(CompactVitals.HealthCurrent);
+    Mana.SetBaseValue(CompactVitals.ManaBase);
+    Mana.SetCurrentValue(CompactVitals.ManaCurrent);
+
+    OnRep_CharacterLevel(OldLevel);
+    OnRep_Health(OldHealth);
+    OnRep_Mana(OldMana);
+}
+
 // Helps w replication
 void UCharacterAttributeSetBase::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
     Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-    DOREPLIFETIME_CONDITION_NOTIFY(UCharacterAttributeSetBase, Level, COND_None, REPNOTIFY_Always);
-    DOREPLIFETIME_CONDITION_NOTIFY(UCharacterAttributeSetBase, Health, COND_None, REPNOTIFY_Always);
-    DOREPLIFETIME_CONDITION_NOTIFY(UCharacterAttributeSetBase, MaxHealth, COND_None, REPNOTIFY_Always);
-    DOREPLIFETIME_CONDITION_NOTIFY(UCharacterAttributeSetBase, Mana, COND_None, REPNOTIFY_Always);
-    DOREPLIFETIME_CONDITION_NOTIFY(UCharacterAttributeSetBase, MaxMana, COND_None, REPNOTIFY_Always);
+    // Push model, properties are only compared after MarkAttributeDirty
+    FDoRepLifetimeParams Params;
+    Params.bIsPushBased = true;
+    Params.RepNotifyCondition = REPNOTIFY_Always;
+
+    if (bCompactVitalsReplication)
+    {
+        DOREPLIFETIME_WITH_PARAMS_FAST(UCharacterAttributeSetBase, CompactVitals, Params);
+        DISABLE_REPLICATED_PROPERTY_FAST(UCharacterAttributeSetBase, Level);
+        DISABLE_REPLICATED_PROPERTY_FAST(UCharacterAttributeSetBase, Health);
+        DISABLE_REPLICATED_PROPERTY_FAST(UCharacterAttributeSetBase, Mana);
+    }
+    else
+    {
+        DOREPLIFETIME_WITH_PARAMS_FAST(UCharacterAttributeSetBase, Level, Params);
+        DOREPLIFETIME_WITH_PARAMS_FAST(UCharacterAttributeSetBase, Health, Params);
+        DOREPLIFETIME_WITH_PARAMS_FAST(UCharacterAttributeSetBase, Mana, Params);
+        DISABLE_REPLICATED_PROPERTY_FAST(UCharacterAttributeSetBase, CompactVitals);
+    }
+
+    DOREPLIFETIME_WITH_PARAMS_FAST(UCharacterAttributeSetBase, MaxHealth, Params);
+    DOREPLIFETIME_WITH_PARAMS_FAST(UCharacterAttributeSetBase, MaxMana, Params);
+    DOREPLIFETIME_WITH_PARAMS_FAST(UCharacterAttributeSetBase, Armor, Params);
 }
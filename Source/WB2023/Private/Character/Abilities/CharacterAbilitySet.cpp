@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Character/Abilities/CharacterAbilitySet.h"
+#include "Character/Abilities/CharacterGameplayAbility.h"
+#include "Character/Abilities/EffectSpecCacheSubsystem.h"
+#include "AbilitySystemComponent.h"
+#include "UObject/ObjectSaveContext.h"
+
+const FPrimaryAssetType UCharacterAbilitySet::PrimaryAssetType(TEXT("CharacterAbilitySet"));
+const FName UCharacterAbilitySet::MontagesBundle(TEXT("Montages"));
+const FName UCharacterAbilitySet::EffectsBundle(TEXT("Effects"));
+
+void FCharacterAbilitySetHandles::RemoveAbilities(UAbilitySystemComponent* AbilitySystemComponent)
+{
+	if (AbilitySystemComponent)
+	{
+		for (const FGameplayAbilitySpecHandle& Handle : AbilitySpecHandles)
+		{
+			AbilitySystemComponent->ClearAbility(Handle);
+		}
+	}
+
+	AbilitySpecHandles.Reset();
+}
+
+void FCharacterAbilitySetHandles::RemoveEffects(UAbilitySystemComponent* AbilitySystemComponent)
+{
+	if (AbilitySystemComponent)
+	{
+		for (const FActiveGameplayEffectHandle& Handle : EffectHandles)
+		{
+			AbilitySystemComponent->RemoveActiveGameplayEffect(Handle);
+		}
+	}
+
+	EffectHandles.Reset();
+}
+
+void UCharacterAbilitySet::GiveAbilities(UAbilitySystemComponent* AbilitySystemComponent, UObject* SourceObject, FCharacterAbilitySetHandles& OutHandles) const
+{
+	if (!AbilitySystemComponent)
+	{
+		return;
+	}
+
+	OutHandles.AbilitySpecHandles.Reserve(OutHandles.AbilitySpecHandles.Num() + Abilities.Num());
+	for (const FCharacterAbilitySetEntry& Entry : Abilities)
+	{
+		if (Entry.Ability)
+		{
+			OutHandles.AbilitySpecHandles.Add(AbilitySystemComponent->GiveAbility(FGameplayAbilitySpec(Entry.Ability, Entry.AbilityLevel, Entry.InputID, SourceObject)));
+		}
+	}
+}
+
+void UCharacterAbilitySet::ApplyStartupEffects(UAbilitySystemComponent* AbilitySystemComponent, UObject* SourceObject, float Level, FCharacterAbilitySetHandles& OutHandles) const
+{
+	if (!AbilitySystemComponent)
+	{
+		return;
+	}
+
+	FGameplayEffectContextHandle EffectContext = AbilitySystemComponent->MakeEffectContext();
+	EffectContext.AddSourceObject(SourceObject);
+
+	for (const TSubclassOf<UGameplayEffect>& GameplayEffect : StartupEffects)
+	{
+		FGameplayEffectSpecHandle NewHandle = UEffectSpecCacheSubsystem::MakeOutgoingSpec(AbilitySystemComponent, GameplayEffect, Level, EffectContext);
+		if (NewHandle.IsValid())
+		{
+			OutHandles.EffectHandles.Add(AbilitySystemComponent->ApplyGameplayEffectSpecToSelf(*NewHandle.Data.Get()));
+		}
+	}
+}
+
+FPrimaryAssetId UCharacterAbilitySet::GetPrimaryAssetId() const
+{
+	return FPrimaryAssetId(PrimaryAssetType, GetFName());
+}
+
+void UCharacterAbilitySet::PostLoad()
+{
+	Super::PostLoad();
+
+	// Assets saved before InputID existed
+	RefreshInputIDs();
+}
+
+#if WITH_EDITOR
+void UCharacterAbilitySet::PreSave(FObjectPreSaveContext SaveContext)
+{
+	RefreshInputIDs();
+
+	Super::PreSave(SaveContext);
+}
+#endif
+
+void UCharacterAbilitySet::RefreshInputIDs()
+{
+	for (FCharacterAbilitySetEntry& Entry : Abilities)
+	{
+		if (Entry.Ability && (Entry.InputID == INDEX_NONE || GIsEditor))
+		{
+			Entry.InputID = static_cast<int32>(Entry.Ability.GetDefaultObject()->AbilityInputID);
+		}
+	}
+}
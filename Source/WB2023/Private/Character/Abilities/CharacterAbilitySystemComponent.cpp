@@ -4,132 +4,771 @@
 #include "EnhancedInputComponent.h"
 #include "AbilitySystemComponent.h"
 #include "AbilitySystemGlobals.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "WB2023/WB2023.h"
+#include "Character/Abilities/CharacterGameplayAbility.h"
+#include "WB2023Trace.h"
+#include "Metrics/WB2023Metrics.h"
 #include "Character/Abilities/CharacterAbilitySystemComponent.h"
 
 namespace EnhancedInputAbilitySystem_Impl
 {
 	constexpr int32 InvalidInputID = 0;
-	int32 IncrementingInputID = InvalidInputID;
 
-	static int32 GetNextInputID()
+	// IDs below this are the fixed CharAbilityID values abilities are given with
+	constexpr int32 FirstBindingInputID = static_cast<int32>(CharAbilityID::MAX);
+
+#if !UE_BUILD_SHIPPING
+	static void ForEachLocalAbilitySystem(UWorld* World, TFunctionRef<void(APlayerController*, UCharacterAbilitySystemComponent*)> Func)
 	{
-		return ++IncrementingInputID;
+		for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+		{
+			APlayerController* PlayerController = It->Get();
+			if (PlayerController && PlayerController->IsLocalController())
+			{
+				if (UCharacterAbilitySystemComponent* ASC = Cast<UCharacterAbilitySystemComponent>(UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(PlayerController->PlayerState)))
+				{
+					Func(PlayerController, ASC);
+				}
+			}
+		}
 	}
+
+	static FAutoConsoleCommandWithWorldAndArgs InputBufferStatsCommand(
+		TEXT("WB2023.InputBuffer.Stats"),
+		TEXT("Logs the ability input buffer counters of the local players. Pass reset to clear them"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			const bool bReset = Args.Num() > 0 && Args[0] == TEXT("reset");
+			ForEachLocalAbilitySystem(World, [bReset](APlayerController* PlayerController, UCharacterAbilitySystemComponent* ASC)
+			{
+				const FAbilityInputBufferStats& Stats = ASC->GetInputBufferStats();
+				const float PingMs = PlayerController->PlayerState ? PlayerController->PlayerState->GetPingInMilliseconds() : 0.0f;
+				UE_LOG(LogWB2023Input, Display, TEXT("%s: Ping=%.0fms Pressed=%d Buffered=%d Coalesced=%d Replayed=%d Dropped=%d AvgReplayDelay=%.1fms ActivationRPCs=%d RoundTrips=%d AvgRoundTrip=%.1fms"),
+					*PlayerController->GetName(), PingMs, Stats.Pressed, Stats.Buffered, Stats.Coalesced, Stats.Replayed, Stats.Dropped,
+					Stats.Replayed > 0 ? Stats.TotalReplayDelay * 1000.0 / Stats.Replayed : 0.0,
+					Stats.ActivationRPCs, Stats.RoundTrips, Stats.RoundTrips > 0 ? Stats.TotalRoundTripTime * 1000.0 / Stats.RoundTrips : 0.0);
+
+				if (bReset)
+				{
+					ASC->ResetInputBufferStats();
+				}
+			});
+		}));
+
+	// Sets packet lag and loss through net emulation and starts a fresh measurement
+	static FAutoConsoleCommandWithWorldAndArgs InputBufferSimulateLatencyCommand(
+		TEXT("WB2023.InputBuffer.SimulateLatency"),
+		TEXT("WB2023.InputBuffer.SimulateLatency <LagMs> [LossPercent]. Emulates latency and resets the input buffer counters, read them back with WB2023.InputBuffer.Stats"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			const int32 LagMs = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 0;
+			const int32 LossPercent = Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 0;
+
+			if (GEngine)
+			{
+				GEngine->Exec(World, *FString::Printf(TEXT("NetEmulation.PktLag %d"), LagMs));
+				GEngine->Exec(World, *FString::Printf(TEXT("NetEmulation.PktLoss %d"), LossPercent));
+			}
+
+			ForEachLocalAbilitySystem(World, [](APlayerController*, UCharacterAbilitySystemComponent* ASC)
+			{
+				ASC->ResetInputBufferStats();
+			});
+
+			UE_LOG(LogWB2023Input, Display, TEXT("Input buffer: emulating %dms lag, %d%% loss"), LagMs, LossPercent);
+		}));
+#endif
 }
 
 void UCharacterAbilitySystemComponent::SetInputBinding(UInputAction* InputAction, FGameplayAbilitySpecHandle AbilityHandle)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCharacterAbilitySystemComponent::SetInputBinding);
+	SCOPE_CYCLE_COUNTER(STAT_WB2023_InputBinding);
+
 	using namespace EnhancedInputAbilitySystem_Impl;
 
+	// An ability is only ever on one binding
+	if (AbilityHandleToInputID.Contains(AbilityHandle))
+	{
+		ClearInputBinding(AbilityHandle);
+	}
+
 	FGameplayAbilitySpec* BindingAbility = FindAbilitySpec(AbilityHandle);
 
-	FAbilityInputBinding* AbilityInputBinding = MappedAbilities.Find(InputAction);
-	if (AbilityInputBinding)
+	int32 InputID = InvalidInputID;
+	if (const int32* FoundInputID = MappedAbilities.Find(InputAction))
 	{
-		FGameplayAbilitySpec* OldBoundAbility = FindAbilitySpec(AbilityInputBinding->BoundAbilitiesStack.Top());
-		if (OldBoundAbility && OldBoundAbility->InputID == AbilityInputBinding->InputID)
+		InputID = *FoundInputID;
+
+		FAbilityInputBinding& AbilityInputBinding = *FindBinding(InputID);
+		FGameplayAbilitySpec* OldBoundAbility = FindAbilitySpec(AbilityInputBinding.BoundAbilitiesStack.Top());
+		if (OldBoundAbility && OldBoundAbility->InputID == InputID)
 		{
 			OldBoundAbility->InputID = InvalidInputID;
 		}
 	}
 	else
 	{
-		AbilityInputBinding = &MappedAbilities.Add(InputAction);
-		AbilityInputBinding->InputID = GetNextInputID();
+		InputID = AllocateInputID();
+		MappedAbilities.Add(InputAction, InputID);
+
+		FAbilityInputBinding& AbilityInputBinding = *FindBinding(InputID);
+		AbilityInputBinding.InputAction = InputAction;
 	}
 
 	if (BindingAbility)
 	{
-		BindingAbility->InputID = AbilityInputBinding->InputID;
+		BindingAbility->InputID = InputID;
 	}
 
-	AbilityInputBinding->BoundAbilitiesStack.Push(AbilityHandle);
-	TryBindAbilityInput(InputAction, *AbilityInputBinding);
+	FAbilityInputBinding& AbilityInputBinding = *FindBinding(InputID);
+	AbilityInputBinding.BoundAbilitiesStack.Push(AbilityHandle);
+	AbilityHandleToInputID.Add(AbilityHandle, InputID);
+	TryBindAbilityInput(AbilityInputBinding);
 }
 
 void UCharacterAbilitySystemComponent::ClearInputBinding(FGameplayAbilitySpecHandle AbilityHandle)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCharacterAbilitySystemComponent::ClearInputBinding);
+	SCOPE_CYCLE_COUNTER(STAT_WB2023_InputBinding);
+
 	using namespace EnhancedInputAbilitySystem_Impl;
 
-	if (FGameplayAbilitySpec* FoundAbility = FindAbilitySpec(AbilityHandle))
+	int32 InputID = InvalidInputID;
+	if (!AbilityHandleToInputID.RemoveAndCopyValue(AbilityHandle, InputID))
 	{
-		// Find the mapping for this ability
-		auto MappedIterator = MappedAbilities.CreateIterator();
-		while (MappedIterator)
+		return;
+	}
+
+	FAbilityInputBinding* AbilityInputBinding = FindBinding(InputID);
+	if (AbilityInputBinding && AbilityInputBinding->BoundAbilitiesStack.Remove(AbilityHandle) > 0)
+	{
+		if (AbilityInputBinding->BoundAbilitiesStack.Num() > 0)
 		{
-			if (MappedIterator.Value().InputID == FoundAbility->InputID)
+			FGameplayAbilitySpec* StackedAbility = FindAbilitySpec(AbilityInputBinding->BoundAbilitiesStack.Top());
+			if (StackedAbility && StackedAbility->InputID == InvalidInputID)
 			{
-				break;
+				StackedAbility->InputID = InputID;
 			}
-
-			++MappedIterator;
 		}
-
-		if (MappedIterator)
+		else
 		{
-			FAbilityInputBinding& AbilityInputBinding = MappedIterator.Value();
+			// NOTE: This frees the binding's slot
+			RemoveEntry(AbilityInputBinding->InputAction);
+		}
+		// DO NOT act on `AbilityInputBinding` after here (it could have been removed)
+	}
+
+	FGameplayAbilitySpec* FoundAbility = FindAbilitySpec(AbilityHandle);
+	if (FoundAbility && FoundAbility->InputID == InputID)
+	{
+		FoundAbility->InputID = InvalidInputID;
+	}
+}
 
-			if (AbilityInputBinding.BoundAbilitiesStack.Remove(AbilityHandle) > 0)
+void UCharacterAbilitySystemComponent::ClearAbilityBindings(UInputAction* InputAction)
+{
+	RemoveEntry(InputAction);
+}
+
+void UCharacterAbilitySystemComponent::ReceiveDamage(UCharacterAbilitySystemComponent* SourceASC, float UnmitigatedDamage, float MitigatedDamage)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCharacterAbilitySystemComponent::ReceiveDamage);
+
+	WB2023Metrics::DamageEvents.Add();
+	WB2023Metrics::DamageTaken.Observe(MitigatedDamage);
+
+	LastCombatTime = GetWorld()->GetTimeSeconds();
+	if (SourceASC)
+	{
+		SourceASC->LastCombatTime = LastCombatTime;
+	}
+
+    ReceivedDamage.Broadcast(SourceASC, UnmitigatedDamage, MitigatedDamage);
+}
+
+void UCharacterAbilitySystemComponent::CancelActiveAbilities(const FGameplayTagContainer* WithTags, const FGameplayTagContainer* WithoutTags, UGameplayAbility* Ignore)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCharacterAbilitySystemComponent::CancelActiveAbilities);
+
+	TArray<FGameplayAbilitySpecHandle, TInlineAllocator<8>> AbilitiesToCancel;
+	if (WithTags)
+	{
+		for (const FGameplayTag& Tag : *WithTags)
+		{
+			if (const TArray<FGameplayAbilitySpecHandle>* Handles = ActiveAbilitiesByTag.Find(Tag))
 			{
-				if (AbilityInputBinding.BoundAbilitiesStack.Num() > 0)
-				{
-					FGameplayAbilitySpec* StackedAbility = FindAbilitySpec(AbilityInputBinding.BoundAbilitiesStack.Top());
-					if (StackedAbility && StackedAbility->InputID == 0)
-					{
-						StackedAbility->InputID = AbilityInputBinding.InputID;
-					}
-				}
-				else
+				for (const FGameplayAbilitySpecHandle& Handle : *Handles)
 				{
-					// NOTE: This will invalidate the `AbilityInputBinding` ref above
-					RemoveEntry(MappedIterator.Key());
+					AbilitiesToCancel.AddUnique(Handle);
 				}
-				// DO NOT act on `AbilityInputBinding` after here (it could have been removed)
+			}
+		}
+	}
+	else
+	{
+		AbilitiesToCancel.Append(ActiveAbilityHandles);
+	}
+
+	// Canceling ends the abilities, which changes the index
+	for (const FGameplayAbilitySpecHandle& Handle : AbilitiesToCancel)
+	{
+		FGameplayAbilitySpec* Spec = FindAbilitySpecFromHandle(Handle);
+		if (!Spec || !Spec->Ability || !Spec->IsActive())
+		{
+			continue;
+		}
+
+		if (WithoutTags && GetIndexedAbilityTags(Spec->Ability).HasAny(*WithoutTags))
+		{
+			continue;
+		}
+
+		if (Ignore && (Spec->Ability == Ignore || Spec->GetAbilityInstances().Contains(Ignore)))
+		{
+			continue;
+		}
+
+		CancelAbilityHandle(Handle);
+	}
+}
+
+void UCharacterAbilitySystemComponent::NotifyAbilityActivated(const FGameplayAbilitySpecHandle Handle, UGameplayAbility* Ability)
+{
+	Super::NotifyAbilityActivated(Handle, Ability);
 
+	WB2023Metrics::AbilitiesActivated.Add();
+	WB2023_TRACE_ABILITY_ACTIVATED(GetAvatarActor(), Ability);
+
+	if (ActiveAbilityHandles.Contains(Handle))
+	{
+		return;
+	}
 
-				FoundAbility->InputID = InvalidInputID;
+	ActiveAbilityHandles.Add(Handle);
+	for (const FGameplayTag& Tag : GetIndexedAbilityTags(Ability))
+	{
+		ActiveAbilitiesByTag.FindOrAdd(Tag).Add(Handle);
+	}
+}
+
+void UCharacterAbilitySystemComponent::NotifyAbilityEnded(FGameplayAbilitySpecHandle Handle, UGameplayAbility* Ability, bool bWasCancelled)
+{
+	Super::NotifyAbilityEnded(Handle, Ability, bWasCancelled);
+
+	if (bWasCancelled)
+	{
+		WB2023Metrics::AbilitiesCanceled.Add();
+	}
+
+	// Other instances of the ability may still be running
+	const FGameplayAbilitySpec* Spec = FindAbilitySpecFromHandle(Handle);
+	if (!Spec || !Spec->IsActive())
+	{
+		RemoveActiveAbility(Handle, Ability);
+	}
+}
+
+void UCharacterAbilitySystemComponent::RemoveActiveAbility(FGameplayAbilitySpecHandle Handle, const UGameplayAbility* Ability)
+{
+	if (ActiveAbilityHandles.RemoveSwap(Handle) == 0)
+	{
+		return;
+	}
+
+	for (const FGameplayTag& Tag : GetIndexedAbilityTags(Ability))
+	{
+		if (TArray<FGameplayAbilitySpecHandle>* Handles = ActiveAbilitiesByTag.Find(Tag))
+		{
+			Handles->RemoveSwap(Handle);
+		}
+	}
+}
+
+const FGameplayTagContainer& UCharacterAbilitySystemComponent::GetIndexedAbilityTags(const UGameplayAbility* Ability)
+{
+	const UCharacterGameplayAbility* CharacterAbility = Cast<UCharacterGameplayAbility>(Ability);
+	return CharacterAbility ? CharacterAbility->GetAbilityTagsWithParents() : FGameplayTagContainer::EmptyContainer;
+}
+
+FDelegateHandle UCharacterAbilitySystemComponent::AddAttributeChangeListener(const TArray<FGameplayAttribute>& Attributes, FOnAttributesChangedDelegate&& Delegate)
+{
+	for (const FGameplayAttribute& Attribute : Attributes)
+	{
+		if (!ObservedAttributes.Contains(Attribute))
+		{
+			ObservedAttributes.Add(Attribute);
+			GetGameplayAttributeValueChangeDelegate(Attribute).AddUObject(this, &UCharacterAbilitySystemComponent::OnAttributeValueChanged);
+		}
+	}
+
+	FAttributeChangeListener& Listener = AttributeChangeListeners.AddDefaulted_GetRef();
+	Listener.Attributes = Attributes;
+	Listener.Delegate = MoveTemp(Delegate);
+	Listener.Handle = FDelegateHandle(FDelegateHandle::GenerateNewHandle);
+
+	if (!PostActorTickHandle.IsValid())
+	{
+		PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(this, &UCharacterAbilitySystemComponent::OnWorldPostActorTick);
+	}
+
+	return Listener.Handle;
+}
+
+void UCharacterAbilitySystemComponent::RemoveAttributeChangeListener(FDelegateHandle Handle)
+{
+	// While FlushAttributeChanges is iterating the listeners only unbind, it prunes them when it's done
+	if (!bFlushingAttributeChanges)
+	{
+		AttributeChangeListeners.RemoveAll([Handle](const FAttributeChangeListener& Listener) { return Listener.Handle == Handle; });
+		return;
+	}
+
+	for (FAttributeChangeListener& Listener : AttributeChangeListeners)
+	{
+		if (Listener.Handle == Handle)
+		{
+			Listener.Delegate.Unbind();
+		}
+	}
+}
+
+void UCharacterAbilitySystemComponent::FlushAttributeChanges()
+{
+	// A listener flushing again would have its changes delivered before the outer flush's remaining listeners
+	if (PendingAttributeChanges.Num() == 0 || bFlushingAttributeChanges)
+	{
+		return;
+	}
+
+	TGuardValue<bool> FlushingGuard(bFlushingAttributeChanges, true);
+
+	// Listeners may change attributes again, those changes go out with the next flush
+	TArray<FCharacterAttributeChange> Changes = MoveTemp(PendingAttributeChanges);
+	PendingAttributeChanges.Reset();
+
+	TArray<FCharacterAttributeChange> ListenerChanges;
+	for (int32 ListenerIndex = 0; ListenerIndex < AttributeChangeListeners.Num(); ++ListenerIndex)
+	{
+		ListenerChanges.Reset();
+		for (const FCharacterAttributeChange& Change : Changes)
+		{
+			if (AttributeChangeListeners[ListenerIndex].Attributes.Contains(Change.Attribute))
+			{
+				ListenerChanges.Add(Change);
 			}
 		}
+
+		if (ListenerChanges.Num() > 0)
+		{
+			// Copy the delegate, the listener array can grow while it runs
+			FOnAttributesChangedDelegate Delegate = AttributeChangeListeners[ListenerIndex].Delegate;
+			Delegate.ExecuteIfBound(ListenerChanges);
+		}
 	}
+
+	AttributeChangeListeners.RemoveAll([](const FAttributeChangeListener& Listener) { return !Listener.Delegate.IsBound(); });
 }
 
-void UCharacterAbilitySystemComponent::ClearAbilityBindings(UInputAction* InputAction)
+void UCharacterAbilitySystemComponent::QueueAttributeChanges(TConstArrayView<FCharacterAttributeChange> Changes)
 {
-	RemoveEntry(InputAction);
+	// Nothing flushes the bus without listeners
+	if (AttributeChangeListeners.Num() == 0)
+	{
+		return;
+	}
+
+	for (const FCharacterAttributeChange& NewChange : Changes)
+	{
+		FCharacterAttributeChange* PendingChange = PendingAttributeChanges.FindByPredicate(
+			[&NewChange](const FCharacterAttributeChange& Change) { return Change.Attribute == NewChange.Attribute; });
+		if (PendingChange)
+		{
+			PendingChange->NewValue = NewChange.NewValue;
+		}
+		else
+		{
+			PendingAttributeChanges.Add(NewChange);
+		}
+	}
 }
 
-void UCharacterAbilitySystemComponent::ReceiveDamage(UCharacterAbilitySystemComponent* SourceASC, float UnmitigatedDamage, float MitigatedDamage)
+void UCharacterAbilitySystemComponent::SetNumericAttributeBases(TConstArrayView<FGameplayAttribute> Attributes, TConstArrayView<float> Values)
 {
-    ReceivedDamage.Broadcast(SourceASC, UnmitigatedDamage, MitigatedDamage);
+	check(Attributes.Num() == Values.Num());
+
+	TArray<FCharacterAttributeChange> Changes;
+	Changes.Reserve(Attributes.Num());
+	for (const FGameplayAttribute& Attribute : Attributes)
+	{
+		FCharacterAttributeChange& Change = Changes.AddDefaulted_GetRef();
+		Change.Attribute = Attribute;
+		Change.OldValue = GetNumericAttribute(Attribute);
+	}
+
+	{
+		TGuardValue<bool> BatchingGuard(bBatchingAttributeChanges, true);
+		for (int32 Index = 0; Index < Attributes.Num(); ++Index)
+		{
+			SetNumericAttributeBase(Attributes[Index], Values[Index]);
+		}
+	}
+
+	// Current values, so clamping and active effects are already applied
+	for (int32 Index = Changes.Num() - 1; Index >= 0; --Index)
+	{
+		Changes[Index].NewValue = GetNumericAttribute(Changes[Index].Attribute);
+		if (Changes[Index].NewValue == Changes[Index].OldValue)
+		{
+			Changes.RemoveAt(Index, 1, false);
+		}
+	}
+
+	QueueAttributeChanges(Changes);
 }
 
-void UCharacterAbilitySystemComponent::OnAbilityInputPressed(UInputAction* InputAction)
+void UCharacterAbilitySystemComponent::OnAttributeValueChanged(const FOnAttributeChangeData& Data)
 {
-	using namespace EnhancedInputAbilitySystem_Impl;
+	if (bBatchingAttributeChanges)
+	{
+		return;
+	}
 
-	FAbilityInputBinding* FoundBinding = MappedAbilities.Find(InputAction);
-	if (FoundBinding && ensure(FoundBinding->InputID != InvalidInputID))
+	// Coalesce, keep the value from before the first change and update to the latest
+	for (FCharacterAttributeChange& Change : PendingAttributeChanges)
 	{
-		AbilityLocalInputPressed(FoundBinding->InputID);
-		UE_LOG(LogTemp, Warning, TEXT("ABility Pressed"));
+		if (Change.Attribute == Data.Attribute)
+		{
+			Change.NewValue = Data.NewValue;
+			return;
+		}
 	}
-	UE_LOG(LogTemp, Warning, TEXT("Ability activated"));
+
+	FCharacterAttributeChange& Change = PendingAttributeChanges.AddDefaulted_GetRef();
+	Change.Attribute = Data.Attribute;
+	Change.OldValue = Data.OldValue;
+	Change.NewValue = Data.NewValue;
 }
 
-void UCharacterAbilitySystemComponent::OnAbilityInputReleased(UInputAction* InputAction)
+void UCharacterAbilitySystemComponent::OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds)
 {
-	using namespace EnhancedInputAbilitySystem_Impl;
+	if (World == GetWorld())
+	{
+		FlushAttributeChanges();
+	}
+}
+
+void UCharacterAbilitySystemComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	PostActorTickHandle.Reset();
+
+	BufferedInputs.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UCharacterAbilitySystemComponent::OnAbilityInputPressed(int32 InputID)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCharacterAbilitySystemComponent::OnAbilityInputPressed);
+
+	if (!ensure(FindBinding(InputID)))
+	{
+		return;
+	}
+
+	++InputBufferStats.Pressed;
+
+	if (InputBufferWindow > 0.0f)
+	{
+		const FBufferedAbilityInput* LastBufferedInput = FindLastBufferedInput(InputID);
+		if (LastBufferedInput && LastBufferedInput->bPressed)
+		{
+			// Already waiting for this ability, a re-press doesn't need to go anywhere
+			++InputBufferStats.Coalesced;
+			return;
+		}
+
+		// Presses for a running ability that listens for them go straight through as its InputPressed event,
+		// otherwise they wait for it to end like presses for an ability that can't activate yet
+		FGameplayAbilitySpecHandle Handle;
+		const bool bWaitForAbility = HasAbilityWithInputID(InputID) && (IsAbilityWithInputIDActive(InputID)
+			? !IsAbilityWithInputIDWaitingForPress(InputID) : !CanActivateAbilityWithInputID(InputID, Handle));
+		if (LastBufferedInput || bWaitForAbility)
+		{
+			++InputBufferStats.Buffered;
+			BufferedInputs.Add({ InputID, GetWorld()->GetRealTimeSeconds(), true });
+			return;
+		}
+	}
+
+	AbilityLocalInputPressed(InputID);
+
+#if !UE_BUILD_SHIPPING
+	UE_LOG(LogWB2023Input, Verbose, TEXT("Ability input %d pressed"), InputID);
+#endif
+}
+
+void UCharacterAbilitySystemComponent::OnAbilityInputReleased(int32 InputID)
+{
+	if (!ensure(FindBinding(InputID)))
+	{
+		return;
+	}
+
+	// Keep the release behind its buffered press
+	if (const FBufferedAbilityInput* LastBufferedInput = FindLastBufferedInput(InputID))
+	{
+		if (LastBufferedInput->bPressed)
+		{
+			BufferedInputs.Add({ InputID, GetWorld()->GetRealTimeSeconds(), false });
+		}
+		return;
+	}
+
+	AbilityLocalInputReleased(InputID);
+}
+
+void UCharacterAbilitySystemComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (BufferedInputs.Num() > 0)
+	{
+		ProcessInputBuffer();
+	}
+}
+
+void UCharacterAbilitySystemComponent::ProcessInputBuffer()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCharacterAbilitySystemComponent::ProcessInputBuffer);
+
+	const double Now = GetWorld()->GetRealTimeSeconds();
+
+	// Inputs whose press is still waiting, their later events have to wait too
+	TArray<int32, TInlineAllocator<4>> BlockedInputIDs;
+
+	// The server RPCs of the replayed activations go out together, see CallServerTryActivateAbility
+	TGuardValue<bool> BatchingGuard(bBatchingBufferedActivations, true);
+
+	for (int32 Index = 0; Index < BufferedInputs.Num();)
+	{
+		const FBufferedAbilityInput Input = BufferedInputs[Index];
+		if (BlockedInputIDs.Contains(Input.InputID))
+		{
+			++Index;
+			continue;
+		}
+
+		// Input events replicate on their own, the activations they follow have to reach the server first
+		if (!Input.bPressed)
+		{
+			SendBufferedAbilityRPCBatches();
+			BufferedInputs.RemoveAt(Index);
+			AbilityLocalInputReleased(Input.InputID);
+			continue;
+		}
+
+		// Running and listening for presses now (activated some other way in the meantime), the press is its input event
+		// rather than a second activation later. A running ability that doesn't listen keeps the press until it ends
+		const bool bActive = IsAbilityWithInputIDActive(Input.InputID);
+		if (bActive && IsAbilityWithInputIDWaitingForPress(Input.InputID))
+		{
+			SendBufferedAbilityRPCBatches();
+			BufferedInputs.RemoveAt(Index);
+			AbilityLocalInputPressed(Input.InputID);
+			continue;
+		}
+
+		FGameplayAbilitySpecHandle Handle;
+		if (!bActive && CanActivateAbilityWithInputID(Input.InputID, Handle))
+		{
+			BufferedInputs.RemoveAt(Index);
+
+			++InputBufferStats.Replayed;
+			InputBufferStats.TotalReplayDelay += Now - Input.Timestamp;
+
+			AbilityLocalInputPressed(Input.InputID);
+			continue;
+		}
+
+		if (Now - Input.Timestamp > InputBufferWindow)
+		{
+			// The release that follows goes out on its own, releasing an inactive ability does nothing
+			BufferedInputs.RemoveAt(Index);
+			++InputBufferStats.Dropped;
+			continue;
+		}
+
+		BlockedInputIDs.Add(Input.InputID);
+		++Index;
+	}
+
+	SendBufferedAbilityRPCBatches();
+}
+
+void UCharacterAbilitySystemComponent::SendBufferedAbilityRPCBatches()
+{
+	if (BufferedAbilityRPCBatches.Num() > 0)
+	{
+		++InputBufferStats.ActivationRPCs;
+		ServerBufferedAbilityRPCBatch(BufferedAbilityRPCBatches);
+		BufferedAbilityRPCBatches.Reset();
+	}
+}
+
+void UCharacterAbilitySystemComponent::ServerBufferedAbilityRPCBatch_Implementation(const TArray<FServerAbilityRPCBatch>& Batches)
+{
+	for (FServerAbilityRPCBatch Batch : Batches)
+	{
+		ServerAbilityRPCBatch_Internal(Batch);
+	}
+}
+
+void UCharacterAbilitySystemComponent::CallServerTryActivateAbility(FGameplayAbilitySpecHandle AbilityToActivate, bool InputPressed, FPredictionKey PredictionKey)
+{
+	// Round trip of the predicted activation, until the server has caught up with its key or rejected it
+	if (PredictionKey.IsValidKey())
+	{
+		const double SendTime = GetWorld()->GetRealTimeSeconds();
+		PredictionKey.NewRejectOrCaughtUpDelegate(FPredictionKeyEvent::CreateWeakLambda(this, [this, SendTime]()
+		{
+			if (const UWorld* World = GetWorld())
+			{
+				++InputBufferStats.RoundTrips;
+				InputBufferStats.TotalRoundTripTime += World->GetRealTimeSeconds() - SendTime;
+			}
+		}));
+	}
 
-	FAbilityInputBinding* FoundBinding = MappedAbilities.Find(InputAction);
-	if (FoundBinding && ensure(FoundBinding->InputID != InvalidInputID))
+	if (bBatchingBufferedActivations)
 	{
-		AbilityLocalInputReleased(FoundBinding->InputID);
+		// The same ability activating again ends its batch, the server has to see the first activation end first
+		if (BufferedAbilityRPCBatches.FindByKey(AbilityToActivate))
+		{
+			SendBufferedAbilityRPCBatches();
+		}
+
+		FServerAbilityRPCBatch& Batch = BufferedAbilityRPCBatches.AddDefaulted_GetRef();
+		Batch.AbilitySpecHandle = AbilityToActivate;
+		Batch.InputPressed = InputPressed;
+		Batch.PredictionKey = PredictionKey;
+		Batch.Started = true;
+		return;
+	}
+
+	++InputBufferStats.ActivationRPCs;
+	Super::CallServerTryActivateAbility(AbilityToActivate, InputPressed, PredictionKey);
+}
+
+void UCharacterAbilitySystemComponent::CallServerSetReplicatedTargetData(FGameplayAbilitySpecHandle AbilityHandle, FPredictionKey AbilityOriginalPredictionKey,
+	const FGameplayAbilityTargetDataHandle& ReplicatedTargetDataHandle, FGameplayTag ApplicationTag, FPredictionKey CurrentPredictionKey)
+{
+	FServerAbilityRPCBatch* Batch = BufferedAbilityRPCBatches.FindByKey(AbilityHandle);
+	if (Batch && !Batch->TargetData.IsValid(0))
+	{
+		Batch->TargetData = ReplicatedTargetDataHandle;
+		return;
+	}
+
+	Super::CallServerSetReplicatedTargetData(AbilityHandle, AbilityOriginalPredictionKey, ReplicatedTargetDataHandle, ApplicationTag, CurrentPredictionKey);
+}
+
+void UCharacterAbilitySystemComponent::CallServerEndAbility(FGameplayAbilitySpecHandle AbilityHandle, FGameplayAbilityActivationInfo ActivationInfo, FPredictionKey PredictionKey)
+{
+	if (FServerAbilityRPCBatch* Batch = BufferedAbilityRPCBatches.FindByKey(AbilityHandle))
+	{
+		Batch->Ended = true;
+		return;
+	}
+
+	Super::CallServerEndAbility(AbilityHandle, ActivationInfo, PredictionKey);
+}
+
+bool UCharacterAbilitySystemComponent::CanActivateAbilityWithInputID(int32 InputID, FGameplayAbilitySpecHandle& OutHandle) const
+{
+	for (const FGameplayAbilitySpec& Spec : ActivatableAbilities.Items)
+	{
+		if (Spec.InputID == InputID && Spec.Ability && !Spec.IsActive()
+			&& Spec.Ability->CanActivateAbility(Spec.Handle, AbilityActorInfo.Get()))
+		{
+			OutHandle = Spec.Handle;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool UCharacterAbilitySystemComponent::HasAbilityWithInputID(int32 InputID) const
+{
+	for (const FGameplayAbilitySpec& Spec : ActivatableAbilities.Items)
+	{
+		if (Spec.InputID == InputID)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool UCharacterAbilitySystemComponent::IsAbilityWithInputIDActive(int32 InputID) const
+{
+	for (const FGameplayAbilitySpec& Spec : ActivatableAbilities.Items)
+	{
+		if (Spec.InputID == InputID && Spec.IsActive())
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool UCharacterAbilitySystemComponent::IsAbilityWithInputIDWaitingForPress(int32 InputID)
+{
+	for (const FGameplayAbilitySpec& Spec : ActivatableAbilities.Items)
+	{
+		// The event AbilityLocalInputPressed invokes for a running ability
+		if (Spec.InputID == InputID && Spec.IsActive()
+			&& AbilityReplicatedEventDelegate(EAbilityGenericReplicatedEvent::InputPressed, Spec.Handle, Spec.ActivationInfo.GetActivationPredictionKey()).IsBound())
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const UCharacterAbilitySystemComponent::FBufferedAbilityInput* UCharacterAbilitySystemComponent::FindLastBufferedInput(int32 InputID) const
+{
+	for (int32 Index = BufferedInputs.Num() - 1; Index >= 0; --Index)
+	{
+		if (BufferedInputs[Index].InputID == InputID)
+		{
+			return &BufferedInputs[Index];
+		}
 	}
+
+	return nullptr;
 }
 
 void UCharacterAbilitySystemComponent::RemoveEntry(UInputAction* InputAction)
 {
-	if (FAbilityInputBinding* Bindings = MappedAbilities.Find(InputAction))
+	using namespace EnhancedInputAbilitySystem_Impl;
+
+	int32 InputID = InvalidInputID;
+	if (!MappedAbilities.RemoveAndCopyValue(InputAction, InputID))
+	{
+		return;
+	}
+
+	if (FAbilityInputBinding* Bindings = FindBinding(InputID))
 	{
 		if (InputComponent)
 		{
@@ -139,37 +778,63 @@ void UCharacterAbilitySystemComponent::RemoveEntry(UInputAction* InputAction)
 
 		for (FGameplayAbilitySpecHandle AbilityHandle : Bindings->BoundAbilitiesStack)
 		{
-			using namespace EnhancedInputAbilitySystem_Impl;
-
 			FGameplayAbilitySpec* AbilitySpec = FindAbilitySpec(AbilityHandle);
-			if (AbilitySpec && AbilitySpec->InputID == Bindings->InputID)
+			if (AbilitySpec && AbilitySpec->InputID == InputID)
 			{
 				AbilitySpec->InputID = InvalidInputID;
 			}
+
+			AbilityHandleToInputID.Remove(AbilityHandle);
 		}
 
-		MappedAbilities.Remove(InputAction);
+		*Bindings = FAbilityInputBinding();
+		FreeInputIDs.Push(InputID);
+
+		// The ID may be handed to another action, its buffered events don't belong to it
+		BufferedInputs.RemoveAll([InputID](const FBufferedAbilityInput& Input) { return Input.InputID == InputID; });
 	}
 }
 
-void UCharacterAbilitySystemComponent::TryBindAbilityInput(UInputAction* InputAction, FAbilityInputBinding& AbilityInputBinding)
+void UCharacterAbilitySystemComponent::TryBindAbilityInput(FAbilityInputBinding& AbilityInputBinding)
 {
 	if (InputComponent)
 	{
 		// Pressed event
 		if (AbilityInputBinding.OnPressedHandle == 0)
 		{
-			AbilityInputBinding.OnPressedHandle = InputComponent->BindAction(InputAction, ETriggerEvent::Started, this, &UCharacterAbilitySystemComponent::OnAbilityInputPressed, InputAction).GetHandle();
+			AbilityInputBinding.OnPressedHandle = InputComponent->BindAction(AbilityInputBinding.InputAction, ETriggerEvent::Started, this, &UCharacterAbilitySystemComponent::OnAbilityInputPressed, AbilityInputBinding.InputID).GetHandle();
 		}
 
 		// Released event
 		if (AbilityInputBinding.OnReleasedHandle == 0)
 		{
-			AbilityInputBinding.OnReleasedHandle = InputComponent->BindAction(InputAction, ETriggerEvent::Completed, this, &UCharacterAbilitySystemComponent::OnAbilityInputReleased, InputAction).GetHandle();
+			AbilityInputBinding.OnReleasedHandle = InputComponent->BindAction(AbilityInputBinding.InputAction, ETriggerEvent::Completed, this, &UCharacterAbilitySystemComponent::OnAbilityInputReleased, AbilityInputBinding.InputID).GetHandle();
 		}
 	}
 }
 
+int32 UCharacterAbilitySystemComponent::AllocateInputID()
+{
+	using namespace EnhancedInputAbilitySystem_Impl;
+
+	const int32 InputID = FreeInputIDs.Num() > 0 ? FreeInputIDs.Pop(false) : FirstBindingInputID + InputBindings.AddDefaulted();
+	InputBindings[InputID - FirstBindingInputID].InputID = InputID;
+	return InputID;
+}
+
+FAbilityInputBinding* UCharacterAbilitySystemComponent::FindBinding(int32 InputID)
+{
+	using namespace EnhancedInputAbilitySystem_Impl;
+
+	const int32 Index = InputID - FirstBindingInputID;
+	if (InputBindings.IsValidIndex(Index) && InputBindings[Index].InputID == InputID)
+	{
+		return &InputBindings[Index];
+	}
+
+	return nullptr;
+}
+
 FGameplayAbilitySpec* UCharacterAbilitySystemComponent::FindAbilitySpec(FGameplayAbilitySpecHandle Handle)
 {
 	FGameplayAbilitySpec* FoundAbility = nullptr;
@@ -184,4 +849,24 @@ void UCharacterAbilitySystemComponent::BeginPlay()
 	if (IsValid(Owner) && Owner->InputComponent) {
 		InputComponent = CastChecked<UEnhancedInputComponent>(Owner->InputComponent);
 	}
+
+	OnGameplayEffectAppliedDelegateToSelf.AddUObject(this, &UCharacterAbilitySystemComponent::OnEffectAppliedToSelf);
+}
+
+void UCharacterAbilitySystemComponent::OnEffectAppliedToSelf(UAbilitySystemComponent* Source, const FGameplayEffectSpec& Spec, FActiveGameplayEffectHandle Handle)
+{
+	WB2023Metrics::EffectsApplied.Add();
+	WB2023_TRACE_EFFECT_APPLIED(GetAvatarActor(), Spec);
+}
+
+void UCharacterAbilitySystemComponent::OnRemoveAbility(FGameplayAbilitySpec& AbilitySpec)
+{
+	if (AbilityHandleToInputID.Contains(AbilitySpec.Handle))
+	{
+		ClearInputBinding(AbilitySpec.Handle);
+	}
+
+	RemoveActiveAbility(AbilitySpec.Handle, AbilitySpec.Ability);
+
+	Super::OnRemoveAbility(AbilitySpec);
 }
@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Character/Abilities/CharacterAttributeInitSubsystem.h"
+#include "Character/Abilities/AttributeSets/CharacterAttributeSetBase.h"
+#include "Character/Abilities/CharacterAbilitySystemComponent.h"
+#include "Algo/StableSort.h"
+#include "Curves/RealCurve.h"
+#include "Engine/CurveTable.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "WB2023/WB2023.h"
+
+namespace CharacterAttributeInit_Impl
+{
+	static UCharacterAttributeInitSubsystem* Get()
+	{
+		return GEngine ? GEngine->GetEngineSubsystem<UCharacterAttributeInitSubsystem>() : nullptr;
+	}
+
+	static FAutoConsoleCommand GroupsCommand(
+		TEXT("WB2023.AttributeInit.Groups"),
+		TEXT("Logs the attribute groups compiled from the attribute curve tables"),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			if (UCharacterAttributeInitSubsystem* AttributeInit = Get())
+			{
+				AttributeInit->LogGroups();
+			}
+		}));
+
+	static FAutoConsoleCommand ReloadCommand(
+		TEXT("WB2023.AttributeInit.Reload"),
+		TEXT("Compiles the attribute curve tables again, characters initialized from now on use the new values"),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			if (UCharacterAttributeInitSubsystem* AttributeInit = Get())
+			{
+				AttributeInit->CompileTables();
+			}
+		}));
+}
+
+bool UCharacterAttributeInitSubsystem::InitializeAttributes(UCharacterAbilitySystemComponent* AbilitySystemComponent, UCharacterAttributeSetBase* AttributeSet, FName Group, int32 Level)
+{
+	// Base values replicate, only the server writes them
+	if (!AbilitySystemComponent || !AttributeSet || Group.IsNone() || !AbilitySystemComponent->IsOwnerActorAuthoritative())
+	{
+		return false;
+	}
+
+	const FAttributeGroup* AttributeGroup = Groups.Find(Group);
+	if (!AttributeGroup || AttributeGroup->NumLevels == 0)
+	{
+		return false;
+	}
+
+	const int32 NumAttributes = AttributeGroup->Attributes.Num();
+	const int32 LevelIndex = FMath::Clamp(Level, 1, AttributeGroup->NumLevels) - 1;
+	const TConstArrayView<float> Values(AttributeGroup->Values.GetData() + LevelIndex * NumAttributes, NumAttributes);
+
+	// Attributes with an aggregator (active effects, or anything that captured them before, like the DamageExecution's
+	// Armor) keep their base value there, only SetNumericAttributeBase updates it and works out the current value.
+	// Attributes are in max-first order so Health and Mana are clamped against the new maximums
+	if (AttributeSet->HasAttributeAggregator(AttributeGroup->Attributes))
+	{
+		AbilitySystemComponent->SetNumericAttributeBases(AttributeGroup->Attributes, Values);
+		return true;
+	}
+
+	TArray<FCharacterAttributeChange> Changes;
+	Changes.Reserve(NumAttributes);
+	AttributeSet->InitializeBaseValues(AttributeGroup->Attributes, Values, Changes);
+	AbilitySystemComponent->QueueAttributeChanges(Changes);
+
+	return true;
+}
+
+bool UCharacterAttributeInitSubsystem::HasGroup(FName Group) const
+{
+	return Groups.Contains(Group);
+}
+
+void UCharacterAttributeInitSubsystem::LogGroups() const
+{
+	for (const TPair<FName, FAttributeGroup>& Pair : Groups)
+	{
+		FString AttributeNames;
+		for (const FGameplayAttribute& Attribute : Pair.Value.Attributes)
+		{
+			AttributeNames += AttributeNames.IsEmpty() ? Attribute.GetName() : TEXT(", ") + Attribute.GetName();
+		}
+
+		UE_LOG(LogWB2023Attribute, Display, TEXT("%s: %d levels of %s"), *Pair.Key.ToString(), Pair.Value.NumLevels, *AttributeNames);
+	}
+}
+
+void UCharacterAttributeInitSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// Loaded and evaluated up front so the first character spawned doesn't pay for it
+	CompileTables();
+}
+
+void UCharacterAttributeInitSubsystem::CompileTables()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCharacterAttributeInitSubsystem::CompileTables);
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	Groups.Reset();
+
+	// Curves of each group by attribute, tables listed later override earlier ones
+	TMap<FName, TMap<FGameplayAttribute, const FRealCurve*>> Rows;
+	for (const TSoftObjectPtr<UCurveTable>& CurveTablePtr : AttributeCurveTables)
+	{
+		if (const UCurveTable* CurveTable = CurveTablePtr.LoadSynchronous())
+		{
+			CompileTable(*CurveTable, Rows);
+		}
+		else
+		{
+			UE_LOG(LogWB2023Attribute, Warning, TEXT("Attribute curve table %s could not be loaded"), *CurveTablePtr.ToString());
+		}
+	}
+
+	for (const TPair<FName, TMap<FGameplayAttribute, const FRealCurve*>>& Row : Rows)
+	{
+		FAttributeGroup& Group = Groups.Add(Row.Key);
+		Row.Value.GenerateKeyArray(Group.Attributes);
+
+		// Maximums first, setting Health or Mana clamps them against the Max value already in the set
+		Algo::StableSortBy(Group.Attributes, [](const FGameplayAttribute& Attribute) { return !Attribute.GetName().StartsWith(TEXT("Max")); });
+
+		for (const TPair<FGameplayAttribute, const FRealCurve*>& Curve : Row.Value)
+		{
+			float MinTime = 0.0f;
+			float MaxTime = 0.0f;
+			Curve.Value->GetTimeRange(MinTime, MaxTime);
+			Group.NumLevels = FMath::Max(Group.NumLevels, FMath::FloorToInt(MaxTime));
+		}
+
+		// Evaluated once here, initializing is a copy of one level's slice
+		const int32 NumAttributes = Group.Attributes.Num();
+		Group.Values.SetNumUninitialized(Group.NumLevels * NumAttributes);
+		for (int32 LevelIndex = 0; LevelIndex < Group.NumLevels; ++LevelIndex)
+		{
+			for (int32 AttributeIndex = 0; AttributeIndex < NumAttributes; ++AttributeIndex)
+			{
+				Group.Values[LevelIndex * NumAttributes + AttributeIndex] = Row.Value[Group.Attributes[AttributeIndex]]->Eval(LevelIndex + 1);
+			}
+		}
+	}
+
+	UE_LOG(LogWB2023Attribute, Log, TEXT("Compiled %d attribute groups from %d curve tables in %.2fms"),
+		Groups.Num(), AttributeCurveTables.Num(), (FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
+
+void UCharacterAttributeInitSubsystem::CompileTable(const UCurveTable& CurveTable, TMap<FName, TMap<FGameplayAttribute, const FRealCurve*>>& OutRows) const
+{
+	for (const TPair<FName, FRealCurve*>& Row : CurveTable.GetRowMap())
+	{
+		const FString RowName = Row.Key.ToString();
+		int32 SeparatorIndex = INDEX_NONE;
+		if (!Row.Value || !RowName.FindLastChar(TEXT('.'), SeparatorIndex))
+		{
+			UE_LOG(LogWB2023Attribute, Warning, TEXT("%s: row %s is not named Group.Attribute"), *CurveTable.GetName(), *RowName);
+			continue;
+		}
+
+		const FString AttributeName = RowName.Mid(SeparatorIndex + 1);
+		FProperty* Property = FindFProperty<FProperty>(UCharacterAttributeSetBase::StaticClass(), *AttributeName);
+		if (!Property || !FGameplayAttribute::IsGameplayAttributeDataProperty(Property))
+		{
+			UE_LOG(LogWB2023Attribute, Warning, TEXT("%s: row %s names no UCharacterAttributeSetBase attribute"), *CurveTable.GetName(), *RowName);
+			continue;
+		}
+
+		OutRows.FindOrAdd(FName(RowName.Left(SeparatorIndex))).Add(FGameplayAttribute(Property), Row.Value);
+	}
+}
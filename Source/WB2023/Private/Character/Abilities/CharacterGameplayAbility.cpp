@@ -4,6 +4,7 @@
 #include "Character/Abilities/CharacterGameplayAbility.h"
 #include "AbilitySystemComponent.h"
 #include "GameplayTagContainer.h"
+#include "WB2023GameplayTags.h"
 
 UCharacterGameplayAbility::UCharacterGameplayAbility()
 {
@@ -11,8 +12,19 @@ UCharacterGameplayAbility::UCharacterGameplayAbility()
     InstancingPolicy = EGameplayAbilityInstancingPolicy::InstancedPerActor;
 
     // Blocks all abilities by state being dead or stunned
-    ActivationBlockedTags.AddTag(FGameplayTag::RequestGameplayTag(FName("State.Dead")));
-    ActivationBlockedTags.AddTag(FGameplayTag::RequestGameplayTag(FName("State.Debuff.Stun")));
+    ActivationBlockedTags.AddTag(WB2023GameplayTags::State_Dead);
+    ActivationBlockedTags.AddTag(WB2023GameplayTags::State_Debuff_Stun);
+}
+
+const FGameplayTagContainer& UCharacterGameplayAbility::GetAbilityTagsWithParents() const
+{
+    if (!bAbilityTagsWithParentsCached)
+    {
+        AbilityTagsWithParents = AbilityTags.GetGameplayTagParents();
+        bAbilityTagsWithParentsCached = true;
+    }
+
+    return AbilityTagsWithParents;
 }
 
 void UCharacterGameplayAbility::OnAvatarSet(const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilitySpec& Spec)
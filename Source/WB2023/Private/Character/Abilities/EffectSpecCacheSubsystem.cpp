@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Character/Abilities/EffectSpecCacheSubsystem.h"
+#include "AbilitySystemComponent.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "WB2023/WB2023.h"
+
+namespace EffectSpecCache_Impl
+{
+	static FAutoConsoleCommandWithWorld StatsCommand(
+		TEXT("WB2023.EffectSpecCache.Stats"),
+		TEXT("Logs the cached effect spec templates and how often they were reused"),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			if (UEffectSpecCacheSubsystem* Cache = World ? World->GetSubsystem<UEffectSpecCacheSubsystem>() : nullptr)
+			{
+				Cache->LogStats();
+			}
+		}));
+}
+
+FGameplayEffectSpecHandle UEffectSpecCacheSubsystem::MakeOutgoingSpec(UAbilitySystemComponent* AbilitySystemComponent, TSubclassOf<UGameplayEffect> EffectClass,
+	float Level, const FGameplayEffectContextHandle& Context)
+{
+	if (!AbilitySystemComponent)
+	{
+		return FGameplayEffectSpecHandle();
+	}
+
+	UWorld* World = AbilitySystemComponent->GetWorld();
+	if (UEffectSpecCacheSubsystem* Cache = World ? World->GetSubsystem<UEffectSpecCacheSubsystem>() : nullptr)
+	{
+		return Cache->MakeCachedOutgoingSpec(AbilitySystemComponent, EffectClass, Level, Context);
+	}
+
+	return AbilitySystemComponent->MakeOutgoingSpec(EffectClass, Level, Context);
+}
+
+FGameplayEffectSpecHandle UEffectSpecCacheSubsystem::MakeCachedOutgoingSpec(UAbilitySystemComponent* AbilitySystemComponent, TSubclassOf<UGameplayEffect> EffectClass,
+	float Level, const FGameplayEffectContextHandle& Context)
+{
+	if (!AbilitySystemComponent || !EffectClass)
+	{
+		return FGameplayEffectSpecHandle();
+	}
+
+	const FGameplayEffectContextHandle SpecContext = Context.IsValid() ? Context : AbilitySystemComponent->MakeEffectContext();
+
+	FSpecTemplate& Template = Templates.FindOrAdd(FSpecKey{ EffectClass.Get(), Level });
+	if (Template.Spec.IsValid() && Template.EffectClass.IsValid())
+	{
+		++NumHits;
+
+		// SetContext recaptures the source data for the new instigator
+		FGameplayEffectSpec* NewSpec = new FGameplayEffectSpec(*Template.Spec);
+		NewSpec->SetContext(SpecContext);
+		return FGameplayEffectSpecHandle(NewSpec);
+	}
+
+	++NumMisses;
+
+	FGameplayEffectSpecHandle NewHandle = AbilitySystemComponent->MakeOutgoingSpec(EffectClass, Level, SpecContext);
+	if (NewHandle.IsValid())
+	{
+		Template.EffectClass = EffectClass.Get();
+		Template.Spec = MakeShared<const FGameplayEffectSpec>(*NewHandle.Data);
+	}
+
+	return NewHandle;
+}
+
+void UEffectSpecCacheSubsystem::LogStats() const
+{
+	UE_LOG(LogWB2023Ability, Display, TEXT("EffectSpecCache: Templates=%d Hits=%d Misses=%d"), Templates.Num(), NumHits, NumMisses);
+
+	for (const TPair<FSpecKey, FSpecTemplate>& Pair : Templates)
+	{
+		UE_LOG(LogWB2023Ability, Display, TEXT("  %s level %.1f"), *GetNameSafe(Pair.Value.EffectClass.Get()), Pair.Key.Level);
+	}
+}
+
+void UEffectSpecCacheSubsystem::Deinitialize()
+{
+	Templates.Empty();
+
+	Super::Deinitialize();
+}
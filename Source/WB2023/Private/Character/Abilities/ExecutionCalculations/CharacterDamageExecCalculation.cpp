@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Character/Abilities/ExecutionCalculations/CharacterDamageExecCalculation.h"
+#include "Character/Abilities/AttributeSets/CharacterAttributeSetBase.h"
+#include "Character/Abilities/CharacterAbilitySystemComponent.h"
+#include "WB2023GameplayTags.h"
+#include "WB2023/WB2023.h"
+
+namespace CharacterDamageExecution_Impl
+{
+	// Declares the attributes to capture and how to capture them
+	struct FDamageStatics
+	{
+		DECLARE_ATTRIBUTE_CAPTUREDEF(Damage);
+		DECLARE_ATTRIBUTE_CAPTUREDEF(Armor);
+
+		FDamageStatics()
+		{
+			// Snapshot the source's Damage when the spec is made, the target's Armor when the spec is applied
+			DEFINE_ATTRIBUTE_CAPTUREDEF(UCharacterAttributeSetBase, Damage, Source, true);
+			DEFINE_ATTRIBUTE_CAPTUREDEF(UCharacterAttributeSetBase, Armor, Target, false);
+		}
+	};
+
+	static const FDamageStatics& DamageStatics()
+	{
+		static FDamageStatics DStatics;
+		return DStatics;
+	}
+}
+
+UCharacterDamageExecCalculation::UCharacterDamageExecCalculation()
+{
+	using namespace CharacterDamageExecution_Impl;
+
+	RelevantAttributesToCapture.Add(DamageStatics().DamageDef);
+	RelevantAttributesToCapture.Add(DamageStatics().ArmorDef);
+}
+
+void UCharacterDamageExecCalculation::Execute_Implementation(const FGameplayEffectCustomExecutionParameters& ExecutionParams, FGameplayEffectCustomExecutionOutput& OutExecutionOutput) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCharacterDamageExecCalculation::Execute_Implementation);
+	SCOPE_CYCLE_COUNTER(STAT_WB2023_DamageExecution);
+
+	using namespace CharacterDamageExecution_Impl;
+
+	UAbilitySystemComponent* TargetAbilitySystemComponent = ExecutionParams.GetTargetAbilitySystemComponent();
+	UAbilitySystemComponent* SourceAbilitySystemComponent = ExecutionParams.GetSourceAbilitySystemComponent();
+
+	const FGameplayEffectSpec& Spec = ExecutionParams.GetOwningSpec();
+
+	// Gather the tags from the source and target as that can affect which buffs should be used
+	FAggregatorEvaluateParameters EvaluationParameters;
+	EvaluationParameters.SourceTags = Spec.CapturedSourceTags.GetAggregatedTags();
+	EvaluationParameters.TargetTags = Spec.CapturedTargetTags.GetAggregatedTags();
+
+	float Armor = 0.0f;
+	ExecutionParams.AttemptCalculateCapturedAttributeMagnitude(DamageStatics().ArmorDef, EvaluationParameters, Armor);
+	Armor = FMath::Max<float>(Armor, 0.0f);
+
+	float CapturedDamage = 0.0f;
+	ExecutionParams.AttemptCalculateCapturedAttributeMagnitude(DamageStatics().DamageDef, EvaluationParameters, CapturedDamage);
+	CapturedDamage = FMath::Max<float>(CapturedDamage, 0.0f);
+
+	// SetByCaller damage is added on top of whatever the GE's calculation modifiers put into Damage
+	const float UnmitigatedDamage = CapturedDamage + FMath::Max<float>(Spec.GetSetByCallerMagnitude(WB2023GameplayTags::Data_Damage, false, 0.0f), 0.0f);
+
+	// Every point of Armor is 1% more effective health
+	const float MitigatedDamage = UnmitigatedDamage * (100.0f / (100.0f + Armor));
+
+	if (MitigatedDamage > 0.0f)
+	{
+		// Damage meta attribute is turned into -Health in UCharacterAttributeSetBase::PostGameplayEffectExecute
+		OutExecutionOutput.AddOutputModifier(FGameplayModifierEvaluatedData(DamageStatics().DamageProperty, EGameplayModOp::Additive, MitigatedDamage));
+	}
+
+	UCharacterAbilitySystemComponent* TargetASC = Cast<UCharacterAbilitySystemComponent>(TargetAbilitySystemComponent);
+	if (TargetASC)
+	{
+		UCharacterAbilitySystemComponent* SourceASC = Cast<UCharacterAbilitySystemComponent>(SourceAbilitySystemComponent);
+		TargetASC->ReceiveDamage(SourceASC, UnmitigatedDamage, MitigatedDamage);
+	}
+}
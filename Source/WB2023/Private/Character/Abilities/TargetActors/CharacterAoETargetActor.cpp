@@ -0,0 +1,280 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Character/Abilities/TargetActors/CharacterAoETargetActor.h"
+#include "Abilities/GameplayAbility.h"
+#include "Abilities/GameplayAbilityTargetTypes.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "WB2023/WB2023.h"
+
+namespace CharacterAoETargetActor_Impl
+{
+	// Line of sight is traced from this far above the center so the ground doesn't block it
+	constexpr float VisibilityTraceHeight = 50.0f;
+
+	// Async trace user data: the query in the high bits, the candidate index in the low ones
+	constexpr uint32 CandidateIndexBits = 16;
+	constexpr uint32 CandidateIndexMask = (1u << CandidateIndexBits) - 1;
+}
+
+ACharacterAoETargetActor::ACharacterAoETargetActor(const FObjectInitializer& ObjectInitializer) :
+	Super(ObjectInitializer)
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
+	// The client aims, the server gets the actor list
+	ShouldProduceTargetDataOnServer = false;
+
+	AimTraceDelegate.BindUObject(this, &ACharacterAoETargetActor::OnAimTraceDone);
+	OverlapDelegate.BindUObject(this, &ACharacterAoETargetActor::OnOverlapDone);
+	VisibilityTraceDelegate.BindUObject(this, &ACharacterAoETargetActor::OnVisibilityTraceDone);
+}
+
+void ACharacterAoETargetActor::StartTargeting(UGameplayAbility* Ability)
+{
+	Super::StartTargeting(Ability);
+
+	SourceActor = Ability ? Ability->GetCurrentActorInfo()->AvatarActor.Get() : nullptr;
+	TargetCenter = SourceActor ? SourceActor->GetActorLocation() : GetActorLocation();
+	bHasTargetCenter = false;
+	Targets.Reset();
+}
+
+void ACharacterAoETargetActor::ConfirmTargetingAndContinue()
+{
+	check(ShouldProduceTargetData());
+
+	if (IsConfirmTargetingAllowed())
+	{
+		TargetDataReadyDelegate.Broadcast(MakeTargetData());
+	}
+}
+
+void ACharacterAoETargetActor::Tick(float DeltaSeconds)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(ACharacterAoETargetActor::Tick);
+
+	Super::Tick(DeltaSeconds);
+
+	// Only the player aiming runs queries
+	if (!PrimaryPC || !PrimaryPC->IsLocalController())
+	{
+		return;
+	}
+
+	if (!bAimTracePending)
+	{
+		StartAimTrace();
+	}
+
+	if (!bQueryPending && bHasTargetCenter)
+	{
+		StartOverlap();
+	}
+	else if (NextCandidateIndex < Candidates.Num())
+	{
+		StartVisibilityTraces();
+	}
+}
+
+TArray<AActor*> ACharacterAoETargetActor::GetTargetActors() const
+{
+	TArray<AActor*> TargetActors;
+	TargetActors.Reserve(Targets.Num());
+	for (const TWeakObjectPtr<AActor>& Target : Targets)
+	{
+		if (AActor* TargetActor = Target.Get())
+		{
+			TargetActors.Add(TargetActor);
+		}
+	}
+
+	return TargetActors;
+}
+
+FGameplayAbilityTargetDataHandle ACharacterAoETargetActor::MakeTargetData() const
+{
+	FGameplayAbilityTargetData_ActorArray* TargetData = new FGameplayAbilityTargetData_ActorArray();
+	TargetData->SourceLocation.LocationType = EGameplayAbilityTargetingLocationType::LiteralTransform;
+	TargetData->SourceLocation.LiteralTransform = FTransform(TargetCenter);
+
+	TargetData->TargetActorArray.Reserve(Targets.Num());
+	for (const TWeakObjectPtr<AActor>& Target : Targets)
+	{
+		if (Target.IsValid())
+		{
+			TargetData->TargetActorArray.Add(Target);
+		}
+	}
+
+	return FGameplayAbilityTargetDataHandle(TargetData);
+}
+
+void ACharacterAoETargetActor::StartAimTrace()
+{
+	FVector ViewLocation;
+	FRotator ViewRotation;
+	PrimaryPC->GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+	// Reach past the source actor by MaxRange, the camera sits behind it
+	const float ViewDistance = SourceActor ? FVector::Dist(ViewLocation, SourceActor->GetActorLocation()) : 0.0f;
+	const FVector TraceEnd = ViewLocation + ViewRotation.Vector() * (ViewDistance + MaxRange);
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(AoETargetAim), false);
+	Params.AddIgnoredActor(SourceActor);
+	Params.AddIgnoredActor(this);
+
+	GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, ViewLocation, TraceEnd, ECC_Visibility, Params,
+		FCollisionResponseParams::DefaultResponseParam, &AimTraceDelegate);
+	bAimTracePending = true;
+}
+
+void ACharacterAoETargetActor::StartOverlap()
+{
+	const FCollisionObjectQueryParams ObjectParams = TargetObjectTypes.Num() > 0
+		? FCollisionObjectQueryParams(TargetObjectTypes)
+		: FCollisionObjectQueryParams(ECC_Pawn);
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(AoETargetOverlap), false);
+	if (bIgnoreSourceActor)
+	{
+		Params.AddIgnoredActor(SourceActor);
+	}
+
+	++QueryId;
+	GetWorld()->AsyncOverlapByObjectType(TargetCenter, FQuat::Identity, ObjectParams, FCollisionShape::MakeSphere(Radius), Params, &OverlapDelegate);
+	bQueryPending = true;
+}
+
+void ACharacterAoETargetActor::StartVisibilityTraces()
+{
+	using namespace CharacterAoETargetActor_Impl;
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(AoETargetVisibility), false);
+	Params.AddIgnoredActor(SourceActor);
+	Params.AddIgnoredActor(this);
+
+	const FVector TraceStart = TargetCenter + FVector(0.0f, 0.0f, VisibilityTraceHeight);
+	const int32 EndIndex = FMath::Min(NextCandidateIndex + MaxVisibilityTracesPerFrame, Candidates.Num());
+	for (; NextCandidateIndex < EndIndex; ++NextCandidateIndex)
+	{
+		const AActor* Candidate = Candidates[NextCandidateIndex].Get();
+		if (!Candidate)
+		{
+			continue;
+		}
+
+		const uint32 UserData = (static_cast<uint32>(QueryId) << CandidateIndexBits) | static_cast<uint32>(NextCandidateIndex);
+		GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, TraceStart, Candidate->GetActorLocation(), VisibilityChannel, Params,
+			FCollisionResponseParams::DefaultResponseParam, &VisibilityTraceDelegate, UserData);
+		++NumVisibilityTracesPending;
+	}
+
+	if (NextCandidateIndex >= Candidates.Num() && NumVisibilityTracesPending == 0)
+	{
+		FinishQuery(VisibleCandidates);
+	}
+}
+
+void ACharacterAoETargetActor::FinishQuery(TArray<TWeakObjectPtr<AActor>>& NewTargets)
+{
+	bQueryPending = false;
+
+	const bool bChanged = NewTargets.Num() != Targets.Num()
+		|| NewTargets.ContainsByPredicate([this](const TWeakObjectPtr<AActor>& Target) { return !Targets.Contains(Target); });
+
+	// Swap so both buffers keep their allocations for the next query
+	Swap(Targets, NewTargets);
+
+	if (bChanged)
+	{
+		OnTargetsChanged();
+	}
+}
+
+void ACharacterAoETargetActor::OnAimTraceDone(const FTraceHandle& Handle, FTraceDatum& Datum)
+{
+	bAimTracePending = false;
+
+	if (Datum.OutHits.Num() == 0 || !Datum.OutHits[0].bBlockingHit)
+	{
+		return;
+	}
+
+	FVector Center = Datum.OutHits[0].ImpactPoint;
+	if (SourceActor)
+	{
+		const FVector SourceLocation = SourceActor->GetActorLocation();
+		const FVector2D Offset(Center - SourceLocation);
+		if (Offset.SizeSquared() > FMath::Square(MaxRange))
+		{
+			const FVector2D Clamped = Offset.GetSafeNormal() * MaxRange;
+			Center.X = SourceLocation.X + Clamped.X;
+			Center.Y = SourceLocation.Y + Clamped.Y;
+		}
+	}
+
+	TargetCenter = Center;
+	bHasTargetCenter = true;
+	SetActorLocation(TargetCenter);
+}
+
+void ACharacterAoETargetActor::OnOverlapDone(const FTraceHandle& Handle, FOverlapDatum& Datum)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(ACharacterAoETargetActor::OnOverlapDone);
+
+	Candidates.Reset();
+	for (const FOverlapResult& Overlap : Datum.OutOverlaps)
+	{
+		// Several components of one actor can overlap
+		if (AActor* OverlapActor = Overlap.GetActor())
+		{
+			Candidates.AddUnique(OverlapActor);
+		}
+	}
+
+	if (!bRequireLineOfSight)
+	{
+		FinishQuery(Candidates);
+		return;
+	}
+
+	// The line of sight traces start in the next Tick, spread over frames when there are many candidates
+	VisibleCandidates.Reset();
+	NextCandidateIndex = 0;
+	NumVisibilityTracesPending = 0;
+	if (Candidates.Num() == 0)
+	{
+		FinishQuery(VisibleCandidates);
+	}
+}
+
+void ACharacterAoETargetActor::OnVisibilityTraceDone(const FTraceHandle& Handle, FTraceDatum& Datum)
+{
+	using namespace CharacterAoETargetActor_Impl;
+
+	if ((Datum.UserData >> CandidateIndexBits) != QueryId)
+	{
+		return;
+	}
+
+	--NumVisibilityTracesPending;
+
+	const int32 CandidateIndex = static_cast<int32>(Datum.UserData & CandidateIndexMask);
+	if (Candidates.IsValidIndex(CandidateIndex))
+	{
+		const TWeakObjectPtr<AActor>& Candidate = Candidates[CandidateIndex];
+		const bool bBlocked = Datum.OutHits.Num() > 0 && Datum.OutHits[0].bBlockingHit && Datum.OutHits[0].GetActor() != Candidate.Get();
+		if (!bBlocked && Candidate.IsValid())
+		{
+			VisibleCandidates.Add(Candidate);
+		}
+	}
+
+	if (NextCandidateIndex >= Candidates.Num() && NumVisibilityTracesPending == 0)
+	{
+		FinishQuery(VisibleCandidates);
+	}
+}
@@ -5,22 +5,125 @@
 #include "Character/Abilities/AttributeSets/CharacterAttributeSetBase.h"
 #include "Character/Abilities/CharacterAbilitySystemComponent.h"
 #include "Character/Abilities/CharacterGameplayAbility.h"
+#include "Character/Abilities/EffectSpecCacheSubsystem.h"
+#include "Character/Abilities/CharacterAttributeInitSubsystem.h"
+#include "Character/CharacterTickSubsystem.h"
+#include "Character/CharacterPoolSubsystem.h"
+#include "Character/CharacterSpatialHashSubsystem.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Animation/AnimInstance.h"
+#include "Animation/AnimMontage.h"
+#include "Particles/ParticleSystem.h"
+#include "Engine/Engine.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "SignificanceManager.h"
+#include "TheAssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "WB2023GameplayTags.h"
+#include "WB2023Trace.h"
+#include "Metrics/WB2023Metrics.h"
+
+namespace CharBase_Impl
+{
+	static void UpdateSignificanceStat(ECharacterSignificance Bucket, bool bAdd)
+	{
+		switch (Bucket)
+		{
+		case ECharacterSignificance::Low:
+			if (bAdd) { INC_DWORD_STAT(STAT_LowSignificanceCharacters); } else { DEC_DWORD_STAT(STAT_LowSignificanceCharacters); }
+			break;
+		case ECharacterSignificance::Medium:
+			if (bAdd) { INC_DWORD_STAT(STAT_MediumSignificanceCharacters); } else { DEC_DWORD_STAT(STAT_MediumSignificanceCharacters); }
+			break;
+		case ECharacterSignificance::High:
+			if (bAdd) { INC_DWORD_STAT(STAT_HighSignificanceCharacters); } else { DEC_DWORD_STAT(STAT_HighSignificanceCharacters); }
+			break;
+		default:
+			if (bAdd) { INC_DWORD_STAT(STAT_CriticalSignificanceCharacters); } else { DEC_DWORD_STAT(STAT_CriticalSignificanceCharacters); }
+			break;
+		}
+	}
+
+	static void LogCosmeticsMemory(UWorld* World, bool bMeasureUnloaded)
+	{
+		struct FClassReport
+		{
+			int32 NumCharacters = 0;
+			int32 NumRequested = 0;
+		};
+
+		TMap<UClass*, FClassReport> Reports;
+		for (TActorIterator<ACharBase> It(World); It; ++It)
+		{
+			FClassReport& Report = Reports.FindOrAdd(It->GetClass());
+			++Report.NumCharacters;
+			Report.NumRequested += It->AreCosmeticsRequested() ? 1 : 0;
+		}
+
+		for (const TPair<UClass*, FClassReport>& Pair : Reports)
+		{
+			TArray<FSoftObjectPath> CosmeticAssets;
+			Pair.Key->GetDefaultObject<ACharBase>()->GetCosmeticAssets(CosmeticAssets);
+
+			int64 ResidentBytes = 0;
+			int64 UnloadedBytes = 0;
+			int32 NumUnmeasured = 0;
+			for (const FSoftObjectPath& Path : CosmeticAssets)
+			{
+				if (const UObject* Asset = Path.ResolveObject())
+				{
+					ResidentBytes += Asset->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+				}
+				else if (const UObject* LoadedAsset = bMeasureUnloaded ? Path.TryLoad() : nullptr)
+				{
+					UnloadedBytes += LoadedAsset->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+				}
+				else
+				{
+					++NumUnmeasured;
+				}
+			}
+
+			// With hard references every cosmetic would be resident as long as any character of the class exists
+			const FClassReport& Report = Pair.Value;
+			UE_LOG(LogWB2023, Display, TEXT("%s: %d characters, %d with cosmetics requested. Cosmetics resident=%.1fKB saved=%.1fKB (%.1fKB per character)%s"),
+				*GetNameSafe(Pair.Key), Report.NumCharacters, Report.NumRequested, ResidentBytes / 1024.0, UnloadedBytes / 1024.0,
+				UnloadedBytes / 1024.0 / Report.NumCharacters,
+				NumUnmeasured > 0 ? *FString::Printf(TEXT(", %d unloaded assets not measured"), NumUnmeasured) : TEXT(""));
+		}
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs CosmeticsMemoryCommand(
+		TEXT("WB2023.Cosmetics.Memory"),
+		TEXT("Logs the cosmetic assets resident per character class and the memory kept out by not loading the rest.\n")
+		TEXT("Usage: WB2023.Cosmetics.Memory [measure]. measure loads the unloaded cosmetics synchronously to size them"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			if (World)
+			{
+				LogCosmeticsMemory(World, Args.Num() > 0 && Args[0] == TEXT("measure"));
+			}
+		}));
+}
 
 // Sets default values
 ACharBase::ACharBase(const class FObjectInitializer& ObjectInitializer) :
 	Super(ObjectInitializer.SetDefaultSubobjectClass<UCharacterMovementComponent>(ACharacter::CharacterMovementComponentName))
 {
- 	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
+	// Per frame character work runs batched in UCharacterTickSubsystem. Blueprints that need Tick can still enable it
 	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
 
 	GetCapsuleComponent()->SetCollisionResponseToChannel(ECollisionChannel::ECC_Visibility, ECollisionResponse::ECR_Overlap);
 
-	bAlwaysRelevant = true;
+	// Lets the engine skip anim updates by screen size on top of the significance buckets
+	GetMesh()->bEnableUpdateRateOptimizations = true;
 
-	DeadTag = FGameplayTag::RequestGameplayTag(FName("State.Dead"));
-	EffectRemoveOnDeathTag = FGameplayTag::RequestGameplayTag(FName("State.RemoveOnDeath"));
+	DeadTag = WB2023GameplayTags::State_Dead;
+	EffectRemoveOnDeathTag = WB2023GameplayTags::State_RemoveOnDeath;
 
 }
 
@@ -44,26 +147,16 @@ int32 ACharBase::GetAbilityLevel(CharAbilityID AbilityID) const
 /// </summary>
 void ACharBase::RemoveCharacterAbilities()
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(ACharBase::RemoveCharacterAbilities);
+	SCOPE_CYCLE_COUNTER(STAT_WB2023_RevokeAbilities);
+
 	if (GetLocalRole() != ROLE_Authority || !AbilitySystemComponent.IsValid()
 		|| !AbilitySystemComponent->CharacterAbilitiesGiven)
 	{
 		return;
 	}
 
-	TArray<FGameplayAbilitySpecHandle> AbilitiesToRemove;
-	for (const FGameplayAbilitySpec& Spec : AbilitySystemComponent->GetActivatableAbilities())
-	{
-		if ((Spec.SourceObject == this) && CharacterAbilities.Contains(Spec.Ability->GetClass()))
-		{
-			// Spec.handle is an instance of an ability
-			AbilitiesToRemove.Add(Spec.Handle);
-		}
-	}
-
-	for (int32 i = 0; i < AbilitiesToRemove.Num(); i++)
-	{
-		AbilitySystemComponent->ClearAbility(AbilitiesToRemove[i]);
-	}
+	GrantedHandles.RemoveAbilities(AbilitySystemComponent.Get());
 
 	// Set to false so they can get the abilities back
 	AbilitySystemComponent->CharacterAbilitiesGiven = false;
@@ -121,8 +214,19 @@ float ACharBase::GetMaxMana() const
 
 void ACharBase::Die()
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(ACharBase::Die);
+	SCOPE_CYCLE_COUNTER(STAT_WB2023_Die);
+
+	WB2023Metrics::Deaths.Add();
+	WB2023_TRACE_DIED(this);
+
 	RemoveCharacterAbilities();
 
+	if (UCharacterSpatialHashSubsystem* SpatialHash = GetWorld()->GetSubsystem<UCharacterSpatialHashSubsystem>())
+	{
+		SpatialHash->MarkDead(this);
+	}
+
 	GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 	GetCharacterMovement()->GravityScale = 0;
 	GetCharacterMovement()->Velocity = FVector(0);
@@ -131,7 +235,7 @@ void ACharBase::Die()
 
 	if (AbilitySystemComponent.IsValid())
 	{
-		AbilitySystemComponent->CancelAbilities();
+		AbilitySystemComponent->CancelActiveAbilities();
 
 		FGameplayTagContainer EffectsTagsToRemove;
 		EffectsTagsToRemove.AddTag(EffectRemoveOnDeathTag);
@@ -139,9 +243,14 @@ void ACharBase::Die()
 		AbilitySystemComponent->AddLooseGameplayTag(DeadTag);
 	 }
 
-	if (DeathMontage)
+	if (UAnimMontage* LoadedDeathMontage = DeathMontage.Get())
 	{
-		PlayAnimMontage(DeathMontage);
+		PlayAnimMontage(LoadedDeathMontage);
+	}
+	else if (!DeathMontage.IsNull() && DeathFallbackDuration > 0.0f)
+	{
+		// Not loaded (dedicated server, or the character never got significant), still give the death its time
+		GetWorldTimerManager().SetTimer(DeathFallbackTimerHandle, this, &ACharBase::FinishDying, DeathFallbackDuration, false);
 	}
 	else
 	{
@@ -152,17 +261,383 @@ void ACharBase::Die()
 
  void ACharBase::FinishDying()
  {
-	 Destroy();
+	UCharacterPoolSubsystem* CharacterPool = GetWorld()->GetSubsystem<UCharacterPoolSubsystem>();
+	if (bReturnToPoolOnDeath && CharacterPool && HasAuthority() && !IsPlayerControlled())
+	{
+		CharacterPool->ReleaseCharacter(this);
+	}
+	else
+	{
+		Destroy();
+	}
  }
 
+void ACharBase::DeactivateToPool()
+{
+	if (bInPool)
+	{
+		return;
+	}
+
+	ResetForPool();
+
+	// The controller and its PlayerState (which owns the ASC) don't come along, a new life gets a new controller.
+	// AI controllers with a PlayerState would stay around inactive, so destroy them here
+	AController* OldController = GetController();
+	DetachFromControllerPendingDestroy();
+	if (OldController && !OldController->IsPlayerController())
+	{
+		OldController->Destroy();
+	}
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	GetCharacterMovement()->StopMovementImmediately();
+	GetCharacterMovement()->DisableMovement();
+	GetCharacterMovement()->SetComponentTickEnabled(false);
+	GetMesh()->SetComponentTickEnabled(false);
+
+	if (UCharacterTickSubsystem* CharacterTickSubsystem = GetWorld()->GetSubsystem<UCharacterTickSubsystem>())
+	{
+		CharacterTickSubsystem->UnregisterCharacter(this);
+	}
+
+	if (UCharacterSpatialHashSubsystem* SpatialHash = GetWorld()->GetSubsystem<UCharacterSpatialHashSubsystem>())
+	{
+		SpatialHash->UnregisterCharacter(this);
+	}
+
+	// Not scored or counted while hidden in the pool, comes back Critical like a newly spawned character
+	if (UnregisterSignificance())
+	{
+		Significance = ECharacterSignificance::Critical;
+		GetMesh()->VisibilityBasedAnimTickOption = DefaultAnimTickOption;
+		GetMesh()->SetComponentTickInterval(0.0f);
+	}
+
+	// Replicate the hidden state once, then stop considering the character for replication
+	ForceNetUpdate();
+	SetNetDormancy(DORM_DormantAll);
+
+	bInPool = true;
+	UpdateCosmeticsLoad();
+}
+
+void ACharBase::ActivateFromPool(const FTransform& SpawnTransform)
+{
+	if (!bInPool)
+	{
+		return;
+	}
+
+	bInPool = false;
+
+	SetNetDormancy(DORM_Awake);
+	SetActorLocationAndRotation(SpawnTransform.GetLocation(), SpawnTransform.GetRotation(), false, nullptr, ETeleportType::ResetPhysics);
+
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	GetCapsuleComponent()->SetCollisionEnabled(DefaultCapsuleCollision);
+	GetCharacterMovement()->SetComponentTickEnabled(true);
+	GetCharacterMovement()->SetDefaultMovementMode();
+	GetMesh()->SetComponentTickEnabled(true);
+
+	if (UCharacterTickSubsystem* CharacterTickSubsystem = GetWorld()->GetSubsystem<UCharacterTickSubsystem>())
+	{
+		CharacterTickSubsystem->RegisterCharacter(this);
+	}
+
+	if (UCharacterSpatialHashSubsystem* SpatialHash = GetWorld()->GetSubsystem<UCharacterSpatialHashSubsystem>())
+	{
+		SpatialHash->RegisterCharacter(this);
+	}
+
+	RegisterSignificance();
+	UpdateCosmeticsLoad();
+}
+
+void ACharBase::ResetForPool()
+{
+	if (AbilitySystemComponent.IsValid())
+	{
+		AbilitySystemComponent->CancelAllAbilities();
+		RemoveCharacterAbilities();
+		GrantedHandles.RemoveEffects(AbilitySystemComponent.Get());
+
+		// Let the next possession give abilities and startup effects again
+		AbilitySystemComponent->CharacterAbilitiesGiven = false;
+		AbilitySystemComponent->StartupEffectsApplied = false;
+		AbilitySystemComponent->SetTagMapCount(DeadTag, 0);
+	}
+
+	AbilitySystemComponent.Reset();
+	AttributeSetBase.Reset();
+
+	InitializedAttributesASC = nullptr;
+	InitializedAttributesEffect = nullptr;
+	InitializedAttributesLevel = INDEX_NONE;
+
+	StopAnimMontage();
+	GetWorldTimerManager().ClearTimer(DeathFallbackTimerHandle);
+
+	GetCharacterMovement()->GravityScale = DefaultGravityScale;
+	GetCharacterMovement()->Velocity = FVector::ZeroVector;
+	GetCapsuleComponent()->SetCollisionEnabled(DefaultCapsuleCollision);
+}
+
 // Called when the game starts or when spawned
 void ACharBase::BeginPlay()
 {
 	Super::BeginPlay();
+
+	DefaultGravityScale = GetCharacterMovement()->GravityScale;
+	DefaultCapsuleCollision = GetCapsuleComponent()->GetCollisionEnabled();
+
+	if (UCharacterTickSubsystem* CharacterTickSubsystem = GetWorld()->GetSubsystem<UCharacterTickSubsystem>())
+	{
+		CharacterTickSubsystem->RegisterCharacter(this);
+	}
+
+	if (UCharacterSpatialHashSubsystem* SpatialHash = GetWorld()->GetSubsystem<UCharacterSpatialHashSubsystem>())
+	{
+		SpatialHash->RegisterCharacter(this);
+	}
+
+	DefaultAnimTickOption = GetMesh()->VisibilityBasedAnimTickOption;
+
+	// Nothing renders on a dedicated server, only montages need to evaluate (notifies, root motion)
+	if (IsNetMode(NM_DedicatedServer))
+	{
+		GetMesh()->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered;
+		return;
+	}
+
+	// Starts out Critical, the significance manager releases them again if the character isn't worth it
+	UpdateCosmeticsLoad();
+
+	RegisterSignificance();
+}
+
+void ACharBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UCharacterTickSubsystem* CharacterTickSubsystem = GetWorld()->GetSubsystem<UCharacterTickSubsystem>())
+	{
+		CharacterTickSubsystem->UnregisterCharacter(this);
+	}
+
+	if (UCharacterSpatialHashSubsystem* SpatialHash = GetWorld()->GetSubsystem<UCharacterSpatialHashSubsystem>())
+	{
+		SpatialHash->UnregisterCharacter(this);
+	}
+
+	UnregisterSignificance();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ACharBase::RegisterSignificance()
+{
+	USignificanceManager* SignificanceManager = FSignificanceManagerModule::Get(GetWorld());
+	if (!SignificanceManager || IsNetMode(NM_DedicatedServer) || SignificanceManager->GetManagedObject(this))
+	{
+		return;
+	}
+
+	CharBase_Impl::UpdateSignificanceStat(Significance, true);
+
+	SignificanceManager->RegisterObject(this, CharacterSignificance::Tag,
+		[](USignificanceManager::FManagedObjectInfo* ObjectInfo, const FTransform& Viewpoint) -> float
+		{
+			return CastChecked<ACharBase>(ObjectInfo->GetObject())->CalculateSignificance(Viewpoint);
+		},
+		USignificanceManager::EPostSignificanceType::Sequential,
+		[](USignificanceManager::FManagedObjectInfo* ObjectInfo, float OldSignificance, float NewSignificance, bool bFinal)
+		{
+			CastChecked<ACharBase>(ObjectInfo->GetObject())->ApplySignificance(CharacterSignificance::GetBucket(NewSignificance));
+		});
+}
+
+bool ACharBase::UnregisterSignificance()
+{
+	USignificanceManager* SignificanceManager = FSignificanceManagerModule::Get(GetWorld());
+	if (!SignificanceManager || !SignificanceManager->GetManagedObject(this))
+	{
+		return false;
+	}
+
+	CharBase_Impl::UpdateSignificanceStat(Significance, false);
+	SignificanceManager->UnregisterObject(this);
+	return true;
+}
+
+void ACharBase::PossessedBy(AController* NewController)
+{
+	Super::PossessedBy(NewController);
+
+	PreloadAbilityAssets();
+}
+
+void ACharBase::PreloadAbilityAssets() const
+{
+	if (AbilitySet && UAssetManager::IsInitialized())
+	{
+		UTheAssetManager::Get().PreloadCharacterKit(AbilitySet);
+	}
+}
+
+float ACharBase::CalculateSignificance(const FTransform& Viewpoint) const
+{
+	// The local player's characters and anything playing a montage (attacks, DeathMontage) always run at full rate.
+	// AI controllers are local on the authority too, so IsLocallyControlled alone would make every enemy Critical
+	if (IsPlayerControlled() && IsLocallyControlled())
+	{
+		return CharacterSignificance::CriticalSignificance;
+	}
+
+	const UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
+	if (AnimInstance && AnimInstance->IsAnyMontagePlaying())
+	{
+		return CharacterSignificance::CriticalSignificance;
+	}
+
+	const float Distance = FVector::Dist(Viewpoint.GetLocation(), GetActorLocation());
+	float Score = SignificanceDistanceScale / (SignificanceDistanceScale + Distance);
+
+	if (!WasRecentlyRendered(0.2f))
+	{
+		Score *= 0.25f;
+	}
+
+	if (AbilitySystemComponent.IsValid() && GetWorld()->GetTimeSeconds() - AbilitySystemComponent->GetLastCombatTime() < SignificanceCombatWindow)
+	{
+		Score += CharacterSignificance::HighSignificance;
+	}
+
+	return Score;
+}
+
+void ACharBase::ApplySignificance(ECharacterSignificance NewSignificance)
+{
+	if (NewSignificance == Significance)
+	{
+		return;
+	}
+
+	CharBase_Impl::UpdateSignificanceStat(Significance, false);
+	CharBase_Impl::UpdateSignificanceStat(NewSignificance, true);
+
+	Significance = NewSignificance;
+
+	USkeletalMeshComponent* MeshComponent = GetMesh();
+	switch (Significance)
+	{
+	case ECharacterSignificance::Low:
+		MeshComponent->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered;
+		MeshComponent->SetComponentTickInterval(LowSignificanceAnimTickInterval);
+		break;
+	case ECharacterSignificance::Medium:
+		MeshComponent->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickPoseWhenRendered;
+		MeshComponent->SetComponentTickInterval(MediumSignificanceAnimTickInterval);
+		break;
+	default:
+		MeshComponent->VisibilityBasedAnimTickOption = DefaultAnimTickOption;
+		MeshComponent->SetComponentTickInterval(0.0f);
+		break;
+	}
+
+	UpdateCosmeticsLoad();
+}
+
+UAnimMontage* ACharBase::GetLoadedDeathMontage() const
+{
+	return DeathMontage.Get();
+}
+
+void ACharBase::LoadDeathMontage(const FCharacterMontageLoadedDelegate& OnLoaded)
+{
+	if (DeathMontage.IsNull() || DeathMontage.IsValid() || IsNetMode(NM_DedicatedServer))
+	{
+		OnLoaded.ExecuteIfBound(DeathMontage.Get());
+		return;
+	}
+
+	// The handle is released once the callback runs, the caller keeps the montage alive while it uses it
+	UAssetManager::GetStreamableManager().RequestAsyncLoad(DeathMontage.ToSoftObjectPath(),
+		FStreamableDelegate::CreateWeakLambda(this, [this, OnLoaded]()
+		{
+			OnLoaded.ExecuteIfBound(DeathMontage.Get());
+		}), FStreamableManager::AsyncLoadHighPriority, false, false, TEXT("CharacterDeathMontage"));
+}
+
+UAnimMontage* ACharBase::GetLoadedHitReactMontage() const
+{
+	return HitReactMontage.Get();
+}
+
+UAnimMontage* ACharBase::GetLoadedAttackMontage(int32 Index) const
+{
+	return AttackMontages.IsValidIndex(Index) ? AttackMontages[Index].Get() : nullptr;
+}
+
+UFXSystemAsset* ACharBase::GetLoadedDeathFX() const
+{
+	return DeathFX.Get();
+}
+
+void ACharBase::GetCosmeticAssets(TArray<FSoftObjectPath>& OutAssets) const
+{
+	auto AddAsset = [&OutAssets](const FSoftObjectPath& Path)
+	{
+		if (!Path.IsNull())
+		{
+			OutAssets.AddUnique(Path);
+		}
+	};
+
+	AddAsset(DeathMontage.ToSoftObjectPath());
+	AddAsset(HitReactMontage.ToSoftObjectPath());
+	for (const TSoftObjectPtr<UAnimMontage>& AttackMontage : AttackMontages)
+	{
+		AddAsset(AttackMontage.ToSoftObjectPath());
+	}
+	AddAsset(DeathFX.ToSoftObjectPath());
+}
+
+void ACharBase::UpdateCosmeticsLoad()
+{
+	const bool bWantCosmetics = !bInPool && !IsNetMode(NM_DedicatedServer) && Significance != ECharacterSignificance::Low;
+	if (bWantCosmetics == CosmeticsHandle.IsValid())
+	{
+		return;
+	}
+
+	if (!bWantCosmetics)
+	{
+		// Unloaded by the next GC unless another character of the class still holds them
+		CosmeticsHandle->ReleaseHandle();
+		CosmeticsHandle.Reset();
+		return;
+	}
+
+	TArray<FSoftObjectPath> CosmeticAssets;
+	GetCosmeticAssets(CosmeticAssets);
+	if (CosmeticAssets.Num() > 0)
+	{
+		CosmeticsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(MoveTemp(CosmeticAssets), FStreamableDelegate(),
+			FStreamableManager::DefaultAsyncLoadPriority, false, false, TEXT("CharacterCosmetics"));
+	}
+}
+
+float ACharBase::GetAnimTickInterval() const
+{
+	return GetMesh()->GetComponentTickInterval();
 }
 
 void ACharBase::AddCharacterAbilities()
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(ACharBase::AddCharacterAbilities);
+	SCOPE_CYCLE_COUNTER(STAT_WB2023_GrantAbilities);
+
 	if (GetLocalRole() != ROLE_Authority || !AbilitySystemComponent.IsValid()
 		|| AbilitySystemComponent->CharacterAbilitiesGiven)
 	{
@@ -171,7 +646,12 @@ void ACharBase::AddCharacterAbilities()
 	for (TSubclassOf<UCharacterGameplayAbility>& StartupAbility : CharacterAbilities)
 	{
 		// Adds ability to the system component and adds ability ID to the action mapping
-		AbilitySystemComponent->GiveAbility(FGameplayAbilitySpec(StartupAbility, GetAbilityLevel(StartupAbility.GetDefaultObject()->AbilityID), static_cast<int32>(StartupAbility.GetDefaultObject()->AbilityInputID), this));
+		GrantedHandles.AbilitySpecHandles.Add(AbilitySystemComponent->GiveAbility(FGameplayAbilitySpec(StartupAbility, GetAbilityLevel(StartupAbility.GetDefaultObject()->AbilityID), static_cast<int32>(StartupAbility.GetDefaultObject()->AbilityInputID), this)));
+	}
+
+	if (AbilitySet)
+	{
+		AbilitySet->GiveAbilities(AbilitySystemComponent.Get(), this, GrantedHandles);
 	}
 
 	AbilitySystemComponent->CharacterAbilitiesGiven = true;
@@ -179,14 +659,46 @@ void ACharBase::AddCharacterAbilities()
 
 void ACharBase::InitializeAttributes()
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(ACharBase::InitializeAttributes);
+	SCOPE_CYCLE_COUNTER(STAT_WB2023_InitializeAttributes);
+
 	if (!AbilitySystemComponent.IsValid())
 	{
 		return;
 	}
 
-	if (!DefaultAttributes)
+	TSubclassOf<UGameplayEffect> DefaultAttributesEffect = GetDefaultAttributesEffect();
+
+	// Already applied for this ASC at this level (possession and OnRep_PlayerState both initialize)
+	const int32 Level = GetCharacterLevel();
+	if (InitializedAttributesASC.Get() == AbilitySystemComponent.Get() && DefaultAttributesEffect == InitializedAttributesEffect && Level == InitializedAttributesLevel)
 	{
-		UE_LOG(LogTemp, Error, TEXT("%s() Missing DefaultAttributes for %s. Please fill in the character's Blueprint."), *FString(__FUNCTION__), *GetName());
+		return;
+	}
+
+	// Values from the attribute curve tables take the place of the DefaultAttributes effect when they have the group
+	UCharacterAttributeInitSubsystem* AttributeInit = GEngine ? GEngine->GetEngineSubsystem<UCharacterAttributeInitSubsystem>() : nullptr;
+	if (AttributeInit && AttributeInit->HasGroup(GetAttributeInitGroup()))
+	{
+		// Clients get the server's values replicated instead of writing their own
+		if (!HasAuthority())
+		{
+			return;
+		}
+
+		if (AttributeInit->InitializeAttributes(AbilitySystemComponent.Get(), AttributeSetBase.Get(), GetAttributeInitGroup(), Level))
+		{
+			// The table may have set Level itself
+			InitializedAttributesASC = AbilitySystemComponent.Get();
+			InitializedAttributesEffect = DefaultAttributesEffect;
+			InitializedAttributesLevel = GetCharacterLevel();
+			return;
+		}
+	}
+
+	if (!DefaultAttributesEffect)
+	{
+		UE_LOG(LogWB2023Ability, Error, TEXT("%s() Missing DefaultAttributes for %s. Please fill in the character's Blueprint."), *FString(__FUNCTION__), *GetName());
 		return;
 	}
 
@@ -194,18 +706,49 @@ void ACharBase::InitializeAttributes()
 	FGameplayEffectContextHandle EffectContext = AbilitySystemComponent->MakeEffectContext();
 	EffectContext.AddSourceObject(this);
 
-	// Creates new effect spec (instance of the effect) is an instance of the DefaultAttributes
-	FGameplayEffectSpecHandle NewHandle = AbilitySystemComponent->MakeOutgoingSpec(DefaultAttributes, GetCharacterLevel(), EffectContext);
+	// Copy of the spec every character with these DefaultAttributes at this level shares
+	FGameplayEffectSpecHandle NewHandle = UEffectSpecCacheSubsystem::MakeOutgoingSpec(AbilitySystemComponent.Get(), DefaultAttributesEffect, Level, EffectContext);
 
 	// Applies the spec to the ability system component
 	if (NewHandle.IsValid())
 	{
 		FActiveGameplayEffectHandle ActiveGEHandle = AbilitySystemComponent->ApplyGameplayEffectSpecToTarget(*NewHandle.Data.Get(), AbilitySystemComponent.Get());
+
+		// DefaultAttributes usually sets Level too
+		InitializedAttributesASC = AbilitySystemComponent.Get();
+		InitializedAttributesEffect = DefaultAttributesEffect;
+		InitializedAttributesLevel = GetCharacterLevel();
+	}
+}
+
+FName ACharBase::GetAttributeInitGroup() const
+{
+	return AttributeInitGroup.IsNone() ? GetClass()->GetFName() : AttributeInitGroup;
+}
+
+TSubclassOf<UGameplayEffect> ACharBase::GetDefaultAttributesEffect() const
+{
+	if (!DefaultAttributes && AbilitySet)
+	{
+		return AbilitySet->DefaultAttributes;
+	}
+
+	return DefaultAttributes;
+}
+
+void ACharBase::OnAbilitySystemInitialized()
+{
+	if (UCharacterTickSubsystem* CharacterTickSubsystem = GetWorld()->GetSubsystem<UCharacterTickSubsystem>())
+	{
+		CharacterTickSubsystem->RefreshCharacter(this);
 	}
 }
 
 void ACharBase::AddStartupEffects()
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(ACharBase::AddStartupEffects);
+	SCOPE_CYCLE_COUNTER(STAT_WB2023_StartupEffects);
+
 	if (GetLocalRole() != ROLE_Authority || !AbilitySystemComponent.IsValid()
 		|| AbilitySystemComponent->StartupEffectsApplied)
 	{
@@ -217,14 +760,20 @@ void ACharBase::AddStartupEffects()
 
 	for (TSubclassOf<UGameplayEffect> GameplayEffect : StartupEffects)
 	{
-		FGameplayEffectSpecHandle NewHandle = AbilitySystemComponent->MakeOutgoingSpec(GameplayEffect, GetCharacterLevel(), EffectContext);
+		FGameplayEffectSpecHandle NewHandle = UEffectSpecCacheSubsystem::MakeOutgoingSpec(AbilitySystemComponent.Get(), GameplayEffect, GetCharacterLevel(), EffectContext);
 
 		// Applies the spec to the ability system component
 		if (NewHandle.IsValid())
 		{
-			FActiveGameplayEffectHandle ActiveGEHandle = AbilitySystemComponent->ApplyGameplayEffectSpecToTarget(*NewHandle.Data.Get(), AbilitySystemComponent.Get());
+			GrantedHandles.EffectHandles.Add(AbilitySystemComponent->ApplyGameplayEffectSpecToTarget(*NewHandle.Data.Get(), AbilitySystemComponent.Get()));
 		}
 	}
+
+	if (AbilitySet)
+	{
+		AbilitySet->ApplyStartupEffects(AbilitySystemComponent.Get(), this, GetCharacterLevel(), GrantedHandles);
+	}
+
 	AbilitySystemComponent->StartupEffectsApplied = true;
 }
 
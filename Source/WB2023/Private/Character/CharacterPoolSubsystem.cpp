@@ -0,0 +1,219 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Character/CharacterPoolSubsystem.h"
+#include "Character/CharBase.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+
+namespace CharacterPool_Impl
+{
+	static TSubclassOf<ACharBase> ParseCharacterClass(const TArray<FString>& Args)
+	{
+		return Args.Num() > 0 ? LoadClass<ACharBase>(nullptr, *Args[0]) : ACharBase::StaticClass();
+	}
+
+	static FAutoConsoleCommandWithWorld StatsCommand(
+		TEXT("WB2023.CharacterPool.Stats"),
+		TEXT("Logs available, in use, high water mark, spawned and reused counts for every character pool"),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			if (UCharacterPoolSubsystem* Pool = World ? World->GetSubsystem<UCharacterPoolSubsystem>() : nullptr)
+			{
+				Pool->LogStats();
+			}
+		}));
+
+	static FAutoConsoleCommandWithWorldAndArgs PrewarmCommand(
+		TEXT("WB2023.CharacterPool.Prewarm"),
+		TEXT("Usage: WB2023.CharacterPool.Prewarm CharacterClassPath Count"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			UCharacterPoolSubsystem* Pool = World ? World->GetSubsystem<UCharacterPoolSubsystem>() : nullptr;
+			TSubclassOf<ACharBase> CharacterClass = ParseCharacterClass(Args);
+			if (Pool && CharacterClass && Args.Num() > 1)
+			{
+				Pool->Prewarm(CharacterClass, FCString::Atoi(*Args[1]));
+			}
+		}));
+
+	static FAutoConsoleCommandWithWorldAndArgs BenchmarkCommand(
+		TEXT("WB2023.CharacterPool.Benchmark"),
+		TEXT("Server only. Compares spawn/destroy against pooled acquire/release.\n")
+		TEXT("Usage: WB2023.CharacterPool.Benchmark [CharacterClassPath] [Count]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			UCharacterPoolSubsystem* Pool = World ? World->GetSubsystem<UCharacterPoolSubsystem>() : nullptr;
+			TSubclassOf<ACharBase> CharacterClass = ParseCharacterClass(Args);
+			if (Pool && CharacterClass)
+			{
+				Pool->RunSpawnBenchmark(CharacterClass, Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 100);
+			}
+		}));
+}
+
+ACharBase* UCharacterPoolSubsystem::AcquireCharacter(TSubclassOf<ACharBase> CharacterClass, const FTransform& SpawnTransform)
+{
+	if (!CharacterClass)
+	{
+		return nullptr;
+	}
+
+	FCharacterPool& Pool = Pools.FindOrAdd(CharacterClass);
+
+	ACharBase* Character = nullptr;
+	while (!Character && Pool.Available.Num() > 0)
+	{
+		// Skip anything that got destroyed while pooled (level unload, GM cleanup)
+		Character = Pool.Available.Pop(false);
+		Character = IsValid(Character) ? Character : nullptr;
+	}
+
+	if (Character)
+	{
+		Character->ActivateFromPool(SpawnTransform);
+		++Pool.NumReused;
+	}
+	else
+	{
+		Character = SpawnCharacter(CharacterClass, SpawnTransform);
+		if (!Character)
+		{
+			return nullptr;
+		}
+	}
+
+	// Fresh spawns auto possess on their own, reused ones lost their controller on release
+	const bool bAutoPossessOnSpawn = Character->AutoPossessAI == EAutoPossessAI::Spawned || Character->AutoPossessAI == EAutoPossessAI::PlacedInWorldOrSpawned;
+	if (bAutoPossessOnSpawn && !Character->GetController())
+	{
+		Character->SpawnDefaultController();
+	}
+
+	Pool.NumInUse++;
+	Pool.HighWaterMark = FMath::Max(Pool.HighWaterMark, Pool.NumInUse);
+	return Character;
+}
+
+void UCharacterPoolSubsystem::ReleaseCharacter(ACharBase* Character)
+{
+	if (!IsValid(Character) || Character->IsInPool())
+	{
+		return;
+	}
+
+	Character->DeactivateToPool();
+
+	FCharacterPool& Pool = Pools.FindOrAdd(Character->GetClass());
+	Pool.Available.Add(Character);
+	Pool.NumInUse = FMath::Max(Pool.NumInUse - 1, 0);
+}
+
+void UCharacterPoolSubsystem::Prewarm(TSubclassOf<ACharBase> CharacterClass, int32 Count)
+{
+	if (!CharacterClass)
+	{
+		return;
+	}
+
+	FCharacterPool& Pool = Pools.FindOrAdd(CharacterClass);
+	while (Pool.Available.Num() < Count)
+	{
+		ACharBase* Character = SpawnCharacter(CharacterClass, FTransform::Identity);
+		if (!Character)
+		{
+			break;
+		}
+
+		Character->DeactivateToPool();
+		Pool.Available.Add(Character);
+	}
+}
+
+const FCharacterPool* UCharacterPoolSubsystem::FindPool(TSubclassOf<ACharBase> CharacterClass) const
+{
+	return Pools.Find(CharacterClass);
+}
+
+void UCharacterPoolSubsystem::LogStats() const
+{
+	for (const TPair<TObjectPtr<UClass>, FCharacterPool>& Pair : Pools)
+	{
+		const FCharacterPool& Pool = Pair.Value;
+		UE_LOG(LogWB2023, Display, TEXT("CharacterPool %s: Available=%d InUse=%d HighWaterMark=%d Spawned=%d Reused=%d"),
+			*GetNameSafe(Pair.Key), Pool.Available.Num(), Pool.NumInUse, Pool.HighWaterMark, Pool.NumSpawned, Pool.NumReused);
+	}
+}
+
+void UCharacterPoolSubsystem::RunSpawnBenchmark(TSubclassOf<ACharBase> CharacterClass, int32 Count)
+{
+	UWorld* World = GetWorld();
+	if (!CharacterClass || Count <= 0 || World->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	TArray<ACharBase*> Characters;
+	Characters.Reserve(Count);
+
+	// Unpooled, the way FinishDying used to work
+	const double UnpooledStart = FPlatformTime::Seconds();
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		Characters.Add(World->SpawnActor<ACharBase>(CharacterClass, FTransform::Identity, SpawnParams));
+	}
+	const double UnpooledSpawned = FPlatformTime::Seconds();
+	for (ACharBase* Character : Characters)
+	{
+		if (Character)
+		{
+			Character->Destroy();
+		}
+	}
+	const double UnpooledEnd = FPlatformTime::Seconds();
+	Characters.Reset();
+
+	// Pooled, prewarm is not part of the measurement
+	Prewarm(CharacterClass, Count);
+
+	const double PooledStart = FPlatformTime::Seconds();
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		Characters.Add(AcquireCharacter(CharacterClass, FTransform::Identity));
+	}
+	const double PooledAcquired = FPlatformTime::Seconds();
+	for (ACharBase* Character : Characters)
+	{
+		ReleaseCharacter(Character);
+	}
+	const double PooledEnd = FPlatformTime::Seconds();
+
+	UE_LOG(LogWB2023, Display, TEXT("CharacterPool benchmark %s x%d: Unpooled spawn=%.3fms destroy=%.3fms | Pooled acquire=%.3fms release=%.3fms (per character)"),
+		*GetNameSafe(CharacterClass), Count,
+		(UnpooledSpawned - UnpooledStart) * 1000.0 / Count, (UnpooledEnd - UnpooledSpawned) * 1000.0 / Count,
+		(PooledAcquired - PooledStart) * 1000.0 / Count, (PooledEnd - PooledAcquired) * 1000.0 / Count);
+}
+
+void UCharacterPoolSubsystem::Deinitialize()
+{
+	Pools.Reset();
+
+	Super::Deinitialize();
+}
+
+ACharBase* UCharacterPoolSubsystem::SpawnCharacter(TSubclassOf<ACharBase> CharacterClass, const FTransform& SpawnTransform)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	ACharBase* Character = GetWorld()->SpawnActor<ACharBase>(CharacterClass, SpawnTransform, SpawnParams);
+	if (Character)
+	{
+		Pools.FindOrAdd(CharacterClass).NumSpawned++;
+	}
+
+	return Character;
+}
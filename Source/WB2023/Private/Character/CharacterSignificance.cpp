@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Character/CharacterSignificance.h"
+#include "Character/CharBase.h"
+#include "SignificanceManager.h"
+
+DEFINE_STAT(STAT_CharacterSignificanceUpdate);
+DEFINE_STAT(STAT_CriticalSignificanceCharacters);
+DEFINE_STAT(STAT_HighSignificanceCharacters);
+DEFINE_STAT(STAT_MediumSignificanceCharacters);
+DEFINE_STAT(STAT_LowSignificanceCharacters);
+DEFINE_STAT(STAT_MeshTicksSkippedByInterval);
+
+const FName CharacterSignificance::Tag(TEXT("WB2023.Character"));
+
+ECharacterSignificance CharacterSignificance::GetBucket(float Significance)
+{
+	if (Significance >= CriticalSignificance)
+	{
+		return ECharacterSignificance::Critical;
+	}
+	if (Significance >= HighSignificance)
+	{
+		return ECharacterSignificance::High;
+	}
+	if (Significance >= MediumSignificance)
+	{
+		return ECharacterSignificance::Medium;
+	}
+	return ECharacterSignificance::Low;
+}
+
+void CharacterSignificance::Update(UWorld* World, TArrayView<const FTransform> Viewpoints, float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CharacterSignificanceUpdate);
+
+	USignificanceManager* SignificanceManager = FSignificanceManagerModule::Get(World);
+	if (!SignificanceManager)
+	{
+		return;
+	}
+
+	SignificanceManager->Update(Viewpoints);
+
+#if STATS
+	// Mesh ticks the reduced buckets' tick intervals skip on a frame this long
+	float TicksSkipped = 0.0f;
+	for (const USignificanceManager::FManagedObjectInfo* ObjectInfo : SignificanceManager->GetManagedObjects(Tag))
+	{
+		if (const ACharBase* Character = Cast<ACharBase>(ObjectInfo->GetObject()))
+		{
+			const float TickInterval = Character->GetAnimTickInterval();
+			if (TickInterval > DeltaSeconds)
+			{
+				TicksSkipped += 1.0f - DeltaSeconds / TickInterval;
+			}
+		}
+	}
+	SET_FLOAT_STAT(STAT_MeshTicksSkippedByInterval, TicksSkipped);
+#endif
+}
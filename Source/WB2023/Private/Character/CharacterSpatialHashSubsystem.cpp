@@ -0,0 +1,357 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Character/CharacterSpatialHashSubsystem.h"
+#include "Character/CharBase.h"
+#include "Character/CharacterPoolSubsystem.h"
+#include "AbilitySystemComponent.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "WB2023GameplayTags.h"
+
+namespace CharacterSpatialHash_Impl
+{
+	constexpr int32 BenchmarkCounts[] = { 100, 1000 };
+
+	// Benchmark characters are spread over a square this wide
+	constexpr float BenchmarkAreaSize = 40000.0f;
+	constexpr float BenchmarkQueryRadius = 5000.0f;
+
+	static FAutoConsoleCommandWithWorldAndArgs BenchmarkCommand(
+		TEXT("WB2023.SpatialHash.Benchmark"),
+		TEXT("Server only. Compares nearest character queries through the spatial hash against iterating every ACharBase.\n")
+		TEXT("Usage: WB2023.SpatialHash.Benchmark [CharacterClassPath]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			UCharacterSpatialHashSubsystem* SpatialHash = World ? World->GetSubsystem<UCharacterSpatialHashSubsystem>() : nullptr;
+			TSubclassOf<ACharBase> CharacterClass = Args.Num() > 0 ? LoadClass<ACharBase>(nullptr, *Args[0]) : ACharBase::StaticClass();
+			if (SpatialHash && CharacterClass)
+			{
+				SpatialHash->RunBenchmark(CharacterClass);
+			}
+		}));
+}
+
+void UCharacterSpatialHashSubsystem::Tick(float DeltaTime)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCharacterSpatialHashSubsystem::Tick);
+	SCOPE_CYCLE_COUNTER(STAT_WB2023_SpatialHashUpdate);
+
+	Super::Tick(DeltaTime);
+
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		RefreshEntry(Index);
+	}
+}
+
+TStatId UCharacterSpatialHashSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCharacterSpatialHashSubsystem, STATGROUP_Tickables);
+}
+
+void UCharacterSpatialHashSubsystem::Deinitialize()
+{
+	for (const FCharacterEntry& Entry : Entries)
+	{
+		Entry.Character->SpatialHashIndex = INDEX_NONE;
+	}
+	Entries.Reset();
+	Cells.Reset();
+
+	Super::Deinitialize();
+}
+
+void UCharacterSpatialHashSubsystem::RegisterCharacter(ACharBase* Character)
+{
+	if (!Character || Character->SpatialHashIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	const int32 Index = Entries.AddDefaulted();
+	Character->SpatialHashIndex = Index;
+
+	FCharacterEntry& Entry = Entries[Index];
+	Entry.Character = Character;
+	Entry.Location = Character->GetActorLocation();
+	Entry.Cell = GetCell(Entry.Location);
+	AddToCell(Entry.Cell, Index);
+	RefreshEntry(Index);
+}
+
+void UCharacterSpatialHashSubsystem::UnregisterCharacter(ACharBase* Character)
+{
+	if (!Character || !Entries.IsValidIndex(Character->SpatialHashIndex))
+	{
+		return;
+	}
+
+	const int32 Index = Character->SpatialHashIndex;
+	RemoveFromCell(Entries[Index].Cell, Index);
+
+	// The last entry takes the freed slot, point its cell at the new index
+	const int32 LastIndex = Entries.Num() - 1;
+	if (Index != LastIndex)
+	{
+		FCharacterEntry& LastEntry = Entries[LastIndex];
+		RemoveFromCell(LastEntry.Cell, LastIndex);
+		AddToCell(LastEntry.Cell, Index);
+		LastEntry.Character->SpatialHashIndex = Index;
+	}
+
+	Entries.RemoveAtSwap(Index, 1, false);
+	Character->SpatialHashIndex = INDEX_NONE;
+}
+
+void UCharacterSpatialHashSubsystem::MarkDead(ACharBase* Character)
+{
+	if (Character && Entries.IsValidIndex(Character->SpatialHashIndex))
+	{
+		Entries[Character->SpatialHashIndex].bAlive = false;
+	}
+}
+
+ACharBase* UCharacterSpatialHashSubsystem::FindNearestEnemy(const ACharBase* Querier, float MaxRadius) const
+{
+	if (!Querier)
+	{
+		return nullptr;
+	}
+
+	const bool bQuerierPlayerControlled = Querier->IsPlayerControlled();
+	return FindNearest(Querier->GetActorLocation(), MaxRadius, [Querier, bQuerierPlayerControlled](const FCharacterEntry& Entry)
+	{
+		return Entry.bAlive && Entry.bPlayerControlled != bQuerierPlayerControlled && Entry.Character != Querier;
+	});
+}
+
+void UCharacterSpatialHashSubsystem::FindEnemiesInRadius(const ACharBase* Querier, const FVector& Center, float Radius, TArray<ACharBase*>& OutEnemies) const
+{
+	OutEnemies.Reset();
+	if (!Querier)
+	{
+		return;
+	}
+
+	const bool bQuerierPlayerControlled = Querier->IsPlayerControlled();
+	const float RadiusSquared = Radius * Radius;
+	ForEachEntryInCells(Center, Radius, [&](const FCharacterEntry& Entry)
+	{
+		if (Entry.bAlive && Entry.bPlayerControlled != bQuerierPlayerControlled && FVector::DistSquared(Entry.Location, Center) <= RadiusSquared)
+		{
+			OutEnemies.Add(Entry.Character);
+		}
+	});
+}
+
+void UCharacterSpatialHashSubsystem::FindCharactersInRadius(const FVector& Center, float Radius, TArray<ACharBase*>& OutCharacters, bool bIncludeDead) const
+{
+	OutCharacters.Reset();
+
+	const float RadiusSquared = Radius * Radius;
+	ForEachEntryInCells(Center, Radius, [&](const FCharacterEntry& Entry)
+	{
+		if ((bIncludeDead || Entry.bAlive) && FVector::DistSquared(Entry.Location, Center) <= RadiusSquared)
+		{
+			OutCharacters.Add(Entry.Character);
+		}
+	});
+}
+
+void UCharacterSpatialHashSubsystem::RunBenchmark(TSubclassOf<ACharBase> CharacterClass)
+{
+	using namespace CharacterSpatialHash_Impl;
+
+	UWorld* World = GetWorld();
+	UCharacterPoolSubsystem* Pool = World->GetSubsystem<UCharacterPoolSubsystem>();
+	if (!CharacterClass || !Pool || World->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	for (const int32 Count : BenchmarkCounts)
+	{
+		TArray<ACharBase*> Characters;
+		Characters.Reserve(Count);
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			const FVector Location(FMath::FRandRange(0.0f, BenchmarkAreaSize), FMath::FRandRange(0.0f, BenchmarkAreaSize), 0.0f);
+			if (ACharBase* Character = Pool->AcquireCharacter(CharacterClass, FTransform(Location)))
+			{
+				Characters.Add(Character);
+			}
+		}
+
+		const double UpdateStart = FPlatformTime::Seconds();
+		for (int32 Index = 0; Index < Entries.Num(); ++Index)
+		{
+			RefreshEntry(Index);
+		}
+		const double UpdateSeconds = FPlatformTime::Seconds() - UpdateStart;
+
+		// Dead or not yet initialized characters count too, both sides look for the same thing
+		int32 NumFoundHash = 0;
+		const double HashStart = FPlatformTime::Seconds();
+		for (const ACharBase* Character : Characters)
+		{
+			NumFoundHash += FindNearest(Character->GetActorLocation(), BenchmarkQueryRadius,
+				[Character](const FCharacterEntry& Entry) { return Entry.Character != Character; }) ? 1 : 0;
+		}
+		const double HashSeconds = FPlatformTime::Seconds() - HashStart;
+
+		// What an EQS actors of class generator or a perception sweep comes down to
+		int32 NumFoundIterator = 0;
+		const float QueryRadiusSquared = BenchmarkQueryRadius * BenchmarkQueryRadius;
+		const double IteratorStart = FPlatformTime::Seconds();
+		for (const ACharBase* Character : Characters)
+		{
+			const FVector Location = Character->GetActorLocation();
+			const ACharBase* Nearest = nullptr;
+			float NearestDistanceSquared = QueryRadiusSquared;
+			for (TActorIterator<ACharBase> It(World); It; ++It)
+			{
+				const float DistanceSquared = FVector::DistSquared(It->GetActorLocation(), Location);
+				if (*It != Character && !It->IsInPool() && DistanceSquared <= NearestDistanceSquared)
+				{
+					Nearest = *It;
+					NearestDistanceSquared = DistanceSquared;
+				}
+			}
+			NumFoundIterator += Nearest ? 1 : 0;
+		}
+		const double IteratorSeconds = FPlatformTime::Seconds() - IteratorStart;
+
+		UE_LOG(LogWB2023, Display, TEXT("SpatialHash benchmark x%d: update=%.3fms | nearest per query hash=%.4fms iterator=%.4fms (%.1fx) | found hash=%d iterator=%d"),
+			Characters.Num(), UpdateSeconds * 1000.0,
+			HashSeconds * 1000.0 / FMath::Max(Characters.Num(), 1), IteratorSeconds * 1000.0 / FMath::Max(Characters.Num(), 1),
+			HashSeconds > 0.0 ? IteratorSeconds / HashSeconds : 0.0, NumFoundHash, NumFoundIterator);
+
+		for (ACharBase* Character : Characters)
+		{
+			Pool->ReleaseCharacter(Character);
+		}
+	}
+}
+
+void UCharacterSpatialHashSubsystem::RefreshEntry(int32 Index)
+{
+	FCharacterEntry& Entry = Entries[Index];
+	const ACharBase* Character = Entry.Character;
+
+	Entry.Location = Character->GetActorLocation();
+	const FIntPoint Cell = GetCell(Entry.Location);
+	if (Cell != Entry.Cell)
+	{
+		RemoveFromCell(Entry.Cell, Index);
+		AddToCell(Cell, Index);
+		Entry.Cell = Cell;
+	}
+
+	const UAbilitySystemComponent* AbilitySystemComponent = Character->GetAbilitySystemComponent();
+	Entry.bAlive = Character->IsAlive() && !(AbilitySystemComponent && AbilitySystemComponent->HasMatchingGameplayTag(WB2023GameplayTags::State_Dead));
+	Entry.bPlayerControlled = Character->IsPlayerControlled();
+}
+
+FIntPoint UCharacterSpatialHashSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+void UCharacterSpatialHashSubsystem::AddToCell(const FIntPoint& Cell, int32 Index)
+{
+	Cells.FindOrAdd(Cell).Add(Index);
+}
+
+void UCharacterSpatialHashSubsystem::RemoveFromCell(const FIntPoint& Cell, int32 Index)
+{
+	TArray<int32, TInlineAllocator<8>>* CellEntries = Cells.Find(Cell);
+	if (!CellEntries)
+	{
+		return;
+	}
+
+	CellEntries->RemoveSingleSwap(Index, false);
+	if (CellEntries->Num() == 0)
+	{
+		Cells.Remove(Cell);
+	}
+}
+
+template<typename FunctionType>
+void UCharacterSpatialHashSubsystem::ForEachEntryInCells(const FVector& Center, float Radius, FunctionType Function) const
+{
+	const FIntPoint MinCell = GetCell(Center - FVector(Radius));
+	const FIntPoint MaxCell = GetCell(Center + FVector(Radius));
+	for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+	{
+		for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+		{
+			if (const TArray<int32, TInlineAllocator<8>>* CellEntries = Cells.Find(FIntPoint(X, Y)))
+			{
+				for (const int32 Index : *CellEntries)
+				{
+					Function(Entries[Index]);
+				}
+			}
+		}
+	}
+}
+
+template<typename PredicateType>
+ACharBase* UCharacterSpatialHashSubsystem::FindNearest(const FVector& Location, float MaxRadius, PredicateType Predicate) const
+{
+	const FIntPoint CenterCell = GetCell(Location);
+	const int32 MaxRing = FMath::CeilToInt(MaxRadius / CellSize);
+
+	ACharBase* Nearest = nullptr;
+	float NearestDistanceSquared = MaxRadius * MaxRadius;
+
+	auto VisitCell = [&](int32 X, int32 Y)
+	{
+		const TArray<int32, TInlineAllocator<8>>* CellEntries = Cells.Find(FIntPoint(X, Y));
+		if (!CellEntries)
+		{
+			return;
+		}
+
+		for (const int32 Index : *CellEntries)
+		{
+			const FCharacterEntry& Entry = Entries[Index];
+			const float DistanceSquared = FVector::DistSquared(Entry.Location, Location);
+			if (DistanceSquared <= NearestDistanceSquared && Predicate(Entry))
+			{
+				Nearest = Entry.Character;
+				NearestDistanceSquared = DistanceSquared;
+			}
+		}
+	};
+
+	for (int32 Ring = 0; Ring <= MaxRing; ++Ring)
+	{
+		// Everything in this ring is at least (Ring - 1) cells away
+		if (Nearest && FMath::Square((Ring - 1) * CellSize) > NearestDistanceSquared)
+		{
+			break;
+		}
+
+		for (int32 Y = -Ring; Y <= Ring; ++Y)
+		{
+			if (Y == -Ring || Y == Ring)
+			{
+				for (int32 X = -Ring; X <= Ring; ++X)
+				{
+					VisitCell(CenterCell.X + X, CenterCell.Y + Y);
+				}
+			}
+			else
+			{
+				VisitCell(CenterCell.X - Ring, CenterCell.Y + Y);
+				VisitCell(CenterCell.X + Ring, CenterCell.Y + Y);
+			}
+		}
+	}
+
+	return Nearest;
+}
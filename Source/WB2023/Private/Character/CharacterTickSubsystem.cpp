@@ -0,0 +1,201 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Character/CharacterTickSubsystem.h"
+#include "Character/Abilities/CharacterGameplayAbility.h"
+#include "Character/CharBase.h"
+#include "Character/Abilities/AttributeSets/CharacterAttributeSetBase.h"
+#include "Character/Abilities/CharacterAbilitySystemComponent.h"
+#include "Player/WB2023PlayerState.h"
+#include "WB2023GameplayTags.h"
+
+void UCharacterTickSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	bTicking = true;
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		if (Entries[Index].Character)
+		{
+			TickEntry(Entries[Index], DeltaTime);
+		}
+	}
+	bTicking = false;
+
+	// Characters that were destroyed during the loop (Die -> FinishDying) were only cleared, compact now
+	if (bNeedsCompaction)
+	{
+		Entries.RemoveAll([](const FCharacterTickEntry& Entry) { return Entry.Character == nullptr; });
+		for (int32 Index = 0; Index < Entries.Num(); ++Index)
+		{
+			Entries[Index].Character->CharacterTickIndex = Index;
+		}
+		bNeedsCompaction = false;
+	}
+}
+
+TStatId UCharacterTickSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCharacterTickSubsystem, STATGROUP_Tickables);
+}
+
+void UCharacterTickSubsystem::RegisterCharacter(ACharBase* Character)
+{
+	if (!Character || Character->CharacterTickIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	Character->CharacterTickIndex = Entries.AddDefaulted();
+	Entries[Character->CharacterTickIndex].Character = Character;
+	RefreshCharacter(Character);
+}
+
+void UCharacterTickSubsystem::UnregisterCharacter(ACharBase* Character)
+{
+	if (!Character || !Entries.IsValidIndex(Character->CharacterTickIndex))
+	{
+		return;
+	}
+
+	const int32 Index = Character->CharacterTickIndex;
+	Character->CharacterTickIndex = INDEX_NONE;
+
+	if (bTicking)
+	{
+		Entries[Index].Character = nullptr;
+		bNeedsCompaction = true;
+		return;
+	}
+
+	Entries.RemoveAtSwap(Index, 1, false);
+	if (Entries.IsValidIndex(Index))
+	{
+		Entries[Index].Character->CharacterTickIndex = Index;
+	}
+}
+
+void UCharacterTickSubsystem::RefreshCharacter(ACharBase* Character)
+{
+	if (!Character || !Entries.IsValidIndex(Character->CharacterTickIndex))
+	{
+		return;
+	}
+
+	FCharacterTickEntry& Entry = Entries[Character->CharacterTickIndex];
+	Entry.AbilitySystemComponent = Cast<UCharacterAbilitySystemComponent>(Character->GetAbilitySystemComponent());
+	Entry.AttributeSet = Character->GetAttributeSetBase();
+	Entry.HealthRegenRate = Character->GetHealthRegenRate();
+	Entry.ManaRegenRate = Character->GetManaRegenRate();
+	Entry.bHasAuthority = Character->HasAuthority();
+	Entry.CooldownPlayerState = Character->GetPlayerState<AWB2023PlayerState>();
+	Entry.ActiveCooldowns.Reset();
+}
+
+void UCharacterTickSubsystem::TickEntry(FCharacterTickEntry& Entry, float DeltaTime)
+{
+	if (Entry.CooldownPlayerState.IsValid())
+	{
+		RefreshCooldowns(Entry, DeltaTime);
+	}
+
+	// Attribute changes are server authoritative, clients get them through replication
+	if (!Entry.bHasAuthority)
+	{
+		return;
+	}
+
+	UCharacterAttributeSetBase* AttributeSet = Entry.AttributeSet.Get();
+	UCharacterAbilitySystemComponent* AbilitySystemComponent = Entry.AbilitySystemComponent.Get();
+	if (!AttributeSet || !AbilitySystemComponent || AttributeSet->GetMaxHealth() <= 0.0f)
+	{
+		return;
+	}
+
+	// Death check, State.Dead is set by Die() so characters that already died some other way are left alone
+	if (AttributeSet->GetHealth() <= 0.0f)
+	{
+		if (!AbilitySystemComponent->HasMatchingGameplayTag(WB2023GameplayTags::State_Dead))
+		{
+			Entry.Character->Die();
+		}
+		return;
+	}
+
+	// Regen
+	if (Entry.HealthRegenRate == 0.0f && Entry.ManaRegenRate == 0.0f)
+	{
+		return;
+	}
+
+	Entry.RegenAccumulator += DeltaTime;
+	if (Entry.RegenAccumulator < RegenInterval)
+	{
+		return;
+	}
+
+	if (Entry.HealthRegenRate != 0.0f && AttributeSet->GetHealth() < AttributeSet->GetMaxHealth())
+	{
+		AttributeSet->SetHealth(FMath::Min(AttributeSet->GetHealth() + Entry.HealthRegenRate * Entry.RegenAccumulator, AttributeSet->GetMaxHealth()));
+	}
+
+	if (Entry.ManaRegenRate != 0.0f && AttributeSet->GetMana() < AttributeSet->GetMaxMana())
+	{
+		AttributeSet->SetMana(FMath::Min(AttributeSet->GetMana() + Entry.ManaRegenRate * Entry.RegenAccumulator, AttributeSet->GetMaxMana()));
+	}
+
+	Entry.RegenAccumulator = 0.0f;
+}
+
+void UCharacterTickSubsystem::RefreshCooldowns(FCharacterTickEntry& Entry, float DeltaTime)
+{
+	Entry.CooldownAccumulator += DeltaTime;
+	if (Entry.CooldownAccumulator < CooldownRefreshInterval)
+	{
+		return;
+	}
+	Entry.CooldownAccumulator = 0.0f;
+
+	AWB2023PlayerState* PlayerState = Entry.CooldownPlayerState.Get();
+	UCharacterAbilitySystemComponent* AbilitySystemComponent = Entry.AbilitySystemComponent.Get();
+	if (!AbilitySystemComponent || !PlayerState->OnAbilityCooldownChanged.IsBound())
+	{
+		return;
+	}
+
+	const FGameplayAbilityActorInfo* ActorInfo = AbilitySystemComponent->AbilityActorInfo.Get();
+	for (const FGameplayAbilitySpec& Spec : AbilitySystemComponent->GetActivatableAbilities())
+	{
+		const UCharacterGameplayAbility* Ability = Cast<UCharacterGameplayAbility>(Spec.Ability);
+		if (!Ability || !Ability->GetCooldownTags())
+		{
+			continue;
+		}
+
+		float TimeRemaining = 0.0f;
+		float Duration = 0.0f;
+		Ability->GetCooldownTimeRemainingAndDuration(Spec.Handle, ActorInfo, TimeRemaining, Duration);
+
+		const int32 CooldownIndex = Entry.ActiveCooldowns.Find(Spec.Handle);
+		if (TimeRemaining > 0.0f)
+		{
+			if (CooldownIndex == INDEX_NONE)
+			{
+				Entry.ActiveCooldowns.Add(Spec.Handle);
+			}
+		}
+		else if (CooldownIndex != INDEX_NONE)
+		{
+			// Ready again, one last broadcast so the HUD clears it
+			Entry.ActiveCooldowns.RemoveAtSwap(CooldownIndex);
+		}
+		else
+		{
+			continue;
+		}
+
+		// Spec.InputID is the input binding's ID, listeners key the cooldowns on the ability's CharAbilityID
+		PlayerState->OnAbilityCooldownChanged.Broadcast(static_cast<int32>(Ability->AbilityInputID), TimeRemaining, Duration);
+	}
+}
@@ -0,0 +1,155 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Character/EnemyCrowdActor.h"
+#include "Character/EnemyCrowdSubsystem.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/SceneComponent.h"
+#include "Engine/World.h"
+#include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+FVector FEnemyCrowdAgent::GetLocation(float ServerTime, float MoveSpeed) const
+{
+	const FVector Leg = LegEnd - LegStart;
+	const float Length = Leg.Size();
+	if (Length <= KINDA_SMALL_NUMBER || MoveSpeed <= 0.0f)
+	{
+		return LegEnd;
+	}
+
+	const float Alpha = FMath::Clamp((ServerTime - LegStartTime) * MoveSpeed / Length, 0.0f, 1.0f);
+	return LegStart + Leg * Alpha;
+}
+
+float FEnemyCrowdAgent::GetLegEndTime(float MoveSpeed) const
+{
+	return MoveSpeed > 0.0f ? LegStartTime + FVector::Dist(LegStart, LegEnd) / MoveSpeed : LegStartTime;
+}
+
+AEnemyCrowdActor::AEnemyCrowdActor()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+
+	// Agents are spread over the whole level, the replication graph puts always relevant actors in one node
+	bReplicates = true;
+	bAlwaysRelevant = true;
+	NetUpdateFrequency = 10.0f;
+}
+
+void AEnemyCrowdActor::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+	DOREPLIFETIME_WITH_PARAMS_FAST(AEnemyCrowdActor, Agents, Params);
+}
+
+void AEnemyCrowdActor::MarkAgentDirty(FEnemyCrowdAgent& Agent)
+{
+	Agents.MarkItemDirty(Agent);
+	MARK_PROPERTY_DIRTY_FROM_NAME(AEnemyCrowdActor, Agents, this);
+}
+
+void AEnemyCrowdActor::MarkAgentsRemoved()
+{
+	Agents.MarkArrayDirty();
+	MARK_PROPERTY_DIRTY_FROM_NAME(AEnemyCrowdActor, Agents, this);
+}
+
+void AEnemyCrowdActor::UpdateInstances(TArrayView<const FVector> Locations)
+{
+	if (InstanceComponents.Num() == 0 || Locations.Num() != Agents.Items.Num())
+	{
+		return;
+	}
+
+	for (TArray<FTransform>& Transforms : InstanceTransforms)
+	{
+		Transforms.Reset();
+	}
+
+	for (int32 Index = 0; Index < Agents.Items.Num(); ++Index)
+	{
+		const FEnemyCrowdAgent& Agent = Agents.Items[Index];
+		if (InstanceTransforms.IsValidIndex(Agent.TypeIndex))
+		{
+			const float Yaw = (Agent.LegEnd - Agent.LegStart).Rotation().Yaw;
+			InstanceTransforms[Agent.TypeIndex].Emplace(FRotator(0.0f, Yaw, 0.0f), Locations[Index]);
+		}
+	}
+
+	for (int32 TypeIndex = 0; TypeIndex < InstanceComponents.Num(); ++TypeIndex)
+	{
+		UInstancedStaticMeshComponent* Instances = InstanceComponents[TypeIndex];
+		const TArray<FTransform>& Transforms = InstanceTransforms[TypeIndex];
+		if (!Instances)
+		{
+			continue;
+		}
+
+		if (Instances->GetInstanceCount() == Transforms.Num())
+		{
+			Instances->BatchUpdateInstancesTransforms(0, Transforms, true, true, true);
+			continue;
+		}
+
+		// Agents were added or promoted, a full rebuild is cheaper than tracking which instance belongs to which agent
+		Instances->ClearInstances();
+		Instances->AddInstances(Transforms, false, true);
+		for (int32 InstanceIndex = 0; InstanceIndex < Transforms.Num(); ++InstanceIndex)
+		{
+			// Spreads the vertex animation so neighbours aren't in step
+			Instances->SetCustomDataValue(InstanceIndex, 0, FMath::Frac(InstanceIndex * 0.618034f), InstanceIndex == Transforms.Num() - 1);
+		}
+	}
+}
+
+void AEnemyCrowdActor::BeginPlay()
+{
+	Super::BeginPlay();
+
+	UWorld* World = GetWorld();
+	if (World->GetNetMode() != NM_DedicatedServer)
+	{
+		InstanceTransforms.SetNum(CrowdTypes.Num());
+		for (const FEnemyCrowdType& CrowdType : CrowdTypes)
+		{
+			UInstancedStaticMeshComponent* Instances = NewObject<UInstancedStaticMeshComponent>(this);
+			Instances->SetStaticMesh(CrowdType.Mesh);
+			Instances->SetMobility(EComponentMobility::Movable);
+			Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+			Instances->NumCustomDataFloats = 1;
+			Instances->SetupAttachment(RootComponent);
+			Instances->RegisterComponent();
+			InstanceComponents.Add(Instances);
+		}
+	}
+
+	UEnemyCrowdSubsystem* CrowdSubsystem = World->GetSubsystem<UEnemyCrowdSubsystem>();
+	if (CrowdSubsystem)
+	{
+		CrowdSubsystem->RegisterCrowd(this);
+
+		if (HasAuthority())
+		{
+			for (int32 TypeIndex = 0; TypeIndex < CrowdTypes.Num(); ++TypeIndex)
+			{
+				CrowdSubsystem->SpawnAgents(TypeIndex, GetActorLocation(), InitialSpawnRadius, CrowdTypes[TypeIndex].InitialCount);
+			}
+		}
+	}
+}
+
+void AEnemyCrowdActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UEnemyCrowdSubsystem* CrowdSubsystem = GetWorld()->GetSubsystem<UEnemyCrowdSubsystem>())
+	{
+		CrowdSubsystem->UnregisterCrowd(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
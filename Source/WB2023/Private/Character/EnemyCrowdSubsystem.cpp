@@ -0,0 +1,445 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Character/EnemyCrowdSubsystem.h"
+#include "Character/EnemyCrowdActor.h"
+#include "Character/CharBase.h"
+#include "Character/CharacterPoolSubsystem.h"
+#include "Character/Abilities/CharacterAbilitySystemComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "RenderCore.h"
+#include "Metrics/WB2023Metrics.h"
+#include "WB2023/WB2023.h"
+
+namespace EnemyCrowd_Impl
+{
+	// Agents per ParallelFor task
+	constexpr int32 AgentsPerBatch = 256;
+
+	// New leg ends are traced down onto the ground from this far above and below the agent's home
+	constexpr float GroundTraceHeight = 1000.0f;
+
+	static FVector GetSpawnCenter(UWorld* World)
+	{
+		const APawn* Pawn = UGameplayStatics::GetPlayerPawn(World, 0);
+		return Pawn ? Pawn->GetActorLocation() : FVector::ZeroVector;
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs SpawnCommand(
+		TEXT("WB2023.Crowd.Spawn"),
+		TEXT("Server only. Adds crowd agents around the first player.\n")
+		TEXT("Usage: WB2023.Crowd.Spawn Count [TypeIndex] [Radius]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			UEnemyCrowdSubsystem* CrowdSubsystem = World ? World->GetSubsystem<UEnemyCrowdSubsystem>() : nullptr;
+			if (CrowdSubsystem && Args.Num() > 0)
+			{
+				CrowdSubsystem->SpawnAgents(Args.Num() > 1 ? FCString::Atoi(*Args[1]) : 0, GetSpawnCenter(World),
+					Args.Num() > 2 ? FCString::Atof(*Args[2]) : 10000.0f, FCString::Atoi(*Args[0]));
+			}
+		}));
+
+	static FAutoConsoleCommandWithWorld StatsCommand(
+		TEXT("WB2023.Crowd.Stats"),
+		TEXT("Logs crowd agent and promoted character counts"),
+		FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+		{
+			if (UEnemyCrowdSubsystem* CrowdSubsystem = World ? World->GetSubsystem<UEnemyCrowdSubsystem>() : nullptr)
+			{
+				CrowdSubsystem->LogStats();
+			}
+		}));
+
+	static FAutoConsoleCommandWithWorldAndArgs BenchmarkCommand(
+		TEXT("WB2023.Crowd.Benchmark"),
+		TEXT("Records frame times with the crowd. The server first spawns Count agents around the first player,\n")
+		TEXT("clients only record. Run with t.MaxFPS 0 so the frame time isn't capped.\n")
+		TEXT("Usage: WB2023.Crowd.Benchmark [Count] [Seconds]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			UEnemyCrowdSubsystem* CrowdSubsystem = World ? World->GetSubsystem<UEnemyCrowdSubsystem>() : nullptr;
+			if (!CrowdSubsystem)
+			{
+				return;
+			}
+
+			if (World->GetNetMode() != NM_Client)
+			{
+				CrowdSubsystem->SpawnAgents(0, GetSpawnCenter(World), 20000.0f, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000);
+			}
+			CrowdSubsystem->StartBenchmark(Args.Num() > 1 ? FCString::Atof(*Args[1]) : 30.0f);
+		}));
+}
+
+void UEnemyCrowdSubsystem::Tick(float DeltaTime)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UEnemyCrowdSubsystem::Tick);
+	SCOPE_CYCLE_COUNTER(STAT_WB2023_CrowdUpdate);
+
+	Super::Tick(DeltaTime);
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	AEnemyCrowdActor* CrowdActor = Crowd.Get();
+	if (CrowdActor)
+	{
+		const ENetMode NetMode = GetWorld()->GetNetMode();
+		const float ServerTime = GetServerTime();
+		const bool bDraw = NetMode != NM_DedicatedServer;
+
+		ServerUpdateAccumulator += DeltaTime;
+		const bool bServerUpdate = NetMode != NM_Client && ServerUpdateAccumulator >= ServerUpdateInterval;
+
+		// A dedicated server only needs the locations when it checks for promotion
+		if (bDraw || bServerUpdate)
+		{
+			UpdateLocations(*CrowdActor, ServerTime);
+		}
+
+		if (bDraw)
+		{
+			CrowdActor->UpdateInstances(Locations);
+		}
+
+		if (bServerUpdate)
+		{
+			ServerUpdateAccumulator = 0.0f;
+			UpdateServer(*CrowdActor, ServerTime);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_WB2023_CrowdAgents, Locations.Num());
+	SET_DWORD_STAT(STAT_WB2023_CrowdPromoted, Promoted.Num());
+
+	if (Benchmark.TimeLeft > 0.0f)
+	{
+		TickBenchmark(DeltaTime, FPlatformTime::Seconds() - StartTime);
+	}
+}
+
+TStatId UEnemyCrowdSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UEnemyCrowdSubsystem, STATGROUP_Tickables);
+}
+
+void UEnemyCrowdSubsystem::Deinitialize()
+{
+	Crowd.Reset();
+	Locations.Reset();
+	Promoted.Reset();
+	WB2023Metrics::CrowdAgents.Set(0);
+
+	Super::Deinitialize();
+}
+
+void UEnemyCrowdSubsystem::RegisterCrowd(AEnemyCrowdActor* CrowdActor)
+{
+	if (Crowd.IsValid() && Crowd.Get() != CrowdActor)
+	{
+		UE_LOG(LogWB2023, Warning, TEXT("More than one AEnemyCrowdActor in the world, %s is ignored"), *GetNameSafe(CrowdActor));
+		return;
+	}
+
+	Crowd = CrowdActor;
+	Locations.SetNumZeroed(CrowdActor->GetAgents().Items.Num());
+}
+
+void UEnemyCrowdSubsystem::UnregisterCrowd(AEnemyCrowdActor* CrowdActor)
+{
+	if (Crowd.Get() == CrowdActor)
+	{
+		Crowd.Reset();
+		Locations.Reset();
+	}
+}
+
+void UEnemyCrowdSubsystem::SpawnAgents(int32 TypeIndex, const FVector& Center, float Radius, int32 Count)
+{
+	AEnemyCrowdActor* CrowdActor = Crowd.Get();
+	if (!CrowdActor || !CrowdActor->HasAuthority() || !CrowdActor->FindCrowdType(TypeIndex))
+	{
+		UE_LOG(LogWB2023, Warning, TEXT("Crowd: can't spawn agents of type %d, the world needs an AEnemyCrowdActor with that type and this has to run on the server"), TypeIndex);
+		return;
+	}
+
+	const float ServerTime = GetServerTime();
+	CrowdActor->GetAgents().Items.Reserve(CrowdActor->GetAgents().Items.Num() + Count);
+	for (int32 Index = 0; Index < Count; ++Index)
+	{
+		const FVector2D Offset = FMath::RandPointInCircle(Radius);
+		const FVector Location = Center + FVector(Offset.X, Offset.Y, 0.0f);
+		AddAgent(*CrowdActor, TypeIndex, Location, Location, ServerTime);
+	}
+}
+
+void UEnemyCrowdSubsystem::LogStats() const
+{
+	UE_LOG(LogWB2023, Display, TEXT("Crowd: Agents=%d Promoted=%d"), Locations.Num(), Promoted.Num());
+}
+
+void UEnemyCrowdSubsystem::StartBenchmark(float Seconds)
+{
+	Benchmark = FBenchmarkState();
+	Benchmark.TimeLeft = Seconds;
+
+	UE_LOG(LogWB2023, Display, TEXT("Crowd benchmark started for %.0fs with %d agents"), Seconds, Locations.Num());
+}
+
+void UEnemyCrowdSubsystem::UpdateLocations(const AEnemyCrowdActor& CrowdActor, float ServerTime)
+{
+	using namespace EnemyCrowd_Impl;
+
+	const TArray<FEnemyCrowdAgent>& Agents = CrowdActor.GetAgents().Items;
+	Locations.SetNumUninitialized(Agents.Num(), false);
+
+	const int32 NumBatches = FMath::DivideAndRoundUp(Agents.Num(), AgentsPerBatch);
+	ParallelFor(NumBatches, [this, &Agents, &CrowdActor, ServerTime](int32 Batch)
+	{
+		const int32 End = FMath::Min((Batch + 1) * AgentsPerBatch, Agents.Num());
+		for (int32 Index = Batch * AgentsPerBatch; Index < End; ++Index)
+		{
+			const FEnemyCrowdAgent& Agent = Agents[Index];
+			const FEnemyCrowdType* CrowdType = CrowdActor.FindCrowdType(Agent.TypeIndex);
+			Locations[Index] = Agent.GetLocation(ServerTime, CrowdType ? CrowdType->MoveSpeed : 0.0f);
+		}
+	});
+}
+
+void UEnemyCrowdSubsystem::UpdateServer(AEnemyCrowdActor& CrowdActor, float ServerTime)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UEnemyCrowdSubsystem::UpdateServer);
+
+	GatherPlayerLocations();
+
+	TArray<FEnemyCrowdAgent>& Agents = CrowdActor.GetAgents().Items;
+	const float PromotionRadiusSquared = PromotionRadius * PromotionRadius;
+	int32 NumPromotions = 0;
+
+	// Backwards, so a promoted agent is swapped with one that was already updated
+	for (int32 Index = Agents.Num() - 1; Index >= 0; --Index)
+	{
+		FEnemyCrowdAgent& Agent = Agents[Index];
+		const FVector Location = Locations[Index];
+
+		if (NumPromotions < MaxPromotionsPerUpdate && IsNearPlayer(Location, PromotionRadiusSquared)
+			&& PromoteAgent(CrowdActor, Agent, Location))
+		{
+			Agents.RemoveAtSwap(Index, 1, false);
+			Locations.RemoveAtSwap(Index, 1, false);
+			++NumPromotions;
+			continue;
+		}
+
+		const FEnemyCrowdType* CrowdType = CrowdActor.FindCrowdType(Agent.TypeIndex);
+		if (CrowdType && ServerTime >= Agent.GetLegEndTime(CrowdType->MoveSpeed) + IdleTime)
+		{
+			StartLeg(Agent, Location, *CrowdType, ServerTime);
+			CrowdActor.MarkAgentDirty(Agent);
+		}
+	}
+
+	if (NumPromotions > 0)
+	{
+		CrowdActor.MarkAgentsRemoved();
+		WB2023Metrics::CrowdPromotions.Add(NumPromotions);
+	}
+
+	DemoteCharacters(CrowdActor, ServerTime);
+
+	WB2023Metrics::CrowdAgents.Set(Agents.Num());
+}
+
+void UEnemyCrowdSubsystem::GatherPlayerLocations()
+{
+	PlayerLocations.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+		if (Pawn)
+		{
+			PlayerLocations.Add(Pawn->GetActorLocation());
+		}
+	}
+}
+
+bool UEnemyCrowdSubsystem::IsNearPlayer(const FVector& Location, float RadiusSquared) const
+{
+	for (const FVector& PlayerLocation : PlayerLocations)
+	{
+		if (FVector::DistSquared(Location, PlayerLocation) <= RadiusSquared)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void UEnemyCrowdSubsystem::AddAgent(AEnemyCrowdActor& CrowdActor, int32 TypeIndex, const FVector& Location, const FVector& Home, float ServerTime)
+{
+	FEnemyCrowdAgent& Agent = CrowdActor.GetAgents().Items.AddDefaulted_GetRef();
+	Agent.TypeIndex = static_cast<uint8>(TypeIndex);
+	Agent.Home = Home;
+	Agent.LegStart = Location;
+	Agent.LegEnd = Location;
+	// Spread the first legs so the whole crowd doesn't start walking on the same update
+	Agent.LegStartTime = ServerTime - FMath::FRandRange(0.0f, IdleTime);
+	CrowdActor.MarkAgentDirty(Agent);
+
+	Locations.Add(Location);
+}
+
+void UEnemyCrowdSubsystem::StartLeg(FEnemyCrowdAgent& Agent, const FVector& Location, const FEnemyCrowdType& CrowdType, float ServerTime) const
+{
+	using namespace EnemyCrowd_Impl;
+
+	const FVector2D Offset = FMath::RandPointInCircle(CrowdType.WanderRadius);
+	FVector Destination = Agent.Home + FVector(Offset.X, Offset.Y, 0.0f);
+
+	// Legs are straight lines, only the end is put on the ground. Obstacles are left to the promoted character
+	FHitResult Hit;
+	const FVector TraceOffset(0.0f, 0.0f, GroundTraceHeight);
+	if (GetWorld()->LineTraceSingleByObjectType(Hit, Destination + TraceOffset, Destination - TraceOffset, FCollisionObjectQueryParams(ECC_WorldStatic)))
+	{
+		Destination = Hit.ImpactPoint;
+	}
+
+	Agent.LegStart = Location;
+	Agent.LegEnd = Destination;
+	Agent.LegStartTime = ServerTime;
+}
+
+bool UEnemyCrowdSubsystem::PromoteAgent(const AEnemyCrowdActor& CrowdActor, const FEnemyCrowdAgent& Agent, const FVector& Location)
+{
+	const FEnemyCrowdType* CrowdType = CrowdActor.FindCrowdType(Agent.TypeIndex);
+	UCharacterPoolSubsystem* Pool = GetWorld()->GetSubsystem<UCharacterPoolSubsystem>();
+	if (!CrowdType || !CrowdType->CharacterClass || !Pool)
+	{
+		return false;
+	}
+
+	// Agents stand on the ground, characters are placed by the center of their capsule
+	const UCapsuleComponent* Capsule = CrowdType->CharacterClass->GetDefaultObject<ACharBase>()->GetCapsuleComponent();
+	const float HalfHeight = Capsule ? Capsule->GetScaledCapsuleHalfHeight() : 0.0f;
+	const float Yaw = (Agent.LegEnd - Agent.LegStart).Rotation().Yaw;
+	const FTransform SpawnTransform(FRotator(0.0f, Yaw, 0.0f), Location + FVector(0.0f, 0.0f, HalfHeight));
+
+	ACharBase* Character = Pool->AcquireCharacter(CrowdType->CharacterClass, SpawnTransform);
+	if (!Character)
+	{
+		return false;
+	}
+
+	FPromotedAgent& PromotedAgent = Promoted.AddDefaulted_GetRef();
+	PromotedAgent.Character = Character;
+	PromotedAgent.Home = Agent.Home;
+	PromotedAgent.TypeIndex = Agent.TypeIndex;
+	return true;
+}
+
+void UEnemyCrowdSubsystem::DemoteCharacters(AEnemyCrowdActor& CrowdActor, float ServerTime)
+{
+	UCharacterPoolSubsystem* Pool = GetWorld()->GetSubsystem<UCharacterPoolSubsystem>();
+	const float WorldTime = GetWorld()->GetTimeSeconds();
+	const float DemotionRadiusSquared = DemotionRadius * DemotionRadius;
+
+	for (int32 Index = Promoted.Num() - 1; Index >= 0; --Index)
+	{
+		ACharBase* Character = Promoted[Index].Character.Get();
+
+		// Died and went back to the pool, or was destroyed. The agent is gone for good
+		if (!Character || Character->IsInPool())
+		{
+			Promoted.RemoveAtSwap(Index, 1, false);
+			continue;
+		}
+
+		const FVector CharacterLocation = Character->GetActorLocation();
+		if (!Character->IsAlive() || IsNearPlayer(CharacterLocation, DemotionRadiusSquared))
+		{
+			continue;
+		}
+
+		const UCharacterAbilitySystemComponent* AbilitySystemComponent = Cast<UCharacterAbilitySystemComponent>(Character->GetAbilitySystemComponent());
+		if (AbilitySystemComponent && WorldTime - AbilitySystemComponent->GetLastCombatTime() < CombatWindow)
+		{
+			continue;
+		}
+
+		const float HalfHeight = Character->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+		AddAgent(CrowdActor, Promoted[Index].TypeIndex, CharacterLocation - FVector(0.0f, 0.0f, HalfHeight), Promoted[Index].Home, ServerTime);
+		Pool->ReleaseCharacter(Character);
+		Promoted.RemoveAtSwap(Index, 1, false);
+
+		WB2023Metrics::CrowdDemotions.Add();
+	}
+}
+
+float UEnemyCrowdSubsystem::GetServerTime() const
+{
+	const UWorld* World = GetWorld();
+	const AGameStateBase* GameState = World->GetGameState();
+	return GameState ? GameState->GetServerWorldTimeSeconds() : World->GetTimeSeconds();
+}
+
+void UEnemyCrowdSubsystem::TickBenchmark(float DeltaTime, double CrowdSeconds)
+{
+	Benchmark.FrameMs.Add(DeltaTime * 1000.0f);
+	Benchmark.GameThreadMs.Add(FPlatformTime::ToMilliseconds(GGameThreadTime));
+	Benchmark.CrowdSeconds += CrowdSeconds;
+
+	Benchmark.TimeLeft -= DeltaTime;
+	if (Benchmark.TimeLeft > 0.0f)
+	{
+		return;
+	}
+
+	const int32 NumFrames = Benchmark.FrameMs.Num();
+	auto Average = [NumFrames](const TArray<float>& Values)
+	{
+		float Sum = 0.0f;
+		for (float Value : Values)
+		{
+			Sum += Value;
+		}
+		return NumFrames > 0 ? Sum / NumFrames : 0.0f;
+	};
+	auto Percentile95 = [NumFrames](TArray<float>& Values)
+	{
+		Values.Sort();
+		return NumFrames > 0 ? Values[FMath::Min(NumFrames * 95 / 100, NumFrames - 1)] : 0.0f;
+	};
+
+	const TCHAR* NetModeName = GetWorld()->GetNetMode() == NM_Client ? TEXT("Client") : TEXT("Server");
+	const float AverageFrameMs = Average(Benchmark.FrameMs);
+	const float AverageGameThreadMs = Average(Benchmark.GameThreadMs);
+	const float P95FrameMs = Percentile95(Benchmark.FrameMs);
+	const float P95GameThreadMs = Percentile95(Benchmark.GameThreadMs);
+	const double AverageCrowdMs = NumFrames > 0 ? Benchmark.CrowdSeconds * 1000.0 / NumFrames : 0.0;
+
+	UE_LOG(LogWB2023, Display, TEXT("Crowd benchmark %s: Agents=%d Promoted=%d Frames=%d AvgFrameMs=%.2f P95FrameMs=%.2f AvgGameThreadMs=%.2f P95GameThreadMs=%.2f AvgCrowdMs=%.3f"),
+		NetModeName, Locations.Num(), Promoted.Num(), NumFrames, AverageFrameMs, P95FrameMs, AverageGameThreadMs, P95GameThreadMs, AverageCrowdMs);
+
+	const FString OutputPath = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / TEXT("CrowdLoad.csv");
+	FString Csv;
+	if (!FPaths::FileExists(OutputPath))
+	{
+		Csv = TEXT("NetMode,Agents,Promoted,Frames,AvgFrameMs,P95FrameMs,AvgGameThreadMs,P95GameThreadMs,AvgCrowdMs\n");
+	}
+	Csv += FString::Printf(TEXT("%s,%d,%d,%d,%.2f,%.2f,%.2f,%.2f,%.3f\n"),
+		NetModeName, Locations.Num(), Promoted.Num(), NumFrames, AverageFrameMs, P95FrameMs, AverageGameThreadMs, P95GameThreadMs, AverageCrowdMs);
+	FFileHelper::SaveStringToFile(Csv, *OutputPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+
+	Benchmark = FBenchmarkState();
+}
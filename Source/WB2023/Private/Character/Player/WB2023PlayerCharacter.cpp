@@ -10,6 +10,7 @@
 #include "Player/WB2023PlayerState.h"
 #include "Character/Player/WB2023PlayerCharacter.h"
 #include "Player/WB2023PlayerController.h"
+#include "WB2023GameplayTags.h"
 #include "Character/Abilities/CharacterAbilitySystemComponent.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Components/InputComponent.h"
@@ -36,7 +37,7 @@ AWB2023PlayerCharacter::AWB2023PlayerCharacter(const FObjectInitializer& ObjectI
 
     AIControllerClass = APlayerAIController::StaticClass();
 
-    DeadTag = FGameplayTag::RequestGameplayTag(FName("State.Dead"));
+    DeadTag = WB2023GameplayTags::State_Dead;
 }
 
 void AWB2023PlayerCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
@@ -146,13 +147,17 @@ void AWB2023PlayerCharacter::MoveForward(const FInputActionValue& Instance)
     if (IsAlive())
     {
         float FloatValue = Instance.Get<float>();
-        UE_LOG(LogTemp, Warning, TEXT("Text, %f"), FloatValue);
+#if !UE_BUILD_SHIPPING
+        UE_LOG(LogWB2023Input, VeryVerbose, TEXT("MoveForward %f"), FloatValue);
+#endif
         FVector Forward = GetActorForwardVector();
         AddMovementInput(Forward, FloatValue);
     }
     else
     {
-        UE_LOG(LogTemp, Warning, TEXT("Dead"));
+#if !UE_BUILD_SHIPPING
+        UE_LOG(LogWB2023Input, VeryVerbose, TEXT("MoveForward ignored, %s is dead"), *GetName());
+#endif
     }
 }
 
@@ -176,7 +181,10 @@ void AWB2023PlayerCharacter::OnRep_PlayerState()
     {
         InitializeStartingValues(PS);
         BindASCInput();
-    }  
+    }
+
+    // PossessedBy only runs on the server
+    PreloadAbilityAssets();
 }
 
 void AWB2023PlayerCharacter::InitializeStartingValues(AWB2023PlayerState* PS)
@@ -191,6 +199,8 @@ void AWB2023PlayerCharacter::InitializeStartingValues(AWB2023PlayerState* PS)
     AbilitySystemComponent->SetTagMapCount(DeadTag, 0);
     SetHealth(GetMaxHealth());
     SetMana(GetMaxMana());
+
+    OnAbilitySystemInitialized();
 }
 
 void AWB2023PlayerCharacter::BindASCInput()
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Metrics/MetricsExporterSubsystem.h"
+#include "Metrics/WB2023Metrics.h"
+#include "WB2023/WB2023.h"
+#include "HAL/FileManager.h"
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+namespace MetricsExporter_Impl
+{
+	class FFlushRunnable : public FRunnable
+	{
+	public:
+		FFlushRunnable(const FString& InOutputPath, float InIntervalSeconds)
+			: OutputPath(InOutputPath)
+			, TempPath(InOutputPath + TEXT(".tmp"))
+			, IntervalMs(FMath::Max(static_cast<uint32>(InIntervalSeconds * 1000.0f), 100u))
+			, StopEvent(FPlatformProcess::GetSynchEventFromPool(true))
+		{
+		}
+
+		virtual ~FFlushRunnable() override
+		{
+			FPlatformProcess::ReturnSynchEventToPool(StopEvent);
+		}
+
+		virtual uint32 Run() override
+		{
+			// Wait returns true once Stop triggers the event, flush one last time either way
+			bool bStopping = false;
+			while (!bStopping)
+			{
+				bStopping = StopEvent->Wait(IntervalMs);
+				Flush();
+			}
+			return 0;
+		}
+
+		virtual void Stop() override
+		{
+			StopEvent->Trigger();
+		}
+
+	private:
+		void Flush()
+		{
+			// Written next to the target and moved over it so readers never see a partial file
+			if (FFileHelper::SaveStringToFile(FWB2023Metric::WriteAll(), *TempPath))
+			{
+				IFileManager::Get().Move(*OutputPath, *TempPath, true, true);
+			}
+		}
+
+		FString OutputPath;
+		FString TempPath;
+		uint32 IntervalMs;
+		FEvent* StopEvent;
+	};
+}
+
+void UMetricsExporterSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const bool bEnabled = FParse::Param(FCommandLine::Get(), TEXT("WB2023Metrics")) || (bEnableOnDedicatedServer && IsRunningDedicatedServer());
+	if (!bEnabled || !FPlatformProcess::SupportsMultithreading())
+	{
+		return;
+	}
+
+	const FString OutputPath = FPaths::ProjectSavedDir() / OutputFile;
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(OutputPath), true);
+
+	FlushRunnable = new MetricsExporter_Impl::FFlushRunnable(OutputPath, FlushIntervalSeconds);
+	FlushThread = FRunnableThread::Create(FlushRunnable, TEXT("WB2023MetricsFlush"), 0, TPri_Lowest);
+
+	UE_LOG(LogWB2023, Log, TEXT("Metrics exporter writing %s every %.1fs"), *OutputPath, FlushIntervalSeconds);
+}
+
+void UMetricsExporterSubsystem::Deinitialize()
+{
+	if (FlushThread)
+	{
+		// Kill(true) calls Stop and waits for Run to return
+		FlushThread->Kill(true);
+		delete FlushThread;
+		FlushThread = nullptr;
+	}
+	delete FlushRunnable;
+	FlushRunnable = nullptr;
+
+	Super::Deinitialize();
+}
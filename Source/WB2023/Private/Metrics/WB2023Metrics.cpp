@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Metrics/WB2023Metrics.h"
+
+namespace WB2023Metrics_Impl
+{
+	// Constant initialized, so it's valid before any metric's constructor runs
+	static std::atomic<FWB2023Metric*> FirstMetric{ nullptr };
+}
+
+namespace WB2023Metrics
+{
+	FWB2023MetricCounter AbilitiesActivated(TEXT("wb2023_abilities_activated_total"), TEXT("Abilities activated"));
+	FWB2023MetricCounter AbilitiesCanceled(TEXT("wb2023_abilities_canceled_total"), TEXT("Abilities that ended canceled"));
+	FWB2023MetricCounter EffectsApplied(TEXT("wb2023_effects_applied_total"), TEXT("Gameplay effects applied"));
+	FWB2023MetricCounter DamageEvents(TEXT("wb2023_damage_events_total"), TEXT("Damage executions received"));
+	FWB2023MetricHistogram DamageTaken(TEXT("wb2023_damage_taken"), TEXT("Mitigated damage per damage event"), { 1.0, 5.0, 10.0, 25.0, 50.0, 100.0, 250.0, 500.0, 1000.0 });
+	FWB2023MetricCounter Deaths(TEXT("wb2023_deaths_total"), TEXT("Characters that died"));
+	FWB2023MetricGauge PlayerStates(TEXT("wb2023_player_states"), TEXT("WB2023 PlayerStates in play"));
+	FWB2023MetricCounter PlayerStateForcedNetUpdates(TEXT("wb2023_player_state_forced_net_updates_total"), TEXT("PlayerState ForceNetUpdate calls"));
+	FWB2023MetricGauge CrowdAgents(TEXT("wb2023_crowd_agents"), TEXT("Enemies in the crowd"));
+	FWB2023MetricCounter CrowdPromotions(TEXT("wb2023_crowd_promotions_total"), TEXT("Crowd agents promoted to characters"));
+	FWB2023MetricCounter CrowdDemotions(TEXT("wb2023_crowd_demotions_total"), TEXT("Characters demoted back into the crowd"));
+	FWB2023MetricCounter PathQueries(TEXT("wb2023_path_queries_total"), TEXT("Async navmesh path queries"));
+	FWB2023MetricCounter PathsShared(TEXT("wb2023_paths_shared_total"), TEXT("AI paths served from another query's path"));
+	FWB2023MetricCounter KitPreloads(TEXT("wb2023_kit_preloads_total"), TEXT("Character kit bundles preloaded"));
+	FWB2023MetricHistogram KitPreloadTime(TEXT("wb2023_kit_preload_ms"), TEXT("Milliseconds to preload a character kit's bundles"), { 5.0, 10.0, 25.0, 50.0, 100.0, 250.0, 500.0, 1000.0, 2500.0 });
+}
+
+FWB2023Metric::FWB2023Metric(const TCHAR* InName, const TCHAR* InHelp)
+	: Name(InName)
+	, Help(InHelp)
+{
+	using namespace WB2023Metrics_Impl;
+
+	Next = FirstMetric.load(std::memory_order_relaxed);
+	while (!FirstMetric.compare_exchange_weak(Next, this, std::memory_order_release, std::memory_order_relaxed))
+	{
+	}
+}
+
+const FWB2023Metric* FWB2023Metric::GetFirst()
+{
+	return WB2023Metrics_Impl::FirstMetric.load(std::memory_order_acquire);
+}
+
+FString FWB2023Metric::WriteAll()
+{
+	FString Out;
+	for (const FWB2023Metric* Metric = GetFirst(); Metric; Metric = Metric->GetNext())
+	{
+		Metric->Write(Out);
+	}
+	return Out;
+}
+
+void FWB2023Metric::WriteHeader(FString& Out, const TCHAR* Type) const
+{
+	Out += FString::Printf(TEXT("# HELP %s %s\n# TYPE %s %s\n"), Name, Help, Name, Type);
+}
+
+void FWB2023MetricCounter::Write(FString& Out) const
+{
+	WriteHeader(Out, TEXT("counter"));
+	Out += FString::Printf(TEXT("%s %lld\n"), Name, Value.load(std::memory_order_relaxed));
+}
+
+void FWB2023MetricGauge::Write(FString& Out) const
+{
+	WriteHeader(Out, TEXT("gauge"));
+	Out += FString::Printf(TEXT("%s %lld\n"), Name, Value.load(std::memory_order_relaxed));
+}
+
+FWB2023MetricHistogram::FWB2023MetricHistogram(const TCHAR* InName, const TCHAR* InHelp, std::initializer_list<double> UpperBounds)
+	: FWB2023Metric(InName, InHelp)
+{
+	for (const double UpperBound : UpperBounds)
+	{
+		if (NumBounds < MaxBuckets)
+		{
+			Bounds[NumBounds++] = UpperBound;
+		}
+	}
+}
+
+void FWB2023MetricHistogram::Observe(double Value)
+{
+	int32 Bucket = 0;
+	while (Bucket < NumBounds && Value > Bounds[Bucket])
+	{
+		++Bucket;
+	}
+
+	BucketCounts[Bucket].fetch_add(1, std::memory_order_relaxed);
+	Count.fetch_add(1, std::memory_order_relaxed);
+	SumMilli.fetch_add(static_cast<int64>(Value * 1000.0), std::memory_order_relaxed);
+}
+
+void FWB2023MetricHistogram::Write(FString& Out) const
+{
+	WriteHeader(Out, TEXT("histogram"));
+
+	// Buckets are read one by one, a sample landing mid write shows up in the next flush
+	uint64 Cumulative = 0;
+	for (int32 Bucket = 0; Bucket < NumBounds; ++Bucket)
+	{
+		Cumulative += BucketCounts[Bucket].load(std::memory_order_relaxed);
+		Out += FString::Printf(TEXT("%s_bucket{le=\"%g\"} %llu\n"), Name, Bounds[Bucket], Cumulative);
+	}
+	Cumulative += BucketCounts[NumBounds].load(std::memory_order_relaxed);
+	Out += FString::Printf(TEXT("%s_bucket{le=\"+Inf\"} %llu\n"), Name, Cumulative);
+	Out += FString::Printf(TEXT("%s_sum %.3f\n"), Name, SumMilli.load(std::memory_order_relaxed) / 1000.0);
+	Out += FString::Printf(TEXT("%s_count %llu\n"), Name, Count.load(std::memory_order_relaxed));
+}
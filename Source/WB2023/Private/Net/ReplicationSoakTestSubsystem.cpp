@@ -0,0 +1,284 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Net/ReplicationSoakTestSubsystem.h"
+#include "AbilitySystemComponent.h"
+#include "AbilitySystemGlobals.h"
+#include "Character/EnemyCrowdSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "Engine/World.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "WB2023/WB2023.h"
+
+namespace ReplicationSoakTest_Impl
+{
+	constexpr float SampleInterval = 1.0f;
+	constexpr float BotMoveInterval = 2.0f;
+	constexpr float BotAbilityInterval = 1.5f;
+}
+
+bool UReplicationSoakTestSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	if (!World || !World->IsGameWorld())
+	{
+		return false;
+	}
+
+	return FParse::Param(FCommandLine::Get(), TEXT("WB2023Soak")) || FParse::Param(FCommandLine::Get(), TEXT("WB2023SoakBot"));
+}
+
+void UReplicationSoakTestSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	const TCHAR* CommandLine = FCommandLine::Get();
+	bServer = FParse::Param(CommandLine, TEXT("WB2023Soak")) && InWorld.GetNetMode() != NM_Client;
+	FParse::Value(CommandLine, TEXT("SoakCrowd="), NumCrowdAgents);
+	FParse::Value(CommandLine, TEXT("SoakDuration="), Duration);
+	if (!bServer)
+	{
+		BotCrowdBenchmarkDelay = NumCrowdAgents > 0 ? WarmupSeconds : 0.0f;
+		return;
+	}
+
+	FParse::Value(CommandLine, TEXT("SoakClients="), NumClients);
+	FParse::Value(CommandLine, TEXT("SoakLag="), LagMs);
+	FParse::Value(CommandLine, TEXT("SoakLoss="), LossPercent);
+	FParse::Value(CommandLine, TEXT("SoakMaxAvgBytes="), MaxAverageBytesPerConnection);
+	FParse::Value(CommandLine, TEXT("SoakMaxPeakBytes="), MaxPeakBytesPerConnection);
+
+	// Server side half of the emulation, clients get the same settings on their command line
+	if (GEngine)
+	{
+		GEngine->Exec(&InWorld, *FString::Printf(TEXT("NetEmulation.PktLag %d"), LagMs));
+		GEngine->Exec(&InWorld, *FString::Printf(TEXT("NetEmulation.PktLoss %d"), LossPercent));
+	}
+
+	LaunchClients();
+
+	UE_LOG(LogWB2023Net, Display, TEXT("Replication soak: %d clients, %.0fs, %dms lag, %d%% loss, limits avg %d B/s peak %d B/s per connection"),
+		NumClients, Duration, LagMs, LossPercent, MaxAverageBytesPerConnection, MaxPeakBytesPerConnection);
+}
+
+void UReplicationSoakTestSubsystem::Deinitialize()
+{
+	for (FProcHandle& ClientProcess : ClientProcesses)
+	{
+		if (FPlatformProcess::IsProcRunning(ClientProcess))
+		{
+			FPlatformProcess::TerminateProc(ClientProcess);
+		}
+		FPlatformProcess::CloseProc(ClientProcess);
+	}
+	ClientProcesses.Reset();
+
+	Super::Deinitialize();
+}
+
+void UReplicationSoakTestSubsystem::Tick(float DeltaTime)
+{
+	using namespace ReplicationSoakTest_Impl;
+
+	Super::Tick(DeltaTime);
+
+	if (!bServer)
+	{
+		TickBot(DeltaTime);
+		return;
+	}
+
+	if (bFinished)
+	{
+		return;
+	}
+
+	if (!bStarted)
+	{
+		// Start the clock once everyone is in
+		const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+		if (!NetDriver || NetDriver->ClientConnections.Num() < NumClients)
+		{
+			ConnectSeconds += DeltaTime;
+			if (ConnectSeconds >= ConnectTimeoutSeconds)
+			{
+				FailSoak(FString::Printf(TEXT("%d of %d clients connected after %.0fs"),
+					NetDriver ? NetDriver->ClientConnections.Num() : 0, NumClients, ConnectSeconds));
+			}
+			return;
+		}
+
+		bStarted = true;
+		MeasuredSeconds = -WarmupSeconds;
+	}
+
+	// Spawned once everyone is in so promotion and the first legs settle during the warmup
+	if (!bCrowdSpawned && NumCrowdAgents > 0)
+	{
+		bCrowdSpawned = true;
+		if (UEnemyCrowdSubsystem* CrowdSubsystem = GetWorld()->GetSubsystem<UEnemyCrowdSubsystem>())
+		{
+			CrowdSubsystem->SpawnAgents(0, FVector::ZeroVector, 20000.0f, NumCrowdAgents);
+		}
+	}
+
+	MeasuredSeconds += DeltaTime;
+	if (MeasuredSeconds < 0.0f)
+	{
+		return;
+	}
+
+	if (!bCrowdBenchmarkStarted && NumCrowdAgents > 0)
+	{
+		bCrowdBenchmarkStarted = true;
+		if (UEnemyCrowdSubsystem* CrowdSubsystem = GetWorld()->GetSubsystem<UEnemyCrowdSubsystem>())
+		{
+			CrowdSubsystem->StartBenchmark(Duration);
+		}
+	}
+
+	SampleAccumulator += DeltaTime;
+	if (SampleAccumulator >= SampleInterval)
+	{
+		SampleAccumulator -= SampleInterval;
+		SampleConnections();
+	}
+
+	if (MeasuredSeconds >= Duration)
+	{
+		FinishSoak();
+	}
+}
+
+TStatId UReplicationSoakTestSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UReplicationSoakTestSubsystem, STATGROUP_Tickables);
+}
+
+void UReplicationSoakTestSubsystem::LaunchClients()
+{
+	const int32 Port = GetWorld()->URL.Port;
+	const FString ProjectPath = FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath());
+
+	for (int32 ClientIndex = 0; ClientIndex < NumClients; ++ClientIndex)
+	{
+		const FString Params = FString::Printf(TEXT("\"%s\" 127.0.0.1:%d -game -nullrhi -nosound -unattended -WB2023SoakBot -PktLag=%d -PktLoss=%d -SoakCrowd=%d -SoakDuration=%.0f -log=SoakBot%d.log"),
+			*ProjectPath, Port, LagMs, LossPercent, NumCrowdAgents, Duration, ClientIndex);
+
+		FProcHandle ClientProcess = FPlatformProcess::CreateProc(FPlatformProcess::ExecutablePath(), *Params, true, true, true, nullptr, 0, nullptr, nullptr);
+		if (ClientProcess.IsValid())
+		{
+			ClientProcesses.Add(ClientProcess);
+		}
+		else
+		{
+			UE_LOG(LogWB2023Net, Error, TEXT("Replication soak: could not launch client %d"), ClientIndex);
+		}
+	}
+}
+
+void UReplicationSoakTestSubsystem::SampleConnections()
+{
+	const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	if (!NetDriver)
+	{
+		return;
+	}
+
+	for (UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		FConnectionSamples& Samples = ConnectionSamples.FindOrAdd(Connection);
+		if (Samples.Name.IsEmpty())
+		{
+			Samples.Name = Connection->LowLevelGetRemoteAddress(true);
+		}
+
+		Samples.TotalBytes += Connection->OutBytesPerSecond;
+		Samples.PeakBytesPerSecond = FMath::Max(Samples.PeakBytesPerSecond, Connection->OutBytesPerSecond);
+		++Samples.NumSamples;
+	}
+}
+
+void UReplicationSoakTestSubsystem::FinishSoak()
+{
+	bFinished = true;
+
+	bool bPassed = ConnectionSamples.Num() > 0;
+	FString Csv = TEXT("Connection,Samples,AverageBytesPerSecond,PeakBytesPerSecond,Passed\n");
+	for (const TPair<TWeakObjectPtr<UNetConnection>, FConnectionSamples>& Pair : ConnectionSamples)
+	{
+		const FConnectionSamples& Samples = Pair.Value;
+		const int64 AverageBytes = Samples.NumSamples > 0 ? Samples.TotalBytes / Samples.NumSamples : 0;
+		const bool bConnectionPassed = AverageBytes <= MaxAverageBytesPerConnection && Samples.PeakBytesPerSecond <= MaxPeakBytesPerConnection;
+		bPassed &= bConnectionPassed;
+
+		Csv += FString::Printf(TEXT("%s,%d,%lld,%d,%d\n"), *Samples.Name, Samples.NumSamples, AverageBytes, Samples.PeakBytesPerSecond, bConnectionPassed ? 1 : 0);
+		UE_LOG(LogWB2023Net, Display, TEXT("Replication soak %s: avg %lld B/s peak %d B/s %s"),
+			*Samples.Name, AverageBytes, Samples.PeakBytesPerSecond, bConnectionPassed ? TEXT("ok") : TEXT("OVER LIMIT"));
+	}
+
+	const FString OutputPath = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / TEXT("ReplicationSoak.csv");
+	FFileHelper::SaveStringToFile(Csv, *OutputPath);
+
+	UE_LOG(LogWB2023Net, Display, TEXT("Replication soak %s, wrote %s"), bPassed ? TEXT("passed") : TEXT("FAILED"), *OutputPath);
+	FPlatformMisc::RequestExitWithStatus(false, bPassed ? 0 : 1);
+}
+
+void UReplicationSoakTestSubsystem::FailSoak(const FString& Reason)
+{
+	bFinished = true;
+
+	UE_LOG(LogWB2023Net, Error, TEXT("Replication soak FAILED: %s"), *Reason);
+	FPlatformMisc::RequestExitWithStatus(false, 1);
+}
+
+void UReplicationSoakTestSubsystem::TickBot(float DeltaTime)
+{
+	using namespace ReplicationSoakTest_Impl;
+
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+	if (!Pawn)
+	{
+		return;
+	}
+
+	BotMoveTimeLeft -= DeltaTime;
+	if (BotMoveTimeLeft <= 0.0f)
+	{
+		BotMoveTimeLeft = BotMoveInterval;
+		BotMoveDirection = FRotator(0.0f, FMath::FRandRange(0.0f, 360.0f), 0.0f).Vector();
+	}
+	Pawn->AddMovementInput(BotMoveDirection);
+
+	if (!bCrowdBenchmarkStarted && NumCrowdAgents > 0)
+	{
+		BotCrowdBenchmarkDelay -= DeltaTime;
+		UEnemyCrowdSubsystem* CrowdSubsystem = GetWorld()->GetSubsystem<UEnemyCrowdSubsystem>();
+		if (CrowdSubsystem && BotCrowdBenchmarkDelay <= 0.0f)
+		{
+			bCrowdBenchmarkStarted = true;
+			CrowdSubsystem->StartBenchmark(Duration);
+		}
+	}
+
+	BotAbilityTimeLeft -= DeltaTime;
+	if (BotAbilityTimeLeft <= 0.0f)
+	{
+		BotAbilityTimeLeft = BotAbilityInterval;
+
+		UAbilitySystemComponent* AbilitySystemComponent = UAbilitySystemGlobals::GetAbilitySystemComponentFromActor(PlayerController->PlayerState);
+		if (AbilitySystemComponent && AbilitySystemComponent->GetActivatableAbilities().Num() > 0)
+		{
+			const TArray<FGameplayAbilitySpec>& Abilities = AbilitySystemComponent->GetActivatableAbilities();
+			AbilitySystemComponent->TryActivateAbility(Abilities[FMath::RandHelper(Abilities.Num())].Handle);
+		}
+	}
+}
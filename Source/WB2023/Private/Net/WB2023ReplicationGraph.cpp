@@ -0,0 +1,283 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Net/WB2023ReplicationGraph.h"
+#include "Character/CharBase.h"
+#include "Player/WB2023PlayerState.h"
+#include "Engine/NetConnection.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Kismet/GameplayStatics.h"
+#include "UObject/UObjectIterator.h"
+
+namespace WB2023ReplicationGraph_Impl
+{
+	// Character counts the benchmark steps through
+	constexpr int32 BenchmarkCharacterCounts[] = { 16, 64, 128 };
+	constexpr int32 BenchmarkWarmupFrames = 30;
+	constexpr int32 BenchmarkMeasuredFrames = 300;
+	constexpr float BenchmarkSpawnRadius = 20000.0f;
+
+	static FAutoConsoleCommandWithWorldAndArgs BenchmarkCommand(
+		TEXT("WB2023.RepGraph.Benchmark"),
+		TEXT("Server only. Spawns 16, 64 and 128 characters in turn and logs replication CPU time and bytes sent.\n")
+		TEXT("Usage: WB2023.RepGraph.Benchmark [CharacterClassPath]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+			UWB2023ReplicationGraph* Graph = NetDriver ? Cast<UWB2023ReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr;
+			if (!Graph)
+			{
+				UE_LOG(LogWB2023Net, Error, TEXT("WB2023.RepGraph.Benchmark needs a server running UWB2023ReplicationGraph"));
+				return;
+			}
+
+			TSubclassOf<ACharBase> CharacterClass = ACharBase::StaticClass();
+			if (Args.Num() > 0)
+			{
+				CharacterClass = LoadClass<ACharBase>(nullptr, *Args[0]);
+				if (!CharacterClass)
+				{
+					UE_LOG(LogWB2023Net, Error, TEXT("WB2023.RepGraph.Benchmark could not load character class %s"), *Args[0]);
+					return;
+				}
+			}
+
+			Graph->StartBenchmark(CharacterClass);
+		}));
+}
+
+void UWB2023ReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	const ACharBase* CharacterCDO = GetDefault<ACharBase>();
+	CharacterReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(CharacterCDO->NetUpdateFrequency);
+
+	FClassReplicationInfo CharacterInfo;
+	CharacterInfo.ReplicationPeriodFrame = CharacterReplicationPeriodFrame;
+	CharacterInfo.SetCullDistanceSquared(CharacterCullDistance * CharacterCullDistance);
+
+	// Loaded character blueprints already got class info from the super call, override all of them
+	GlobalActorReplicationInfoMap.SetClassInfo(ACharBase::StaticClass(), CharacterInfo);
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		if (Class != ACharBase::StaticClass() && Class->IsChildOf(ACharBase::StaticClass()))
+		{
+			GlobalActorReplicationInfoMap.SetClassInfo(Class, CharacterInfo);
+		}
+	}
+}
+
+void UWB2023ReplicationGraph::InitGlobalGraphNodes()
+{
+	Super::InitGlobalGraphNodes();
+
+	GridNode->CellSize = CellSize;
+
+	PlayerStateNode = CreateNewNode<UReplicationGraphNode_PlayerStateFrequencyLimiter>();
+	AddGlobalGraphNode(PlayerStateNode);
+}
+
+void UWB2023ReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	// Skips UBasicReplicationGraph so the connection gets our always relevant node instead of the stock one
+	UReplicationGraph::InitConnectionGraphNodes(RepGraphConnection);
+
+	UWB2023ReplicationGraphNode_AlwaysRelevant_ForConnection* AlwaysRelevantConnectionNode = CreateNewNode<UWB2023ReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(AlwaysRelevantConnectionNode, RepGraphConnection);
+
+	AlwaysRelevantForConnectionList.Emplace(RepGraphConnection->NetConnection, AlwaysRelevantConnectionNode);
+}
+
+void UWB2023ReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	if (ActorInfo.Actor->IsA<ACharBase>())
+	{
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		CharacterList.Add(ActorInfo.Actor);
+	}
+	else if (ActorInfo.Actor->IsA<APlayerState>())
+	{
+		// Gathered by PlayerStateNode, and by the owning connection's always relevant node
+	}
+	else
+	{
+		Super::RouteAddNetworkActorToNodes(ActorInfo, GlobalInfo);
+	}
+}
+
+void UWB2023ReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	if (ActorInfo.Actor->IsA<ACharBase>())
+	{
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		CharacterList.RemoveFast(ActorInfo.Actor);
+	}
+	else if (!ActorInfo.Actor->IsA<APlayerState>())
+	{
+		Super::RouteRemoveNetworkActorToNodes(ActorInfo);
+	}
+}
+
+int32 UWB2023ReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	if (Benchmark.StepIndex == INDEX_NONE)
+	{
+		return Super::ServerReplicateActors(DeltaSeconds);
+	}
+
+	const uint32 OutBytesBefore = NetDriver->OutTotalBytes;
+	const double StartTime = FPlatformTime::Seconds();
+
+	const int32 Result = Super::ServerReplicateActors(DeltaSeconds);
+
+	TickBenchmark(FPlatformTime::Seconds() - StartTime, NetDriver->OutTotalBytes - OutBytesBefore);
+	return Result;
+}
+
+void UWB2023ReplicationGraph::StartBenchmark(TSubclassOf<ACharBase> CharacterClass)
+{
+	DestroyBenchmarkCharacters();
+
+	Benchmark = FBenchmarkState();
+	Benchmark.CharacterClass = CharacterClass;
+	Benchmark.StepIndex = 0;
+
+	UE_LOG(LogWB2023Net, Display, TEXT("RepGraph benchmark started with %s, %d connections"), *GetNameSafe(CharacterClass), Connections.Num());
+}
+
+void UWB2023ReplicationGraph::TickBenchmark(double ReplicateSeconds, uint32 BytesSent)
+{
+	using namespace WB2023ReplicationGraph_Impl;
+
+	UWorld* World = GetWorld();
+	const int32 TargetCount = BenchmarkCharacterCounts[Benchmark.StepIndex];
+
+	// Spawn around the first player so the grid sees a mix of near and distant characters
+	if (Benchmark.Characters.Num() < TargetCount)
+	{
+		APawn* CenterPawn = UGameplayStatics::GetPlayerPawn(World, 0);
+		const FVector Center = CenterPawn ? CenterPawn->GetActorLocation() : FVector::ZeroVector;
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+		while (Benchmark.Characters.Num() < TargetCount)
+		{
+			const FVector2D Offset = FMath::RandPointInCircle(BenchmarkSpawnRadius);
+			const FVector Location = Center + FVector(Offset.X, Offset.Y, 0.0f);
+			Benchmark.Characters.Add(World->SpawnActor<ACharBase>(Benchmark.CharacterClass, Location, FRotator::ZeroRotator, SpawnParams));
+		}
+	}
+
+	// Keep the characters moving so they have something to replicate
+	for (const TWeakObjectPtr<ACharBase>& Character : Benchmark.Characters)
+	{
+		if (Character.IsValid())
+		{
+			Character->AddActorWorldOffset(FVector(FMath::FRandRange(-5.0f, 5.0f), FMath::FRandRange(-5.0f, 5.0f), 0.0f));
+		}
+	}
+
+	++Benchmark.FramesInStep;
+	if (Benchmark.FramesInStep <= BenchmarkWarmupFrames)
+	{
+		return;
+	}
+
+	Benchmark.ReplicateSeconds += ReplicateSeconds;
+	Benchmark.BytesSent += BytesSent;
+
+	if (Benchmark.FramesInStep < BenchmarkWarmupFrames + BenchmarkMeasuredFrames)
+	{
+		return;
+	}
+
+	UE_LOG(LogWB2023Net, Display, TEXT("RepGraph benchmark: Characters=%d Connections=%d AvgReplicateMs=%.3f AvgBytesPerFrame=%.1f"),
+		TargetCount, Connections.Num(),
+		Benchmark.ReplicateSeconds * 1000.0 / BenchmarkMeasuredFrames,
+		static_cast<double>(Benchmark.BytesSent) / BenchmarkMeasuredFrames);
+
+	Benchmark.FramesInStep = 0;
+	Benchmark.ReplicateSeconds = 0.0;
+	Benchmark.BytesSent = 0;
+
+	if (++Benchmark.StepIndex >= UE_ARRAY_COUNT(BenchmarkCharacterCounts))
+	{
+		DestroyBenchmarkCharacters();
+		Benchmark.StepIndex = INDEX_NONE;
+		UE_LOG(LogWB2023Net, Display, TEXT("RepGraph benchmark finished"));
+	}
+}
+
+void UWB2023ReplicationGraph::DestroyBenchmarkCharacters()
+{
+	for (const TWeakObjectPtr<ACharBase>& Character : Benchmark.Characters)
+	{
+		if (Character.IsValid())
+		{
+			Character->Destroy();
+		}
+	}
+
+	Benchmark.Characters.Reset();
+}
+
+void UWB2023ReplicationGraphNode_AlwaysRelevant_ForConnection::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	Super::GatherActorListsForConnection(Params);
+
+	// The connection's own PlayerState carries its ASC, so it is always gathered instead of going through the frequency limiter.
+	// Its rate follows the PlayerState's adaptive NetUpdateFrequency
+	const UWB2023ReplicationGraph* Graph = CastChecked<UWB2023ReplicationGraph>(GetOuter());
+	PlayerStateList.Reset();
+	for (const FNetViewer& Viewer : Params.Viewers)
+	{
+		APlayerController* PlayerController = Cast<APlayerController>(Viewer.InViewer);
+		AWB2023PlayerState* PlayerState = PlayerController ? PlayerController->GetPlayerState<AWB2023PlayerState>() : nullptr;
+		if (PlayerState && !PlayerStateList.Contains(PlayerState))
+		{
+			PlayerStateList.Add(PlayerState);
+
+			FConnectionReplicationActorInfo& ConnectionActorInfo = Params.ConnectionManager.ActorInfoMap.FindOrAdd(PlayerState);
+			ConnectionActorInfo.ReplicationPeriodFrame = Graph->GetPeriodFrameForFrequency(PlayerState->NetUpdateFrequency);
+		}
+	}
+
+	if (PlayerStateList.Num() > 0)
+	{
+		Params.OutGatheredReplicationLists.AddReplicationActorList(PlayerStateList);
+	}
+
+	if (Params.ReplicationFrameNum >= NextCharacterRateUpdateFrame)
+	{
+		// Stagger the first update so connections don't all refresh on the same frame
+		NextCharacterRateUpdateFrame = Params.ReplicationFrameNum + (NextCharacterRateUpdateFrame == 0 ? FMath::RandRange(1, static_cast<int32>(CharacterRateUpdatePeriod)) : CharacterRateUpdatePeriod);
+		UpdateCharacterReplicationRates(Params);
+	}
+}
+
+void UWB2023ReplicationGraphNode_AlwaysRelevant_ForConnection::UpdateCharacterReplicationRates(const FConnectionGatherActorListParameters& Params)
+{
+	const UWB2023ReplicationGraph* Graph = CastChecked<UWB2023ReplicationGraph>(GetOuter());
+	const float DistantDistanceSquared = Graph->DistantCharacterDistance * Graph->DistantCharacterDistance;
+	const uint32 NearPeriod = Graph->CharacterReplicationPeriodFrame;
+	const uint32 DistantPeriod = FMath::Max<uint32>(NearPeriod, Graph->DistantCharacterReplicationPeriodFrame);
+
+	for (FActorRepListType Actor : Graph->GetCharacterList())
+	{
+		const FVector Location = Actor->GetActorLocation();
+
+		float ClosestDistanceSquared = TNumericLimits<float>::Max();
+		for (const FNetViewer& Viewer : Params.Viewers)
+		{
+			ClosestDistanceSquared = FMath::Min<float>(ClosestDistanceSquared, FVector::DistSquared(Location, Viewer.ViewLocation));
+		}
+
+		FConnectionReplicationActorInfo& ConnectionActorInfo = Params.ConnectionManager.ActorInfoMap.FindOrAdd(Actor);
+		ConnectionActorInfo.ReplicationPeriodFrame = ClosestDistanceSquared > DistantDistanceSquared ? DistantPeriod : NearPeriod;
+	}
+}
@@ -4,6 +4,7 @@
 #include "Player/WB2023PlayerController.h"
 #include "Player/WB2023PlayerState.h"
 #include "AbilitySystemComponent.h"
+#include "Character/CharacterSignificance.h"
 
 void AWB2023PlayerController::OnPossess(APawn* InPawn)
 {
@@ -17,4 +18,20 @@ void AWB2023PlayerController::OnPossess(APawn* InPawn)
     }
 }
 
+void AWB2023PlayerController::PlayerTick(float DeltaTime)
+{
+    Super::PlayerTick(DeltaTime);
+
+    // Only the first local player updates, split screen would otherwise overwrite each other's results
+    if (GetWorld()->GetFirstPlayerController() == this)
+    {
+        FVector ViewLocation;
+        FRotator ViewRotation;
+        GetPlayerViewPoint(ViewLocation, ViewRotation);
+
+        const FTransform Viewpoint(ViewRotation, ViewLocation);
+        CharacterSignificance::Update(GetWorld(), MakeArrayView(&Viewpoint, 1), DeltaTime);
+    }
+}
+
 // TODO -- Add HUD Stuff
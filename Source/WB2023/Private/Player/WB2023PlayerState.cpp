@@ -4,6 +4,33 @@
 #include "Player/WB2023PlayerState.h"
 #include "Character/Abilities/AttributeSets/CharacterAttributeSetBase.h"
 #include "Character/Abilities/CharacterAbilitySystemComponent.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "WB2023GameplayTags.h"
+#include "WB2023/WB2023.h"
+#include "Metrics/WB2023Metrics.h"
+
+namespace WB2023PlayerState_Impl
+{
+#if !UE_BUILD_SHIPPING
+    static TAutoConsoleVariable<bool> CVarShowAttributeChanges(
+        TEXT("WB2023.PlayerState.ShowAttributeChanges"),
+        false,
+        TEXT("Prints every Health and Mana change of the player states on screen"));
+#endif
+
+    static FAutoConsoleCommandWithWorld NetRatesCommand(
+        TEXT("WB2023.PlayerState.NetRates"),
+        TEXT("Logs the configured and measured net update rate of every WB2023 PlayerState"),
+        FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+        {
+            for (TActorIterator<AWB2023PlayerState> It(World); It; ++It)
+            {
+                UE_LOG(LogWB2023Net, Display, TEXT("%s: NetUpdateFrequency=%.1f Measured=%.1f/s ForcedUpdates=%d"),
+                    *It->GetPlayerName(), It->NetUpdateFrequency, It->GetMeasuredNetUpdateRate(), It->GetNumForcedNetUpdates());
+            }
+        }));
+}
 
 AWB2023PlayerState::AWB2023PlayerState()
 {
@@ -15,9 +42,15 @@ AWB2023PlayerState::AWB2023PlayerState()
 
     AttributeSetBase = CreateDefaultSubobject<UCharacterAttributeSetBase>(TEXT("AttributeSetBase"));
 
-    NetUpdateFrequency = 100.0f;
+    NetUpdateFrequency = ActiveNetUpdateFrequency;
+    MinNetUpdateFrequency = IdleNetUpdateFrequency;
+
+    // Only ticks on the server to decay NetUpdateFrequency and measure the replication rate
+    PrimaryActorTick.bCanEverTick = true;
+    PrimaryActorTick.bStartWithTickEnabled = false;
+    PrimaryActorTick.TickInterval = 0.25f;
 
-    DeadTag = FGameplayTag::RequestGameplayTag(FName("State.Dead"));
+    DeadTag = WB2023GameplayTags::State_Dead;
 }
 
 UAbilitySystemComponent* AWB2023PlayerState::GetAbilitySystemComponent() const
@@ -37,7 +70,7 @@ bool AWB2023PlayerState::IsAlive() const
 
 void AWB2023PlayerState::ShowAbilityConfirmCancelText(bool ShowText)
 {
-    // TODO -- implement HUD later
+    OnShowAbilityConfirmCancelText.Broadcast(ShowText);
 }
 
 float AWB2023PlayerState::GetHealth() const
@@ -69,62 +102,207 @@ void AWB2023PlayerState::BeginPlay()
 {
     Super::BeginPlay();
 
+    WB2023Metrics::PlayerStates.Add(1);
+
+    if (bAdaptiveNetUpdateFrequency)
+    {
+        NetUpdateFrequency = ActiveNetUpdateFrequency;
+        MinNetUpdateFrequency = IdleNetUpdateFrequency;
+    }
+
     if (AbilitySystemComponent)
     {
-        // Linked the value changing event to the functions here
-        HealthChangedDelegateHandle = AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(AttributeSetBase->GetHealthAttribute()).AddUObject(this, &AWB2023PlayerState::HealthChanged);
-        MaxHealthChangedDelegateHandle = AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(AttributeSetBase->GetHealthAttribute()).AddUObject(this, &AWB2023PlayerState::MaxHealthChanged);
-        ManaChangedDelegateHandle = AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(AttributeSetBase->GetHealthAttribute()).AddUObject(this, &AWB2023PlayerState::ManaChanged);
-        MaxManaChangedDelegateHandle = AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(AttributeSetBase->GetHealthAttribute()).AddUObject(this, &AWB2023PlayerState::MaxManaChanged);
-        CharacterLevelChangedDelegateHandle = AbilitySystemComponent->GetGameplayAttributeValueChangeDelegate(AttributeSetBase->GetHealthAttribute()).AddUObject(this, &AWB2023PlayerState::CharacterLevelChanged);
-    
+        // Linked the value changing event to the functions here, batched once per frame by the ASC
+        const TArray<FGameplayAttribute> ObservedAttributes = {
+            AttributeSetBase->GetHealthAttribute(),
+            AttributeSetBase->GetMaxHealthAttribute(),
+            AttributeSetBase->GetManaAttribute(),
+            AttributeSetBase->GetMaxManaAttribute(),
+            AttributeSetBase->GetLevelAttribute()
+        };
+        AttributesChangedDelegateHandle = AbilitySystemComponent->AddAttributeChangeListener(ObservedAttributes,
+            FOnAttributesChangedDelegate::CreateUObject(this, &AWB2023PlayerState::AttributesChanged));
+
         // Called if the stunned debuff is added or removed
-        AbilitySystemComponent->RegisterGameplayTagEvent(FGameplayTag::RequestGameplayTag(FName("State.Debuff.Stun")), EGameplayTagEventType::NewOrRemoved).AddUObject(this, &AWB2023PlayerState::StunTagChanged);
+        AbilitySystemComponent->RegisterGameplayTagEvent(WB2023GameplayTags::State_Debuff_Stun, EGameplayTagEventType::NewOrRemoved).AddUObject(this, &AWB2023PlayerState::StunTagChanged);
+
+        if (HasAuthority() && bAdaptiveNetUpdateFrequency)
+        {
+            AbilitySystemComponent->RegisterGenericGameplayTagEvent().AddUObject(this, &AWB2023PlayerState::OnAnyTagChanged);
+            AbilitySystemComponent->OnGameplayEffectAppliedDelegateToSelf.AddUObject(this, &AWB2023PlayerState::OnGameplayEffectAppliedToSelf);
+            AbilitySystemComponent->OnAnyGameplayEffectRemovedDelegate().AddUObject(this, &AWB2023PlayerState::OnGameplayEffectRemoved);
+            AbilitySystemComponent->ReceivedDamage.AddDynamic(this, &AWB2023PlayerState::OnReceivedDamage);
+        }
     }
+
+    SetActorTickEnabled(HasAuthority() && bAdaptiveNetUpdateFrequency);
 }
 
-void AWB2023PlayerState::HealthChanged(const FOnAttributeChangeData& Data)
+void AWB2023PlayerState::Tick(float DeltaSeconds)
 {
-    UE_LOG(LogTemp, Warning, TEXT("Health Changed!"));
+    Super::Tick(DeltaSeconds);
+
+    TimeSinceNetActivity += DeltaSeconds;
+    if (TimeSinceNetActivity > NetUpdateIdleDelay && NetUpdateFrequency > IdleNetUpdateFrequency)
+    {
+        const float Decay = FMath::Pow(0.5f, DeltaSeconds / FMath::Max(NetUpdateDecayHalfLife, KINDA_SMALL_NUMBER));
+        NetUpdateFrequency = FMath::Max(IdleNetUpdateFrequency, NetUpdateFrequency * Decay);
+    }
 
-    FString NewHealth = FString::SanitizeFloat(GetHealth());
-    GEngine->AddOnScreenDebugMessage(-1, 1.0, FColor::Red, *NewHealth);
+    ReplicationWindowTime += DeltaSeconds;
+    if (ReplicationWindowTime >= 1.0f)
+    {
+        MeasuredNetUpdateRate = NumReplicationsThisWindow / ReplicationWindowTime;
+        NumReplicationsThisWindow = 0;
+        ReplicationWindowTime = 0.0f;
+    }
 }
 
-void AWB2023PlayerState::MaxHealthChanged(const FOnAttributeChangeData& Data)
+void AWB2023PlayerState::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
 {
-    UE_LOG(LogTemp, Warning, TEXT("Max Health Changed!"));
+    Super::PreReplication(ChangedPropertyTracker);
+
+    ++NumReplicationsThisWindow;
 }
 
-void AWB2023PlayerState::ManaChanged(const FOnAttributeChangeData& Data)
+void AWB2023PlayerState::MarkNetActive()
 {
-    UE_LOG(LogTemp, Warning, TEXT("Mana Changed!"));
+    if (!bAdaptiveNetUpdateFrequency)
+    {
+        return;
+    }
+
+    TimeSinceNetActivity = 0.0f;
+    NetUpdateFrequency = ActiveNetUpdateFrequency;
+}
+
+void AWB2023PlayerState::FlushNetUpdate()
+{
+    MarkNetActive();
+
+    if (HasAuthority())
+    {
+        ForceNetUpdate();
+        ++NumForcedNetUpdates;
+        WB2023Metrics::PlayerStateForcedNetUpdates.Add();
+    }
+}
 
-    FString NewMana = FString::SanitizeFloat(GetMana());
-    GEngine->AddOnScreenDebugMessage(-1, 1.0, FColor::Blue, *NewMana);
+void AWB2023PlayerState::OnAnyTagChanged(const FGameplayTag Tag, int32 NewCount)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(AWB2023PlayerState::OnAnyTagChanged);
+
+    MarkNetActive();
+}
+
+void AWB2023PlayerState::OnGameplayEffectAppliedToSelf(UAbilitySystemComponent* Source, const FGameplayEffectSpec& Spec, FActiveGameplayEffectHandle Handle)
+{
+    MarkNetActive();
 }
 
-void AWB2023PlayerState::MaxManaChanged(const FOnAttributeChangeData& Data)
+void AWB2023PlayerState::OnGameplayEffectRemoved(const FActiveGameplayEffect& Effect)
 {
-    UE_LOG(LogTemp, Warning, TEXT("Max Mana Changed!"));
+    MarkNetActive();
 }
 
-void AWB2023PlayerState::CharacterLevelChanged(const FOnAttributeChangeData& Data)
+void AWB2023PlayerState::OnReceivedDamage(UCharacterAbilitySystemComponent* SourceASC, float UnmitigatedDamage, float MitigatedDamage)
 {
-    UE_LOG(LogTemp, Warning, TEXT("Character Level Changed!"));
+    FlushNetUpdate();
+}
+
+void AWB2023PlayerState::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    WB2023Metrics::PlayerStates.Add(-1);
+
+    if (AbilitySystemComponent)
+    {
+        AbilitySystemComponent->RemoveAttributeChangeListener(AttributesChangedDelegateHandle);
+    }
+
+    Super::EndPlay(EndPlayReason);
+}
+
+void AWB2023PlayerState::AttributesChanged(const TArray<FCharacterAttributeChange>& Changes)
+{
+    TRACE_CPUPROFILER_EVENT_SCOPE(AWB2023PlayerState::AttributesChanged);
+    SCOPE_CYCLE_COUNTER(STAT_WB2023_PlayerStateCallbacks);
+
+    MarkNetActive();
+
+    for (const FCharacterAttributeChange& Change : Changes)
+    {
+        if (Change.Attribute == AttributeSetBase->GetHealthAttribute())
+        {
+            HealthChanged(Change);
+        }
+        else if (Change.Attribute == AttributeSetBase->GetMaxHealthAttribute())
+        {
+            MaxHealthChanged(Change);
+        }
+        else if (Change.Attribute == AttributeSetBase->GetManaAttribute())
+        {
+            ManaChanged(Change);
+        }
+        else if (Change.Attribute == AttributeSetBase->GetMaxManaAttribute())
+        {
+            MaxManaChanged(Change);
+        }
+        else if (Change.Attribute == AttributeSetBase->GetLevelAttribute())
+        {
+            CharacterLevelChanged(Change);
+        }
+    }
+}
+
+void AWB2023PlayerState::HealthChanged(const FCharacterAttributeChange& Change)
+{
+    UE_LOG(LogWB2023Attribute, Verbose, TEXT("Health Changed!"));
+
+#if !UE_BUILD_SHIPPING
+    if (GEngine && WB2023PlayerState_Impl::CVarShowAttributeChanges.GetValueOnGameThread())
+    {
+        GEngine->AddOnScreenDebugMessage(-1, 1.0, FColor::Red, FString::SanitizeFloat(Change.NewValue));
+    }
+#endif
+}
+
+void AWB2023PlayerState::MaxHealthChanged(const FCharacterAttributeChange& Change)
+{
+    UE_LOG(LogWB2023Attribute, Verbose, TEXT("Max Health Changed!"));
+}
+
+void AWB2023PlayerState::ManaChanged(const FCharacterAttributeChange& Change)
+{
+    UE_LOG(LogWB2023Attribute, Verbose, TEXT("Mana Changed!"));
+
+#if !UE_BUILD_SHIPPING
+    if (GEngine && WB2023PlayerState_Impl::CVarShowAttributeChanges.GetValueOnGameThread())
+    {
+        GEngine->AddOnScreenDebugMessage(-1, 1.0, FColor::Blue, FString::SanitizeFloat(Change.NewValue));
+    }
+#endif
+}
+
+void AWB2023PlayerState::MaxManaChanged(const FCharacterAttributeChange& Change)
+{
+    UE_LOG(LogWB2023Attribute, Verbose, TEXT("Max Mana Changed!"));
+}
+
+void AWB2023PlayerState::CharacterLevelChanged(const FCharacterAttributeChange& Change)
+{
+    UE_LOG(LogWB2023Attribute, Verbose, TEXT("Character Level Changed!"));
 }
 
 void AWB2023PlayerState::StunTagChanged(const FGameplayTag CallbackTag, int32 NewCount)
 {
+    TRACE_CPUPROFILER_EVENT_SCOPE(AWB2023PlayerState::StunTagChanged);
+    SCOPE_CYCLE_COUNTER(STAT_WB2023_PlayerStateCallbacks);
+
+    FlushNetUpdate();
+
     // Want to cancel all abilities since stunned
     if (NewCount > 0)
     {
-        FGameplayTagContainer AbilityTagsToCancel;
-        AbilityTagsToCancel.AddTag(FGameplayTag::RequestGameplayTag(FName("Ability")));
-
-        FGameplayTagContainer AbilityTagsToIgnore;
-        AbilityTagsToIgnore.AddTag(FGameplayTag::RequestGameplayTag(FName("Ability.NotCanceledByStun")));
-
-        AbilitySystemComponent->CancelAbilities(&AbilityTagsToCancel, &AbilityTagsToIgnore);
+        AbilitySystemComponent->CancelActiveAbilities(&WB2023GameplayTags::GetStunCancelTags(), &WB2023GameplayTags::GetStunIgnoreTags());
     }
 }
@@ -3,11 +3,153 @@
 
 #include "TheAssetManager.h"
 #include "AbilitySystemGlobals.h"
+#include "Character/Abilities/CharacterAbilitySet.h"
+#include "Character/CharBase.h"
+#include "Engine/Level.h"
+#include "Engine/StreamableManager.h"
+#include "HAL/IConsoleManager.h"
+#include "WB2023/WB2023.h"
+#include "Metrics/WB2023Metrics.h"
+
+namespace TheAssetManager_Impl
+{
+    static FAutoConsoleCommand PreloadsCommand(
+        TEXT("WB2023.Assets.Preloads"),
+        TEXT("Logs every character kit bundle preload with its progress and load time"),
+        FConsoleCommandDelegate::CreateLambda([]()
+        {
+            if (UAssetManager::IsInitialized())
+            {
+                UTheAssetManager::Get().LogPreloads();
+            }
+        }));
+}
+
+UTheAssetManager& UTheAssetManager::Get()
+{
+    UTheAssetManager* AssetManager = Cast<UTheAssetManager>(GEngine->AssetManager);
+    check(AssetManager);
+    return *AssetManager;
+}
 
 void UTheAssetManager::StartInitialLoading()
 {
+    const double StartTime = FPlatformTime::Seconds();
+
     Super::StartInitialLoading();
     UAbilitySystemGlobals::Get().InitGlobalData();
-    UE_LOG(LogTemp, Warning, TEXT("Hello World"));
+
+    // Kits load in the background once there is something to play them
+    FWorldDelegates::LevelAddedToWorld.AddUObject(this, &UTheAssetManager::OnLevelAddedToWorld);
+    FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &UTheAssetManager::OnPostLoadMap);
+
+    UE_LOG(LogWB2023, Log, TEXT("Asset manager initial loading took %.2fms"), (FPlatformTime::Seconds() - StartTime) * 1000.0);
 }
 
+void UTheAssetManager::PreloadCharacterKit(const UCharacterAbilitySet* AbilitySet)
+{
+    if (!AbilitySet)
+    {
+        return;
+    }
+
+    const FPrimaryAssetId AssetId = AbilitySet->GetPrimaryAssetId();
+    if (KitPreloads.Contains(AssetId))
+    {
+        return;
+    }
+
+    // Bundles only exist for assets found by the PrimaryAssetTypesToScan entry in DefaultGame.ini
+    if (!GetPrimaryAssetPath(AssetId).IsValid())
+    {
+        UE_LOG(LogWB2023, Warning, TEXT("%s is not a registered primary asset, its bundles can't be preloaded"), *AssetId.ToString());
+        return;
+    }
+
+    FKitPreload& Preload = KitPreloads.Add(AssetId);
+    Preload.StartTime = FPlatformTime::Seconds();
+
+    const TArray<FName> Bundles = { UCharacterAbilitySet::MontagesBundle, UCharacterAbilitySet::EffectsBundle };
+    // Completes right away when the bundles are already in memory, the asset manager keeps them loaded afterwards
+    Preload.Handle = LoadPrimaryAsset(AssetId, Bundles,
+        FStreamableDelegate::CreateUObject(this, &UTheAssetManager::OnKitPreloaded, AssetId));
+
+    if (!Preload.Handle.IsValid() && Preload.LoadTime < 0.0)
+    {
+        Preload.LoadTime = 0.0;
+    }
+}
+
+void UTheAssetManager::LogPreloads() const
+{
+    const double Now = FPlatformTime::Seconds();
+    for (const TPair<FPrimaryAssetId, FKitPreload>& Pair : KitPreloads)
+    {
+        const FKitPreload& Preload = Pair.Value;
+        if (Preload.LoadTime >= 0.0)
+        {
+            UE_LOG(LogWB2023, Display, TEXT("%s: loaded in %.2fms"), *Pair.Key.ToString(), Preload.LoadTime * 1000.0);
+            continue;
+        }
+
+        int32 LoadedCount = 0;
+        int32 RequestedCount = 0;
+        float Progress = 0.0f;
+        if (Preload.Handle.IsValid())
+        {
+            Preload.Handle->GetLoadedCount(LoadedCount, RequestedCount);
+            Progress = Preload.Handle->GetProgress();
+        }
+
+        UE_LOG(LogWB2023, Display, TEXT("%s: loading %d/%d assets (%.0f%%) for %.2fms"),
+            *Pair.Key.ToString(), LoadedCount, RequestedCount, Progress * 100.0f, (Now - Preload.StartTime) * 1000.0);
+    }
+}
+
+void UTheAssetManager::OnLevelAddedToWorld(ULevel* Level, UWorld* World)
+{
+    if (World && World->IsGameWorld())
+    {
+        PreloadCharacterKitsInLevel(Level);
+    }
+}
+
+void UTheAssetManager::OnPostLoadMap(UWorld* World)
+{
+    if (World && World->IsGameWorld())
+    {
+        PreloadCharacterKitsInLevel(World->PersistentLevel);
+    }
+}
+
+void UTheAssetManager::PreloadCharacterKitsInLevel(const ULevel* Level)
+{
+    if (!Level)
+    {
+        return;
+    }
+
+    for (const AActor* Actor : Level->Actors)
+    {
+        if (const ACharBase* Character = Cast<ACharBase>(Actor))
+        {
+            PreloadCharacterKit(Character->GetAbilitySet());
+        }
+    }
+}
+
+void UTheAssetManager::OnKitPreloaded(FPrimaryAssetId AssetId)
+{
+    FKitPreload* Preload = KitPreloads.Find(AssetId);
+    if (!Preload)
+    {
+        return;
+    }
+
+    Preload->LoadTime = FPlatformTime::Seconds() - Preload->StartTime;
+
+    WB2023Metrics::KitPreloads.Add();
+    WB2023Metrics::KitPreloadTime.Observe(Preload->LoadTime * 1000.0);
+
+    UE_LOG(LogWB2023, Log, TEXT("Preloaded %s in %.2fms"), *AssetId.ToString(), Preload->LoadTime * 1000.0);
+}
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WB2023GameplayTags.h"
+#include "WB2023/WB2023.h"
+#include "GameplayTagsManager.h"
+#include "UObject/CoreNet.h"
+#include "ProfilingDebugging/ScopedTimers.h"
+#include "HAL/IConsoleManager.h"
+
+namespace WB2023GameplayTags
+{
+#define WB2023_DEFINE_GAMEPLAY_TAG(Identifier, TagName, Comment) UE_DEFINE_GAMEPLAY_TAG_COMMENT(Identifier, TagName, Comment);
+	WB2023_GAMEPLAY_TAG_LIST(WB2023_DEFINE_GAMEPLAY_TAG)
+#undef WB2023_DEFINE_GAMEPLAY_TAG
+
+	const FGameplayTagContainer& GetStunCancelTags()
+	{
+		static const FGameplayTagContainer Tags(Ability);
+		return Tags;
+	}
+
+	const FGameplayTagContainer& GetStunIgnoreTags()
+	{
+		static const FGameplayTagContainer Tags(Ability_NotCanceledByStun);
+		return Tags;
+	}
+}
+
+namespace WB2023GameplayTags_Impl
+{
+	static int32 GetNetSerializedBits(FGameplayTag Tag)
+	{
+		FNetBitWriter Writer(nullptr, 256);
+		bool bOutSuccess = false;
+		Tag.NetSerialize(Writer, nullptr, bOutSuccess);
+		return static_cast<int32>(Writer.GetNumBits());
+	}
+
+	static int32 GetNameSerializedBits(FGameplayTag Tag)
+	{
+		FNetBitWriter Writer(nullptr, 256);
+		FName TagName = Tag.GetTagName();
+		Writer << TagName;
+		return static_cast<int32>(Writer.GetNumBits());
+	}
+
+	static FAutoConsoleCommandWithWorldAndArgs TagBenchmarkCommand(
+		TEXT("WB2023.Tags.Benchmark"),
+		TEXT("WB2023.Tags.Benchmark [Iterations]. Compares string and native tag lookup time and logs the wire size of every project tag"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld*)
+		{
+			const int32 Iterations = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 100000;
+
+			TArray<FName> TagNames;
+			TArray<FGameplayTag> NativeTags;
+#define WB2023_ADD_BENCHMARK_TAG(Identifier, TagName, Comment) TagNames.Add(FName(TagName)); NativeTags.Add(WB2023GameplayTags::Identifier);
+			WB2023_GAMEPLAY_TAG_LIST(WB2023_ADD_BENCHMARK_TAG)
+#undef WB2023_ADD_BENCHMARK_TAG
+
+			uint32 Checksum = 0;
+
+			double RequestSeconds = 0.0;
+			{
+				FScopedDurationTimer Timer(RequestSeconds);
+				for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+				{
+					Checksum += GetTypeHash(FGameplayTag::RequestGameplayTag(TagNames[Iteration % TagNames.Num()]));
+				}
+			}
+
+			double NativeSeconds = 0.0;
+			{
+				FScopedDurationTimer Timer(NativeSeconds);
+				for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+				{
+					Checksum += GetTypeHash(NativeTags[Iteration % NativeTags.Num()]);
+				}
+			}
+
+			const bool bFastReplication = UGameplayTagsManager::Get().ShouldUseFastReplication();
+			UE_LOG(LogWB2023, Display, TEXT("Tag lookup x%d: RequestGameplayTag=%.3fms Native=%.3fms (checksum %u)"),
+				Iterations, RequestSeconds * 1000.0, NativeSeconds * 1000.0, Checksum);
+
+			int32 TotalNetBits = 0;
+			int32 TotalNameBits = 0;
+			for (const FGameplayTag& Tag : NativeTags)
+			{
+				const int32 NetBits = GetNetSerializedBits(Tag);
+				const int32 NameBits = GetNameSerializedBits(Tag);
+				TotalNetBits += NetBits;
+				TotalNameBits += NameBits;
+				UE_LOG(LogWB2023, Display, TEXT("  %s: %d bits (%d as a name)"), *Tag.ToString(), NetBits, NameBits);
+			}
+
+			UE_LOG(LogWB2023, Display, TEXT("Tag wire size: FastReplication=%d Total=%d bits, %d bits as names"),
+				bFastReplication ? 1 : 0, TotalNetBits, TotalNameBits);
+		}));
+}
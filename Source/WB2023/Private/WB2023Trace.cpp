@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "WB2023Trace.h"
+#include "Trace/Trace.inl"
+#include "Abilities/GameplayAbility.h"
+#include "GameplayEffect.h"
+#include "GameFramework/Actor.h"
+
+#if UE_TRACE_ENABLED
+
+UE_TRACE_CHANNEL_DEFINE(WB2023GameplayChannel);
+
+UE_TRACE_EVENT_BEGIN(WB2023Gameplay, AbilityActivated)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ActorId)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, ActorName)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, AbilityName)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(WB2023Gameplay, EffectApplied)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ActorId)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, ActorName)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, EffectName)
+	UE_TRACE_EVENT_FIELD(float, Level)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(WB2023Gameplay, Died)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ActorId)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, ActorName)
+UE_TRACE_EVENT_END()
+
+namespace WB2023Trace
+{
+	void OutputAbilityActivated(const AActor* Owner, const UGameplayAbility* Ability)
+	{
+		if (!UE_TRACE_CHANNELEXPR_IS_ENABLED(WB2023GameplayChannel))
+		{
+			return;
+		}
+
+		const FString ActorName = GetNameSafe(Owner);
+		const FString AbilityName = GetNameSafe(Ability ? Ability->GetClass() : nullptr);
+		UE_TRACE_LOG(WB2023Gameplay, AbilityActivated, WB2023GameplayChannel)
+			<< AbilityActivated.Cycle(FPlatformTime::Cycles64())
+			<< AbilityActivated.ActorId(Owner ? Owner->GetUniqueID() : 0)
+			<< AbilityActivated.ActorName(*ActorName, ActorName.Len())
+			<< AbilityActivated.AbilityName(*AbilityName, AbilityName.Len());
+	}
+
+	void OutputEffectApplied(const AActor* Target, const FGameplayEffectSpec& Spec)
+	{
+		if (!UE_TRACE_CHANNELEXPR_IS_ENABLED(WB2023GameplayChannel))
+		{
+			return;
+		}
+
+		const FString ActorName = GetNameSafe(Target);
+		const FString EffectName = GetNameSafe(Spec.Def);
+		UE_TRACE_LOG(WB2023Gameplay, EffectApplied, WB2023GameplayChannel)
+			<< EffectApplied.Cycle(FPlatformTime::Cycles64())
+			<< EffectApplied.ActorId(Target ? Target->GetUniqueID() : 0)
+			<< EffectApplied.ActorName(*ActorName, ActorName.Len())
+			<< EffectApplied.EffectName(*EffectName, EffectName.Len())
+			<< EffectApplied.Level(Spec.GetLevel());
+	}
+
+	void OutputDied(const AActor* Character)
+	{
+		if (!UE_TRACE_CHANNELEXPR_IS_ENABLED(WB2023GameplayChannel))
+		{
+			return;
+		}
+
+		const FString ActorName = GetNameSafe(Character);
+		UE_TRACE_LOG(WB2023Gameplay, Died, WB2023GameplayChannel)
+			<< Died.Cycle(FPlatformTime::Cycles64())
+			<< Died.ActorId(Character ? Character->GetUniqueID() : 0)
+			<< Died.ActorName(*ActorName, ActorName.Len());
+	}
+}
+
+#endif
@@ -0,0 +1,165 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "NavigationData.h"
+#include "AIPathSubsystem.generated.h"
+
+class APawn;
+
+// Gets the path, or null when none was found
+DECLARE_DELEGATE_OneParam(FAIPathReadyDelegate, FNavPathSharedPtr);
+
+/**
+ * Async path requests for AI controllers, handed out within a per frame time budget.
+ * Requests are grouped by goal cell and start cell: the first one runs an async navmesh query and the others wait for it,
+ * then follow its path from where they stand on its corridor, or from where a straight navmesh raycast gets them onto it.
+ * The path stays cached for CacheLifetime, so each group of enemies converging on a player from one direction costs
+ * about one query per cell the player moves through. WB2023.AIPath.Benchmark measures it.
+ */
+UCLASS(Config = Game)
+class WB2023_API UAIPathSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual void Deinitialize() override;
+
+	/// <summary>
+	/// Queues a path from Querier to GoalLocation. OnPathReady is called on the game thread, at the earliest this frame.
+	/// Returns the id to cancel it with
+	/// </summary>
+	uint32 RequestPath(const APawn* Querier, const FVector& GoalLocation, FAIPathReadyDelegate OnPathReady);
+
+	void CancelRequest(uint32 RequestId);
+
+	/// <summary>
+	/// Path for a query that has to be answered right away, like a stock MoveTo's. Querier joins the cached path of its goal
+	/// and start cells when there is one, otherwise the query runs synchronously, counts against MaxQueriesPerFrame and
+	/// its path is cached for the requests after it
+	/// </summary>
+	FNavPathSharedPtr FindPathSync(const APawn& Querier, const FPathFindingQuery& Query);
+
+	void LogStats() const;
+
+	/// <summary>
+	/// Requests a path to the first player's pawn for every other pawn in the world at once and logs the navmesh queries
+	/// it took once all of them are delivered
+	/// </summary>
+	void StartBenchmark();
+
+	// Time spent handing out queued requests per frame. At least one request is handled every frame
+	UPROPERTY(Config)
+	float FrameBudgetMs = 0.5f;
+
+	// Async navmesh queries started per frame, the rest wait in the queue
+	UPROPERTY(Config)
+	int32 MaxQueriesPerFrame = 8;
+
+	// Goals in the same cell share a query and a cached path
+	UPROPERTY(Config)
+	float GoalCellSize = 200.0f;
+
+	// Requests starting in the same cell share a query, agents coming from elsewhere get their own
+	UPROPERTY(Config)
+	float StartCellSize = 1500.0f;
+
+	// Agents off the shared corridor join it with a navmesh raycast to a path point at most this far away
+	UPROPERTY(Config)
+	float MaxJoinDistance = 800.0f;
+
+	// Seconds a path is reused for new requests to its goal cell
+	UPROPERTY(Config)
+	float CacheLifetime = 1.0f;
+
+private:
+	// Requests with the same key share a query and a cached path
+	struct FPathKey
+	{
+		FIntVector GoalCell = FIntVector::ZeroValue;
+		FIntVector StartCell = FIntVector::ZeroValue;
+
+		bool operator==(const FPathKey& Other) const { return GoalCell == Other.GoalCell && StartCell == Other.StartCell; }
+		friend uint32 GetTypeHash(const FPathKey& Key) { return HashCombine(GetTypeHash(Key.GoalCell), GetTypeHash(Key.StartCell)); }
+	};
+
+	struct FPathRequest
+	{
+		uint32 RequestId = 0;
+		TWeakObjectPtr<const APawn> Querier;
+		FVector GoalLocation = FVector::ZeroVector;
+		FPathKey Key;
+		FAIPathReadyDelegate OnPathReady;
+
+		// The shared path didn't pass by the querier, it needs a query of its own
+		bool bNeedsOwnQuery = false;
+	};
+
+	// An async query and the requests with the same key waiting on it
+	struct FPendingQuery
+	{
+		FPathRequest Request;
+		TArray<FPathRequest> Waiting;
+		bool bShared = false;
+	};
+
+	struct FCachedPath
+	{
+		FNavPathSharedPtr Path;
+		float Time = 0.0f;
+	};
+
+	// Returns false when the request needs a query and this frame's are used up
+	bool ProcessRequest(FPathRequest& Request);
+	bool StartQuery(FPathRequest& Request);
+	void OnQueryFinished(uint32 QueryId, ENavigationQueryResult::Type Result, FNavPathSharedPtr Path);
+
+	/// <summary>
+	/// Copies the part of SharedPath ahead of the querier. A querier off its corridor gets a straight lead-in from a
+	/// navmesh raycast to a path point within MaxJoinDistance. Returns null when neither works
+	/// </summary>
+	FNavPathSharedPtr JoinPath(const FNavigationPath& SharedPath, const APawn& Querier, bool& bOutRaycastJoin) const;
+
+	// Delivers the request's part of SharedPath, false when the querier can't join it
+	bool DeliverSharedPath(FPathRequest& Request, const FNavigationPath& SharedPath);
+	void DeliverPath(FPathRequest& Request, FNavPathSharedPtr Path);
+
+	static FIntVector GetCell(const FVector& Location, float CellSize);
+
+	void OnBenchmarkPathReady(FNavPathSharedPtr Path);
+
+	TArray<FPathRequest> Queue;
+
+	// By navigation system query id
+	TMap<uint32, FPendingQuery> PendingQueries;
+
+	// Shared query in flight for a key
+	TMap<FPathKey, uint32> PendingQueryByKey;
+
+	TMap<FPathKey, FCachedPath> CachedPaths;
+
+	uint32 NextRequestId = 1;
+	int32 NumQueriesThisFrame = 0;
+
+	int32 NumRequests = 0;
+	// Of NumRequests, the ones through FindPathSync
+	int32 NumSyncRequests = 0;
+	int32 NumQueries = 0;
+	int32 NumSharedPaths = 0;
+	// Shared paths whose querier wasn't on the corridor and joined it with a raycast
+	int32 NumRaycastJoins = 0;
+	int32 NumFailed = 0;
+
+	// WB2023.AIPath.Benchmark state, counters at its start
+	int32 BenchmarkRequestsLeft = 0;
+	int32 BenchmarkNumAgents = 0;
+	int32 BenchmarkStartQueries = 0;
+	int32 BenchmarkStartShared = 0;
+	int32 BenchmarkStartRaycastJoins = 0;
+	int32 BenchmarkNumFailed = 0;
+	double BenchmarkStartTime = 0.0;
+};
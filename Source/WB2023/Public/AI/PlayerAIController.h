@@ -4,10 +4,13 @@
 
 #include "CoreMinimal.h"
 #include "AIController.h"
+#include "NavigationData.h"
 #include "PlayerAIController.generated.h"
 
 /**
- * 
+ * Follows paths with Detour crowd avoidance. Moves started with MoveToActorAsync get their paths from the
+ * UAIPathSubsystem, so agents chasing the same target share queries instead of each running its own.
+ * Stock MoveTo requests (behavior tree MoveTo tasks) share cached paths through it as well.
  */
 UCLASS()
 class WB2023_API APlayerAIController : public AAIController
@@ -16,5 +19,49 @@ class WB2023_API APlayerAIController : public AAIController
 
 public:
 
-    APlayerAIController();
+    APlayerAIController(const FObjectInitializer& ObjectInitializer);
+
+    virtual void Tick(float DeltaSeconds) override;
+
+    // Moves to Goal with async paths, repathing while the goal moves. Returns false when Goal is null or nothing is possessed
+    UFUNCTION(BlueprintCallable, Category = "AI|Navigation")
+    bool MoveToActorAsync(AActor* Goal, float AcceptanceRadius = 50.0f);
+
+    // MoveToActorAsync to the closest alive enemy within NearestPlayerSearchRadius, found through the
+    // UCharacterSpatialHashSubsystem. Pawns that aren't in it go to the closest player controlled pawn
+    UFUNCTION(BlueprintCallable, Category = "AI|Navigation")
+    bool MoveToNearestPlayer(float AcceptanceRadius = 50.0f);
+
+    UFUNCTION(BlueprintCallable, Category = "AI|Navigation")
+    void StopAsyncMove();
+
+protected:
+    virtual void OnUnPossess() override;
+
+    // Answers the query through UAIPathSubsystem::FindPathSync
+    virtual bool FindPathForMoveRequest(const FAIMoveRequest& MoveRequest, FPathFindingQuery& Query, FNavPathSharedPtr& OutPath) const override;
+
+    // Repath once the goal moved this far from where the last path ends
+    UPROPERTY(EditDefaultsOnly, Category = "AI|Navigation")
+    float RepathDistance = 200.0f;
+
+    // Least time between two path requests
+    UPROPERTY(EditDefaultsOnly, Category = "AI|Navigation")
+    float RepathInterval = 0.5f;
+
+    UPROPERTY(EditDefaultsOnly, Category = "AI|Navigation")
+    float NearestPlayerSearchRadius = 10000.0f;
+
+private:
+    void RequestGoalPath();
+    void OnPathReady(FNavPathSharedPtr Path);
+    void CancelPathRequest();
+
+    TWeakObjectPtr<AActor> GoalActor;
+    FVector PathGoalLocation = FVector::ZeroVector;
+    float GoalAcceptanceRadius = 50.0f;
+    float LastPathRequestTime = TNumericLimits<float>::Lowest();
+
+    // Request in the UAIPathSubsystem, 0 when none
+    uint32 PathRequestId = 0;
 };
@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "CombatLoadBenchmarkCommandlet.generated.h"
+
+class AActor;
+class ACharBase;
+class UGameplayAbility;
+class UGameplayEffect;
+class UWorld;
+
+/**
+ * Headless combat load benchmark for the ability system.
+ * Spawns N possessed characters, grants abilities, then applies damage every frame, periodically activates
+ * abilities on a tenth of the characters and stuns them for a second, and writes frame time, memory growth
+ * and ASC memory per N to a JSON file. The character class and abilities come from DefaultGame.ini.
+ *
+ * UnrealEditor-Cmd WB2023.uproject -run=CombatLoadBenchmark -nullrhi -unattended
+ *     [-Counts=10,100,1000] [-Frames=300] [-CharacterClass=/Game/Path/BP_Character.BP_Character_C] [-Output=File.json]
+ */
+UCLASS(Config = Game)
+class WB2023_API UCombatLoadBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UCombatLoadBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+	// Needs DefaultAttributes (or an attribute curve table group), -CharacterClass= overrides it
+	UPROPERTY(Config)
+	TSoftClassPtr<ACharBase> DefaultCharacterClass;
+
+	// Granted to every character on top of its own abilities, activated before each stun
+	UPROPERTY(Config)
+	TArray<TSoftClassPtr<UGameplayAbility>> Abilities;
+
+private:
+	struct FRunResult
+	{
+		int32 NumCharacters = 0;
+		double SetupMs = 0.0;
+		double GrantMs = 0.0;
+		double RevokeMs = 0.0;
+		double AverageFrameMs = 0.0;
+		double MedianFrameMs = 0.0;
+		double P95FrameMs = 0.0;
+		double MaxFrameMs = 0.0;
+		double AverageDamageMs = 0.0;
+		int32 NumStuns = 0;
+		int32 NumAbilitiesCancelled = 0;
+		int64 MemoryGrowthPerFrame = 0;
+		int64 AbilitySystemBytesPerCharacter = 0;
+		int64 AttributeSetBytesPerCharacter = 0;
+	};
+
+	// Spawns CharacterClass. NumCharacters of the result is 0 when the characters couldn't be set up
+	FRunResult RunBenchmark(int32 NumCharacters, int32 NumFrames);
+	void DestroyWorld(UWorld* World, const TArray<AActor*>& SpawnedActors);
+
+	// Lets the loaded classes and the damage effect be collected once every N has run
+	void ReleaseRunAssets();
+
+	// Instant damage through UCharacterDamageExecCalculation, magnitude set by caller
+	UPROPERTY()
+	TObjectPtr<UGameplayEffect> DamageEffect;
+
+	// Referenced here so DestroyWorld's garbage collection between runs keeps the loaded Blueprint classes
+	UPROPERTY(Transient)
+	TSubclassOf<ACharBase> CharacterClass;
+
+	UPROPERTY(Transient)
+	TArray<TSubclassOf<UGameplayAbility>> GrantedAbilityClasses;
+};
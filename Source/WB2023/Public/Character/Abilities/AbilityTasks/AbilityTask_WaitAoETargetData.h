@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Abilities/Tasks/AbilityTask.h"
+#include "Abilities/GameplayAbilityTargetTypes.h"
+#include "AbilityTask_WaitAoETargetData.generated.h"
+
+class ACharacterAoETargetActor;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FWaitAoETargetDataDelegate, const FGameplayAbilityTargetDataHandle&, Data);
+
+/**
+ * Spawns an ACharacterAoETargetActor for the local player and waits for the Confirm/Cancel inputs.
+ * The client sends the chosen center and actors, the server checks them against Radius and MaxRange before ValidData.
+ * Abilities with a Radius of at least LargeAoERadius pull the player's camera back while the preview is up.
+ */
+UCLASS()
+class WB2023_API UAbilityTask_WaitAoETargetData : public UAbilityTask
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(BlueprintAssignable)
+	FWaitAoETargetDataDelegate ValidData;
+
+	UPROPERTY(BlueprintAssignable)
+	FWaitAoETargetDataDelegate Cancelled;
+
+	/// <summary>
+	/// Previews a Radius sphere up to MaxRange from the avatar and returns the actors in it once confirmed
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category = "Ability|Tasks", meta = (HidePin = "OwningAbility", DefaultToSelf = "OwningAbility", BlueprintInternalUseOnly = "true"))
+	static UAbilityTask_WaitAoETargetData* WaitAoETargetData(UGameplayAbility* OwningAbility, FName TaskInstanceName,
+		TSubclassOf<ACharacterAoETargetActor> TargetActorClass, float Radius = 500.0f, float MaxRange = 3000.0f);
+
+	virtual void Activate() override;
+
+	// Radius from which the camera is pulled back by LargeAoEArmLengthScale
+	UPROPERTY(BlueprintReadWrite, Category = "Targeting")
+	float LargeAoERadius = 1500.0f;
+
+	UPROPERTY(BlueprintReadWrite, Category = "Targeting")
+	float LargeAoEArmLengthScale = 2.0f;
+
+protected:
+	virtual void OnDestroy(bool bInOwnerFinished) override;
+
+	void ActivateLocal();
+
+	void OnTargetDataReady(const FGameplayAbilityTargetDataHandle& Data);
+	void OnTargetDataCancelled(const FGameplayAbilityTargetDataHandle& Data);
+
+	// Server side of the client's target data
+	void OnReplicatedTargetDataReceived(const FGameplayAbilityTargetDataHandle& Data, FGameplayTag ActivationTag);
+	void OnReplicatedTargetDataCancelled();
+
+	// Copies the client's data without the actors it couldn't have hit from where it says it aimed,
+	// false when the data isn't an actor array or the center is out of range
+	bool ValidateTargetData(const FGameplayAbilityTargetDataHandle& Data, FGameplayAbilityTargetDataHandle& OutData) const;
+
+	void SetConfirmCancelUI(bool bShow);
+	void SetLargeAoECamera(bool bEnable);
+
+	UPROPERTY()
+	TSubclassOf<ACharacterAoETargetActor> TargetActorClass;
+
+	UPROPERTY()
+	ACharacterAoETargetActor* TargetActor = nullptr;
+
+	float Radius = 500.0f;
+	float MaxRange = 3000.0f;
+
+	bool bLargeAoECameraActive = false;
+};
@@ -7,6 +7,8 @@
 #include "AbilitySystemComponent.h"
 #include "CharacterAttributeSetBase.generated.h"
 
+struct FCharacterAttributeChange;
+
 // Uses macros from AttributeSet.h
 // Creates getters, setters, and initters for all the attributes
 #define ATTRIBUTE_ACCESSORS(ClassName, PropertyName) \
@@ -15,10 +17,47 @@
 	GAMEPLAYATTRIBUTE_VALUE_SETTER(PropertyName) \
 	GAMEPLAYATTRIBUTE_VALUE_INITTER(PropertyName)
 
+/**
+ * Compact wire form of Level, Health and Mana.
+ * Level is sent as a byte, Health and Mana as packed fixed point with a 0.1 step. The current value is only
+ * sent when it differs from the base value.
+ */
+USTRUCT()
+struct WB2023_API FCompactVitalAttributes
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	uint8 Level = 0;
+
+	UPROPERTY()
+	float HealthBase = 0.0f;
+
+	UPROPERTY()
+	float HealthCurrent = 0.0f;
+
+	UPROPERTY()
+	float ManaBase = 0.0f;
+
+	UPROPERTY()
+	float ManaCurrent = 0.0f;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FCompactVitalAttributes> : public TStructOpsTypeTraitsBase2<FCompactVitalAttributes>
+{
+	enum
+	{
+		WithNetSerializer = true
+	};
+};
+
 /**
  * 
  */
-UCLASS()
+UCLASS(Config = Game)
 class WB2023_API UCharacterAttributeSetBase : public UAttributeSet
 {
 	GENERATED_BODY()
@@ -45,6 +84,11 @@ public:
 	FGameplayAttributeData MaxMana;
 	ATTRIBUTE_ACCESSORS(UCharacterAttributeSetBase, MaxMana)
 
+	// Damage reduction applied by the DamageExecution, see UCharacterDamageExecCalculation
+	UPROPERTY(BlueprintReadOnly, Category = "Armor", ReplicatedUsing = OnRep_Armor)
+	FGameplayAttributeData Armor;
+	ATTRIBUTE_ACCESSORS(UCharacterAttributeSetBase, Armor)
+
 	// Damage is a meta attribute used by the DamageExecution to calculate
 	// final damage, which then turns into -Health
 	// Temporary value that only exists on the server. Not replicated
@@ -53,6 +97,32 @@ public:
 	ATTRIBUTE_ACCESSORS(UCharacterAttributeSetBase, Damage)
 
 
+	// Clamps Health/Mana before the current value is changed
+	virtual void PreAttributeChange(const FGameplayAttribute& Attribute, float& NewValue) override;
+
+	// Turns the Damage meta attribute into -Health once the DamageExecution has run
+	virtual void PostGameplayEffectExecute(const FGameplayEffectModCallbackData& Data) override;
+
+	// Marks the attribute dirty for push model replication
+	virtual void PostAttributeChange(const FGameplayAttribute& Attribute, float OldValue, float NewValue) override;
+
+	// Marks the attribute dirty for push model replication
+	virtual void PostAttributeBaseChange(const FGameplayAttribute& Attribute, float OldValue, float NewValue) const override;
+
+	// Remembers which attributes the ASC aggregates, see HasAttributeAggregator
+	virtual void OnAttributeAggregatorCreated(const FGameplayAttribute& Attribute, FAggregator* NewAggregator) const override;
+
+	// True if the ASC has an aggregator for any of Attributes. Aggregators outlive the effects and captures that created
+	// them and keep their own base value, so only SetNumericAttributeBase can change these attributes' base
+	bool HasAttributeAggregator(TConstArrayView<FGameplayAttribute> Attributes) const;
+
+	/// <summary>
+	/// Writes base and current values straight into the attribute data, without aggregators or the per attribute callbacks,
+	/// and clamps Health and Mana to their max. Only correct while HasAttributeAggregator is false for the attributes.
+	/// Appends the attributes whose value changed to OutChanges
+	/// </summary>
+	void InitializeBaseValues(TConstArrayView<FGameplayAttribute> Attributes, TConstArrayView<float> Values, TArray<FCharacterAttributeChange>& OutChanges);
+
 	UFUNCTION()
 	virtual void OnRep_CharacterLevel(const FGameplayAttributeData& OldLevel);
 	UFUNCTION()
@@ -63,7 +133,27 @@ public:
 	virtual void OnRep_Mana(const FGameplayAttributeData& OldMana);
 	UFUNCTION()
 	virtual void OnRep_MaxMana(const FGameplayAttributeData& OldMaxMana);
+	UFUNCTION()
+	virtual void OnRep_Armor(const FGameplayAttributeData& OldArmor);
+	UFUNCTION()
+	virtual void OnRep_CompactVitals();
 	
 	// Helps w replication
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+protected:
+	// Replaces the replication of Level, Health and Mana with CompactVitals.
+	// Read once per class when its replication layout is built, so it has to be set in config
+	UPROPERTY(Config)
+	bool bCompactVitalsReplication = false;
+
+	// Only replicated when bCompactVitalsReplication is set, unpacked into Level, Health and Mana on clients
+	UPROPERTY(ReplicatedUsing = OnRep_CompactVitals)
+	FCompactVitalAttributes CompactVitals;
+
+	void MarkAttributeDirty(const FGameplayAttribute& Attribute);
+
+private:
+	// Set from the const engine hook, aggregators are never removed from the ASC
+	mutable TArray<FGameplayAttribute> AggregatedAttributes;
 };
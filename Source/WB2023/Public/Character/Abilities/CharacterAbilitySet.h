@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "GameplayAbilitySpecHandle.h"
+#include "ActiveGameplayEffectHandle.h"
+#include "CharacterAbilitySet.generated.h"
+
+class UAbilitySystemComponent;
+class UCharacterGameplayAbility;
+class UGameplayEffect;
+class UAnimMontage;
+
+USTRUCT(BlueprintType)
+struct FCharacterAbilitySetEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Ability")
+	TSubclassOf<UCharacterGameplayAbility> Ability;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Ability")
+	int32 AbilityLevel = 1;
+
+	// Copied from the ability's AbilityInputID when the asset is saved, so granting doesn't touch the CDO
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Ability")
+	int32 InputID = INDEX_NONE;
+};
+
+/**
+ * Everything granted by a UCharacterAbilitySet, removed again in one go without scanning the ASC
+ */
+USTRUCT(BlueprintType)
+struct WB2023_API FCharacterAbilitySetHandles
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FGameplayAbilitySpecHandle> AbilitySpecHandles;
+
+	UPROPERTY()
+	TArray<FActiveGameplayEffectHandle> EffectHandles;
+
+	// Clears every granted ability. Server only
+	void RemoveAbilities(UAbilitySystemComponent* AbilitySystemComponent);
+
+	// Removes every applied effect. Server only
+	void RemoveEffects(UAbilitySystemComponent* AbilitySystemComponent);
+};
+
+/**
+ * Abilities, startup effects and default attributes of a character kit
+ */
+UCLASS(BlueprintType)
+class WB2023_API UCharacterAbilitySet : public UPrimaryDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	static const FPrimaryAssetType PrimaryAssetType;
+
+	// Asset bundles preloaded by UTheAssetManager::PreloadCharacterKit
+	static const FName MontagesBundle;
+	static const FName EffectsBundle;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Abilities")
+	TArray<FCharacterAbilitySetEntry> Abilities;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Abilities")
+	TArray<TSubclassOf<UGameplayEffect>> StartupEffects;
+
+	// Not an array since one gameplay effect can set all the attributes
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Abilities")
+	TSubclassOf<UGameplayEffect> DefaultAttributes;
+
+	// Montages the abilities play, loaded ahead of the first activation
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Preload", meta = (AssetBundles = "Montages"))
+	TArray<TSoftObjectPtr<UAnimMontage>> Montages;
+
+	// Effects the abilities apply (costs, cooldowns, damage), loaded ahead of the first activation
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Preload", meta = (AssetBundles = "Effects"))
+	TArray<TSoftClassPtr<UGameplayEffect>> AbilityEffects;
+
+	/// <summary>
+	/// Gives every ability in the set and records the spec handles in OutHandles. Server only
+	/// </summary>
+	void GiveAbilities(UAbilitySystemComponent* AbilitySystemComponent, UObject* SourceObject, FCharacterAbilitySetHandles& OutHandles) const;
+
+	/// <summary>
+	/// Applies every startup effect at Level and records the active handles in OutHandles. Server only
+	/// </summary>
+	void ApplyStartupEffects(UAbilitySystemComponent* AbilitySystemComponent, UObject* SourceObject, float Level, FCharacterAbilitySetHandles& OutHandles) const;
+
+	virtual FPrimaryAssetId GetPrimaryAssetId() const override;
+
+	virtual void PostLoad() override;
+
+#if WITH_EDITOR
+	virtual void PreSave(FObjectPreSaveContext SaveContext) override;
+#endif
+
+private:
+	// Fills in InputID from the abilities' CDOs
+	void RefreshInputIDs();
+};
@@ -12,17 +12,44 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FReceivedDamageDelegate, UCharact
 
 class UInputAction;
 
+// One attribute's change over a frame, OldValue is the value before the first change and NewValue after the last
+struct FCharacterAttributeChange
+{
+	FGameplayAttribute Attribute;
+	float OldValue = 0.0f;
+	float NewValue = 0.0f;
+};
+
+DECLARE_DELEGATE_OneParam(FOnAttributesChangedDelegate, const TArray<FCharacterAttributeChange>& /*Changes*/);
+
 USTRUCT()
 struct FAbilityInputBinding
 {
 	GENERATED_BODY()
 
+	UPROPERTY()
+	TObjectPtr<UInputAction> InputAction = nullptr;
+
 	int32 InputID = 0;
 	uint32 OnPressedHandle = 0;
 	uint32 OnReleasedHandle = 0;
 	TArray<FGameplayAbilitySpecHandle> BoundAbilitiesStack;
 };
 
+// Counters of the ability input buffer, see UCharacterAbilitySystemComponent::InputBufferWindow
+struct FAbilityInputBufferStats
+{
+	int32 Pressed = 0;
+	int32 Buffered = 0;
+	int32 Coalesced = 0;	// Re-presses of an input that was already buffered
+	int32 Replayed = 0;
+	int32 Dropped = 0;		// Buffered presses that expired before their ability could activate
+	double TotalReplayDelay = 0.0;
+	int32 ActivationRPCs = 0;	// Server RPCs carrying ability activations, the replays of one frame share one
+	int32 RoundTrips = 0;		// Predicted activations the server has confirmed or rejected
+	double TotalRoundTripTime = 0.0;
+};
+
 /**
  * 
  */
@@ -50,21 +77,171 @@ public:
 
 	virtual void ReceiveDamage(UCharacterAbilitySystemComponent* SourceASC, float UnmitigatedDamage, float Mitigated);
 
+	// How long a press is held when its ability can't activate yet (cooldown, blocking tags, cost) or is running without
+	// listening for presses (no InputPressed/WaitInputPress), replayed once it can activate. 0 turns buffering off
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Enhanced Input Abilities")
+	float InputBufferWindow = 0.2f;
+
+	const FAbilityInputBufferStats& GetInputBufferStats() const { return InputBufferStats; }
+	void ResetInputBufferStats() { InputBufferStats = FAbilityInputBufferStats(); }
+
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	// Activations, target data and ends of the same ability in one frame go to the server as one ServerAbilityRPCBatch
+	virtual bool ShouldDoServerAbilityRPCBatch() const override { return true; }
+
+	// Count the activation round trips, and collect the RPCs of the activations ProcessInputBuffer replays into one batch
+	virtual void CallServerTryActivateAbility(FGameplayAbilitySpecHandle AbilityToActivate, bool InputPressed, FPredictionKey PredictionKey) override;
+	virtual void CallServerSetReplicatedTargetData(FGameplayAbilitySpecHandle AbilityHandle, FPredictionKey AbilityOriginalPredictionKey,
+		const FGameplayAbilityTargetDataHandle& ReplicatedTargetDataHandle, FGameplayTag ApplicationTag, FPredictionKey CurrentPredictionKey) override;
+	virtual void CallServerEndAbility(FGameplayAbilitySpecHandle AbilityHandle, FGameplayAbilityActivationInfo ActivationInfo, FPredictionKey PredictionKey) override;
+
+	// The buffered activations replayed in one frame, each handled like its own ServerAbilityRPCBatch
+	UFUNCTION(Server, Reliable)
+	void ServerBufferedAbilityRPCBatch(const TArray<FServerAbilityRPCBatch>& Batches);
+
+	/// <summary>
+	/// Cancels the running abilities that have any of WithTags (all of them when null) and none of WithoutTags.
+	/// Only looks at running abilities, through the tag index kept by NotifyAbilityActivated/NotifyAbilityEnded
+	/// </summary>
+	void CancelActiveAbilities(const FGameplayTagContainer* WithTags = nullptr, const FGameplayTagContainer* WithoutTags = nullptr, UGameplayAbility* Ignore = nullptr);
+
+	int32 GetNumActiveAbilities() const { return ActiveAbilityHandles.Num(); }
+
+	virtual void NotifyAbilityActivated(const FGameplayAbilitySpecHandle Handle, UGameplayAbility* Ability) override;
+	virtual void NotifyAbilityEnded(FGameplayAbilitySpecHandle Handle, UGameplayAbility* Ability, bool bWasCancelled) override;
+
+	// World time this ASC last dealt or received damage
+	float GetLastCombatTime() const { return LastCombatTime; }
+
+	/// <summary>
+	/// Attribute change bus. Changes to the given attributes are coalesced over the frame and delivered
+	/// to the listener once, after all actors have ticked, as one list of the attributes that changed
+	/// </summary>
+	FDelegateHandle AddAttributeChangeListener(const TArray<FGameplayAttribute>& Attributes, FOnAttributesChangedDelegate&& Delegate);
+
+	void RemoveAttributeChangeListener(FDelegateHandle Handle);
+
+	// Delivers the pending attribute changes now instead of at the end of the frame
+	void FlushAttributeChanges();
+
+	// Adds changes made without going through the attribute delegates (bulk initialization) to the bus,
+	// they go out with the frame's other changes
+	void QueueAttributeChanges(TConstArrayView<FCharacterAttributeChange> Changes);
+
+	// SetNumericAttributeBase for each attribute in order, with one batch on the bus instead of a change per attribute
+	void SetNumericAttributeBases(TConstArrayView<FGameplayAttribute> Attributes, TConstArrayView<float> Values);
+
+protected:
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 private:
-	void OnAbilityInputPressed(UInputAction* InputAction);
+	struct FAttributeChangeListener
+	{
+		TArray<FGameplayAttribute> Attributes;
+		FOnAttributesChangedDelegate Delegate;
+		FDelegateHandle Handle;
+	};
+
+	void OnAttributeValueChanged(const FOnAttributeChangeData& Data);
+
+	void OnWorldPostActorTick(UWorld* World, ELevelTick TickType, float DeltaSeconds);
+
+	TArray<FAttributeChangeListener> AttributeChangeListeners;
+
+	// Set while FlushAttributeChanges delivers, listeners removed meanwhile are only unbound
+	bool bFlushingAttributeChanges = false;
 
-	void OnAbilityInputReleased(UInputAction* InputAction);
+	// Set while SetNumericAttributeBases runs, it queues the changes itself
+	bool bBatchingAttributeChanges = false;
+
+	// Attributes the bus is bound to on the engine's per attribute delegates, bound once no matter how many listeners
+	TArray<FGameplayAttribute> ObservedAttributes;
+
+	TArray<FCharacterAttributeChange> PendingAttributeChanges;
+
+	FDelegateHandle PostActorTickHandle;
+
+	float LastCombatTime = TNumericLimits<float>::Lowest();
+
+	struct FBufferedAbilityInput
+	{
+		int32 InputID = 0;
+		double Timestamp = 0.0;
+		bool bPressed = false;
+	};
+
+	// Running abilities, and the same handles by each of their ability tags and its parents
+	TArray<FGameplayAbilitySpecHandle> ActiveAbilityHandles;
+	TMap<FGameplayTag, TArray<FGameplayAbilitySpecHandle>> ActiveAbilitiesByTag;
+
+	void RemoveActiveAbility(FGameplayAbilitySpecHandle Handle, const UGameplayAbility* Ability);
+
+	// Tags a running ability is indexed by, empty for abilities that aren't UCharacterGameplayAbility
+	static const FGameplayTagContainer& GetIndexedAbilityTags(const UGameplayAbility* Ability);
+
+	// Pressed/released events waiting for their ability, oldest first
+	TArray<FBufferedAbilityInput> BufferedInputs;
+
+	FAbilityInputBufferStats InputBufferStats;
+
+	// Replays buffered presses whose ability can activate now, drops the expired ones
+	void ProcessInputBuffer();
+
+	// Set while ProcessInputBuffer replays presses, the server RPCs of those activations collect in BufferedAbilityRPCBatches
+	bool bBatchingBufferedActivations = false;
+	TArray<FServerAbilityRPCBatch> BufferedAbilityRPCBatches;
+
+	void SendBufferedAbilityRPCBatches();
+
+	// True if an ability on InputID could be activated right now, OutHandle is set to it
+	bool CanActivateAbilityWithInputID(int32 InputID, FGameplayAbilitySpecHandle& OutHandle) const;
+
+	bool HasAbilityWithInputID(int32 InputID) const;
+	bool IsAbilityWithInputIDActive(int32 InputID) const;
+
+	// True if a running ability on InputID gets presses, something is bound to its InputPressed event (WaitInputPress)
+	bool IsAbilityWithInputIDWaitingForPress(int32 InputID);
+
+	// Last buffered event for InputID, nullptr if there is none
+	const FBufferedAbilityInput* FindLastBufferedInput(int32 InputID) const;
+
+	void OnAbilityInputPressed(int32 InputID);
+
+	void OnAbilityInputReleased(int32 InputID);
 
 	void RemoveEntry(UInputAction* InputAction);
 
-	void TryBindAbilityInput(UInputAction* InputAction, FAbilityInputBinding& AbilityInputBinding);
+	void TryBindAbilityInput(FAbilityInputBinding& AbilityInputBinding);
 
 	FGameplayAbilitySpec* FindAbilitySpec(FGameplayAbilitySpecHandle Handle);
 
+	// Takes a free slot in InputBindings, reusing released input IDs first
+	int32 AllocateInputID();
+
+	// Binding using InputID, nullptr if the ID isn't in use
+	FAbilityInputBinding* FindBinding(int32 InputID);
+
 	virtual void BeginPlay() override;
 
+	// Records the effect in the metrics and the WB2023Gameplay trace channel
+	void OnEffectAppliedToSelf(UAbilitySystemComponent* Source, const FGameplayEffectSpec& Spec, FActiveGameplayEffectHandle Handle);
+
+	// Drops the input binding of abilities cleared from the ASC
+	virtual void OnRemoveAbility(FGameplayAbilitySpec& AbilitySpec) override;
+
+	// Bindings indexed by InputID - FirstBindingInputID. Free slots have an InputID of 0
+	UPROPERTY(transient)
+	TArray<FAbilityInputBinding> InputBindings;
+
+	// Input IDs of released slots in InputBindings
+	TArray<int32> FreeInputIDs;
+
 	UPROPERTY(transient)
-	TMap<UInputAction*, FAbilityInputBinding> MappedAbilities;
+	TMap<TObjectPtr<UInputAction>, int32> MappedAbilities;
+
+	// Input ID of the binding each ability handle is on
+	TMap<FGameplayAbilitySpecHandle, int32> AbilityHandleToInputID;
 
 	UPROPERTY(transient)
 	UEnhancedInputComponent* InputComponent;
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "AttributeSet.h"
+#include "CharacterAttributeInitSubsystem.generated.h"
+
+class UCurveTable;
+struct FRealCurve;
+class UCharacterAbilitySystemComponent;
+class UCharacterAttributeSetBase;
+
+/**
+ * Default attribute values per character group and level, read from curve tables instead of a DefaultAttributes effect.
+ * Rows are named Group.Attribute (Enemy_BP_C.MaxHealth) with one key per level. The tables are compiled when the
+ * subsystem is initialized into one flat array of values per group, so initializing a character is a copy into
+ * UCharacterAttributeSetBase and one batch on the ASC's attribute change bus.
+ */
+UCLASS(Config = Game)
+class WB2023_API UCharacterAttributeInitSubsystem : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+
+	/// <summary>
+	/// Sets the default values of Group at Level (clamped to the table's levels) on AttributeSet.
+	/// Returns false when no table has the group or the ASC's owner isn't the authority, the caller falls back to its DefaultAttributes effect
+	/// </summary>
+	bool InitializeAttributes(UCharacterAbilitySystemComponent* AbilitySystemComponent, UCharacterAttributeSetBase* AttributeSet, FName Group, int32 Level);
+
+	bool HasGroup(FName Group) const;
+
+	void LogGroups() const;
+
+	// Loads and evaluates AttributeCurveTables, replacing the groups compiled before
+	void CompileTables();
+
+	UPROPERTY(Config)
+	TArray<TSoftObjectPtr<UCurveTable>> AttributeCurveTables;
+
+private:
+	struct FAttributeGroup
+	{
+		TArray<FGameplayAttribute> Attributes;
+
+		// Attributes.Num() values per level, level 1 first. Max attributes come before the ones they clamp
+		TArray<float> Values;
+
+		int32 NumLevels = 0;
+	};
+
+	void CompileTable(const UCurveTable& CurveTable, TMap<FName, TMap<FGameplayAttribute, const FRealCurve*>>& OutRows) const;
+
+	TMap<FName, FAttributeGroup> Groups;
+};
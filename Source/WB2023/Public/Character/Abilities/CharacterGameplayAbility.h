@@ -29,5 +29,12 @@ public:
 
 	// Called once granted ability
 	virtual void OnAvatarSet(const FGameplayAbilityActorInfo* ActorInfo, const FGameplayAbilitySpec& Spec) override;
+
+	// AbilityTags and all their parents, what the ASC indexes running abilities by
+	const FGameplayTagContainer& GetAbilityTagsWithParents() const;
+
+private:
+	mutable FGameplayTagContainer AbilityTagsWithParents;
+	mutable bool bAbilityTagsWithParentsCached = false;
 	
 };
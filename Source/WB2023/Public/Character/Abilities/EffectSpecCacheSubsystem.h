@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GameplayEffect.h"
+#include "EffectSpecCacheSubsystem.generated.h"
+
+class UAbilitySystemComponent;
+
+/**
+ * Outgoing gameplay effect specs built once per effect class and level, then copied for every character that applies them.
+ * The copy gets the caller's context, which recaptures the source tags and attributes, so only the setup MakeOutgoingSpec
+ * does from the effect definition (capture definitions, granted tags, stacking) is shared. Game thread only.
+ */
+UCLASS()
+class WB2023_API UEffectSpecCacheSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/// <summary>
+	/// Same result as ASC->MakeOutgoingSpec(EffectClass, Level, Context), through the cache of ASC's world when there is one
+	/// </summary>
+	static FGameplayEffectSpecHandle MakeOutgoingSpec(UAbilitySystemComponent* AbilitySystemComponent, TSubclassOf<UGameplayEffect> EffectClass,
+		float Level, const FGameplayEffectContextHandle& Context);
+
+	FGameplayEffectSpecHandle MakeCachedOutgoingSpec(UAbilitySystemComponent* AbilitySystemComponent, TSubclassOf<UGameplayEffect> EffectClass,
+		float Level, const FGameplayEffectContextHandle& Context);
+
+	void LogStats() const;
+
+	virtual void Deinitialize() override;
+
+private:
+	struct FSpecKey
+	{
+		TObjectKey<UClass> EffectClass;
+		float Level = 0.0f;
+
+		bool operator==(const FSpecKey& Other) const { return EffectClass == Other.EffectClass && Level == Other.Level; }
+		friend uint32 GetTypeHash(const FSpecKey& Key) { return HashCombine(GetTypeHash(Key.EffectClass), GetTypeHash(Key.Level)); }
+	};
+
+	struct FSpecTemplate
+	{
+		// The template points at the class' CDO, rebuilt if the class went away (blueprint recompile)
+		TWeakObjectPtr<UClass> EffectClass;
+		TSharedPtr<const FGameplayEffectSpec> Spec;
+	};
+
+	TMap<FSpecKey, FSpecTemplate> Templates;
+
+	int32 NumHits = 0;
+	int32 NumMisses = 0;
+};
@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameplayEffectExecutionCalculation.h"
+#include "CharacterDamageExecCalculation.generated.h"
+
+/**
+ * Damage and mitigation for the Damage meta attribute.
+ * Unmitigated damage is the source's captured Damage (including any calculation modifiers on the GE) plus the
+ * Data.Damage SetByCaller magnitude. Mitigated damage is scaled down by the target's Armor and written to the
+ * target's Damage attribute, which UCharacterAttributeSetBase::PostGameplayEffectExecute turns into -Health.
+ */
+UCLASS()
+class WB2023_API UCharacterDamageExecCalculation : public UGameplayEffectExecutionCalculation
+{
+	GENERATED_BODY()
+
+public:
+	UCharacterDamageExecCalculation();
+
+	virtual void Execute_Implementation(const FGameplayEffectCustomExecutionParameters& ExecutionParams, FGameplayEffectCustomExecutionOutput& OutExecutionOutput) const override;
+};
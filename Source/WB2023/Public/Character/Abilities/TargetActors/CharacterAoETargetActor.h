@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Abilities/GameplayAbilityTargetActor.h"
+#include "WorldCollision.h"
+#include "CharacterAoETargetActor.generated.h"
+
+/**
+ * Previews a sphere at the point the player is aiming at and the actors it would hit.
+ * The aim trace, the overlap and the line of sight checks all go through the async trace API, so they run alongside
+ * the frame and come back at the start of the next one. Result buffers are kept between queries.
+ * Confirming sends the center and the target actors (FGameplayAbilityTargetData_ActorArray), not the hit results.
+ */
+UCLASS(Blueprintable)
+class WB2023_API ACharacterAoETargetActor : public AGameplayAbilityTargetActor
+{
+	GENERATED_BODY()
+
+public:
+	ACharacterAoETargetActor(const FObjectInitializer& ObjectInitializer);
+
+	virtual void StartTargeting(UGameplayAbility* Ability) override;
+	virtual void ConfirmTargetingAndContinue() override;
+	virtual void Tick(float DeltaSeconds) override;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Targeting", meta = (ExposeOnSpawn = true))
+	float Radius = 500.0f;
+
+	// How far from the source actor the center can be placed
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Targeting", meta = (ExposeOnSpawn = true))
+	float MaxRange = 3000.0f;
+
+	// Object types the sphere picks up, pawns when empty
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Targeting")
+	TArray<TEnumAsByte<EObjectTypeQuery>> TargetObjectTypes;
+
+	// Targets need an unblocked line from the center, traced on VisibilityChannel
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Targeting")
+	bool bRequireLineOfSight = true;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Targeting")
+	TEnumAsByte<ECollisionChannel> VisibilityChannel = ECC_Visibility;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Targeting")
+	bool bIgnoreSourceActor = true;
+
+	// Line of sight traces started per frame, the rest of the candidates wait for the next frame
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Targeting")
+	int32 MaxVisibilityTracesPerFrame = 16;
+
+	UFUNCTION(BlueprintPure, Category = "Targeting")
+	FVector GetTargetCenter() const { return TargetCenter; }
+
+	UFUNCTION(BlueprintPure, Category = "Targeting")
+	TArray<AActor*> GetTargetActors() const;
+
+	// Called whenever a query finished with a different set of targets, for highlighting them
+	UFUNCTION(BlueprintImplementableEvent, Category = "Targeting")
+	void OnTargetsChanged();
+
+protected:
+	FGameplayAbilityTargetDataHandle MakeTargetData() const;
+
+	void StartAimTrace();
+	void StartOverlap();
+	void StartVisibilityTraces();
+	void FinishQuery(TArray<TWeakObjectPtr<AActor>>& NewTargets);
+
+	void OnAimTraceDone(const FTraceHandle& Handle, FTraceDatum& Datum);
+	void OnOverlapDone(const FTraceHandle& Handle, FOverlapDatum& Datum);
+	void OnVisibilityTraceDone(const FTraceHandle& Handle, FTraceDatum& Datum);
+
+	FTraceDelegate AimTraceDelegate;
+	FOverlapDelegate OverlapDelegate;
+	FTraceDelegate VisibilityTraceDelegate;
+
+	FVector TargetCenter = FVector::ZeroVector;
+	bool bHasTargetCenter = false;
+
+	bool bAimTracePending = false;
+	bool bQueryPending = false;
+
+	// Line of sight results from an older query are dropped
+	uint16 QueryId = 0;
+	int32 NextCandidateIndex = 0;
+	int32 NumVisibilityTracesPending = 0;
+
+	// Actors in the sphere from the last overlap
+	TArray<TWeakObjectPtr<AActor>> Candidates;
+
+	// Candidates that passed the line of sight check so far
+	TArray<TWeakObjectPtr<AActor>> VisibleCandidates;
+
+	// Result of the last finished query
+	TArray<TWeakObjectPtr<AActor>> Targets;
+};
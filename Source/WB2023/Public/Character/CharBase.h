@@ -7,9 +7,15 @@
 #include "AbilitySystemInterface.h"
 #include "GameplayTagContainer.h"
 #include "WB2023/WB2023.h"
+#include "Character/CharacterSignificance.h"
+#include "Character/Abilities/CharacterAbilitySet.h"
 #include "CharBase.generated.h"
 
+class UFXSystemAsset;
+struct FStreamableHandle;
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FCharacterDiedDelegate, ACharBase*, Character);
+DECLARE_DYNAMIC_DELEGATE_OneParam(FCharacterMontageLoadedDelegate, UAnimMontage*, Montage);
 
 /**
  *
@@ -59,13 +65,124 @@ public:
 
 	virtual void Die();
 
+	// Returns the character to the UCharacterPoolSubsystem if bReturnToPoolOnDeath, otherwise destroys it
 	UFUNCTION(BlueprintCallable, Category = "Character")
 	virtual void FinishDying();
 
+	/// <summary>
+	/// Hides the character, turns off collision, movement and replication and resets it with ResetForPool
+	/// </summary>
+	virtual void DeactivateToPool();
+
+	/// <summary>
+	/// Moves the character to SpawnTransform and restores what DeactivateToPool turned off
+	/// </summary>
+	virtual void ActivateFromPool(const FTransform& SpawnTransform);
+
+	bool IsInPool() const { return bInPool; }
+
+	/// <summary>
+	/// Significance manager score for a viewpoint, from distance, visibility and recent combat
+	/// </summary>
+	virtual float CalculateSignificance(const FTransform& Viewpoint) const;
+
+	/// <summary>
+	/// Sets the mesh's anim tick option and tick rate for the significance bucket
+	/// </summary>
+	virtual void ApplySignificance(ECharacterSignificance NewSignificance);
+
+	ECharacterSignificance GetSignificance() const { return Significance; }
+
+	// Health/Mana regenerated per second by the UCharacterTickSubsystem
+	float GetHealthRegenRate() const { return HealthRegenRate; }
+	float GetManaRegenRate() const { return ManaRegenRate; }
+
+	class UCharacterAttributeSetBase* GetAttributeSetBase() const { return AttributeSetBase.Get(); }
+
+	UCharacterAbilitySet* GetAbilitySet() const { return AbilitySet; }
+
+	UFUNCTION(BlueprintPure, Category = "Character|Animation")
+	UAnimMontage* GetLoadedDeathMontage() const;
+
+	// Replaces reading the DeathMontage variable in Blueprints. Streams the montage in without blocking and calls
+	// OnLoaded with it, right away if it's already in memory. Passes null if none is set or on a dedicated server
+	UFUNCTION(BlueprintCallable, Category = "Character|Animation")
+	void LoadDeathMontage(const FCharacterMontageLoadedDelegate& OnLoaded);
+
+	UFUNCTION(BlueprintPure, Category = "Character|Animation")
+	UAnimMontage* GetLoadedHitReactMontage() const;
+
+	UFUNCTION(BlueprintPure, Category = "Character|Animation")
+	UAnimMontage* GetLoadedAttackMontage(int32 Index) const;
+
+	UFUNCTION(BlueprintPure, Category = "Character|FX")
+	UFXSystemAsset* GetLoadedDeathFX() const;
+
+	// Every cosmetic asset set on the character, loaded or not
+	void GetCosmeticAssets(TArray<FSoftObjectPath>& OutAssets) const;
+
+	bool AreCosmeticsRequested() const { return CosmeticsHandle.IsValid(); }
+
+	virtual void PossessedBy(AController* NewController) override;
+
+	// Slot in the UCharacterTickSubsystem, INDEX_NONE when not registered
+	int32 CharacterTickIndex = INDEX_NONE;
+
+	// Slot in the UCharacterSpatialHashSubsystem, INDEX_NONE when not registered
+	int32 SpatialHashIndex = INDEX_NONE;
+
+	float GetAnimTickInterval() const;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Starts the async load of the AbilitySet's bundles, see UTheAssetManager::PreloadCharacterKit
+	void PreloadAbilityAssets() const;
+
+	// Significance falls off over this distance
+	UPROPERTY(EditDefaultsOnly, Category = "Character|Significance")
+	float SignificanceDistanceScale = 1500.0f;
+
+	// Characters that dealt or took damage this recently count as in combat
+	UPROPERTY(EditDefaultsOnly, Category = "Character|Significance")
+	float SignificanceCombatWindow = 5.0f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Character|Significance")
+	float MediumSignificanceAnimTickInterval = 1.0f / 20.0f;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Character|Significance")
+	float LowSignificanceAnimTickInterval = 1.0f / 8.0f;
+
+	// AI controlled characters go back to the character pool on FinishDying instead of being destroyed
+	UPROPERTY(EditDefaultsOnly, Category = "Character|Pool")
+	bool bReturnToPoolOnDeath = true;
+
+	bool bInPool = false;
+
+	// What Die() changes, restored when the character comes out of the pool
+	float DefaultGravityScale = 1.0f;
+	ECollisionEnabled::Type DefaultCapsuleCollision = ECollisionEnabled::QueryAndPhysics;
+
+	/// <summary>
+	/// Clears the ASC state a new life has to rebuild (given abilities, startup effects, State.Dead)
+	/// and undoes what Die() did to movement and collision
+	/// </summary>
+	virtual void ResetForPool();
+
+	ECharacterSignificance Significance = ECharacterSignificance::Critical;
+
+	// Adds the character to the significance manager, never on a dedicated server
+	void RegisterSignificance();
+
+	// Returns false when the character wasn't registered
+	bool UnregisterSignificance();
+
+	// Anim tick option set on the blueprint, restored for High and Critical
+	EVisibilityBasedAnimTickOption DefaultAnimTickOption = EVisibilityBasedAnimTickOption::AlwaysTickPose;
+
 	// Keep track of ability system component & attribute set. Point to the ones in player state
 	TWeakObjectPtr<class UCharacterAbilitySystemComponent> AbilitySystemComponent;
 	TWeakObjectPtr<class UCharacterAttributeSetBase> AttributeSetBase;
@@ -76,9 +193,37 @@ protected:
 	FGameplayTag DeadTag; //Indicates if player is dead
 	FGameplayTag EffectRemoveOnDeathTag;	// called when player has died and can be removed
 
+	// Cosmetics are soft references, streamed in while the character is at least Medium significance and never on a
+	// dedicated server. Use the GetLoaded* functions, they return null until the asset is in memory
+
+	// Not Blueprint visible, Blueprints use LoadDeathMontage or the GetLoaded* functions
+
 	// Death Animation
+	UPROPERTY(EditAnywhere, Category = "Character|Animation")
+	TSoftObjectPtr<UAnimMontage> DeathMontage;
+
+	UPROPERTY(EditAnywhere, Category = "Character|Animation")
+	TSoftObjectPtr<UAnimMontage> HitReactMontage;
+
+	UPROPERTY(EditAnywhere, Category = "Character|Animation")
+	TArray<TSoftObjectPtr<UAnimMontage>> AttackMontages;
+
+	UPROPERTY(EditAnywhere, Category = "Character|FX")
+	TSoftObjectPtr<UFXSystemAsset> DeathFX;
+
+	// How long Die() waits before FinishDying when DeathMontage is set but not loaded
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Character|Animation")
-	UAnimMontage* DeathMontage;
+	float DeathFallbackDuration = 2.0f;
+
+	FTimerHandle DeathFallbackTimerHandle;
+
+	// Keeps the cosmetics loaded while valid
+	TSharedPtr<FStreamableHandle> CosmeticsHandle;
+
+	/// <summary>
+	/// Requests or releases the cosmetics for the character's current significance and pool state
+	/// </summary>
+	void UpdateCosmeticsLoad();
 
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Character|Abilities")
 	TArray<TSubclassOf<class UCharacterGameplayAbility>> CharacterAbilities;
@@ -90,6 +235,19 @@ protected:
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Character|Abilities")
 	TArray<TSubclassOf<class UGameplayEffect>> StartupEffects;
 
+	// Granted on top of CharacterAbilities/StartupEffects. Its DefaultAttributes are used when DefaultAttributes is not set
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Character|Abilities")
+	TObjectPtr<UCharacterAbilitySet> AbilitySet;
+
+	// Everything AddCharacterAbilities/AddStartupEffects gave, so removing them doesn't scan the ASC
+	FCharacterAbilitySetHandles GrantedHandles;
+
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Character|Attribute")
+	float HealthRegenRate = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Character|Attribute")
+	float ManaRegenRate = 0.0f;
+
 	/// <summary>
 	/// Adds abilities to the character
 	/// </summary>
@@ -100,6 +258,25 @@ protected:
 	/// </summary>
 	virtual void InitializeAttributes();
 
+	// Row group in the attribute curve tables (UCharacterAttributeInitSubsystem), the class name (Enemy_BP_C) when not set
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Character|Attribute")
+	FName AttributeInitGroup;
+
+	FName GetAttributeInitGroup() const;
+
+	// What InitializeAttributes last applied, so repeated calls for the same ASC, effect and level do nothing
+	TWeakObjectPtr<UAbilitySystemComponent> InitializedAttributesASC;
+	TSubclassOf<class UGameplayEffect> InitializedAttributesEffect;
+	int32 InitializedAttributesLevel = INDEX_NONE;
+
+	// DefaultAttributes, or the AbilitySet's when it isn't set
+	TSubclassOf<class UGameplayEffect> GetDefaultAttributesEffect() const;
+
+	/// <summary>
+	/// Lets the UCharacterTickSubsystem pick up the ASC and attribute set once they are assigned
+	/// </summary>
+	void OnAbilitySystemInitialized();
+
 	/// <summary>
 	/// Adds any startup effects
 	/// </summary>
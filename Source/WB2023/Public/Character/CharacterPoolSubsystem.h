@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CharacterPoolSubsystem.generated.h"
+
+class ACharBase;
+
+USTRUCT()
+struct FCharacterPool
+{
+	GENERATED_BODY()
+
+	// Deactivated characters ready to be acquired
+	UPROPERTY()
+	TArray<TObjectPtr<ACharBase>> Available;
+
+	int32 NumInUse = 0;
+
+	// Most characters of this class that were in use at once
+	int32 HighWaterMark = 0;
+
+	int32 NumSpawned = 0;
+	int32 NumReused = 0;
+};
+
+/**
+ * Pools ACharBase subclasses per class. Dead characters are deactivated and reset instead of destroyed,
+ * and spawners acquire them back instead of paying for a fresh actor, capsule, mesh and movement component.
+ */
+UCLASS()
+class WB2023_API UCharacterPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/// <summary>
+	/// Returns a pooled character of CharacterClass moved to SpawnTransform, or spawns one if the pool is empty.
+	/// Reused characters that auto possess on spawn get a new AI controller
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category = "WB2023|CharacterPool", meta = (DeterminesOutputType = "CharacterClass"))
+	ACharBase* AcquireCharacter(TSubclassOf<ACharBase> CharacterClass, const FTransform& SpawnTransform);
+
+	/// <summary>
+	/// Deactivates and resets the character and puts it back in its class' pool
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category = "WB2023|CharacterPool")
+	void ReleaseCharacter(ACharBase* Character);
+
+	/// <summary>
+	/// Spawns deactivated characters until the pool holds at least Count of them
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category = "WB2023|CharacterPool")
+	void Prewarm(TSubclassOf<ACharBase> CharacterClass, int32 Count);
+
+	const FCharacterPool* FindPool(TSubclassOf<ACharBase> CharacterClass) const;
+
+	void LogStats() const;
+
+	// Times Count spawn/destroy pairs against Count acquire/release pairs and logs both
+	void RunSpawnBenchmark(TSubclassOf<ACharBase> CharacterClass, int32 Count);
+
+	virtual void Deinitialize() override;
+
+private:
+	ACharBase* SpawnCharacter(TSubclassOf<ACharBase> CharacterClass, const FTransform& SpawnTransform);
+
+	UPROPERTY()
+	TMap<TObjectPtr<UClass>, FCharacterPool> Pools;
+};
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("WB2023 Animation Budget"), STATGROUP_WB2023AnimBudget, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Character Significance Update"), STAT_CharacterSignificanceUpdate, STATGROUP_WB2023AnimBudget, WB2023_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Critical Characters"), STAT_CriticalSignificanceCharacters, STATGROUP_WB2023AnimBudget, WB2023_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("High Characters"), STAT_HighSignificanceCharacters, STATGROUP_WB2023AnimBudget, WB2023_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Medium Characters"), STAT_MediumSignificanceCharacters, STATGROUP_WB2023AnimBudget, WB2023_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Low Characters"), STAT_LowSignificanceCharacters, STATGROUP_WB2023AnimBudget, WB2023_API);
+// A count worked out from the Low/Medium tick intervals, not a measured time, read 'stat anim' for the time spent
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Mesh Ticks Skipped Per Frame (from tick intervals)"), STAT_MeshTicksSkippedByInterval, STATGROUP_WB2023AnimBudget, WB2023_API);
+
+/**
+ * How much animation work a character gets, from its score in the significance manager
+ */
+enum class ECharacterSignificance : uint8
+{
+	// Montage only evaluation at a low tick rate
+	Low,
+	// Pose only ticks while rendered, at a reduced tick rate
+	Medium,
+	// Full rate
+	High,
+	// Full rate no matter the score, controlled by the local player or playing a montage
+	Critical
+};
+
+namespace CharacterSignificance
+{
+	// Tag ACharBase registers with in the significance manager
+	WB2023_API extern const FName Tag;
+
+	// Scores at or above these map to the matching bucket
+	constexpr float CriticalSignificance = 100.0f;
+	constexpr float HighSignificance = 0.5f;
+	constexpr float MediumSignificance = 0.15f;
+
+	WB2023_API ECharacterSignificance GetBucket(float Significance);
+
+	// Runs the significance manager for the given viewpoints, called once per frame by the first local player
+	WB2023_API void Update(UWorld* World, TArrayView<const FTransform> Viewpoints, float DeltaSeconds);
+}
@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "CharacterSpatialHashSubsystem.generated.h"
+
+class ACharBase;
+
+/**
+ * Uniform 2D grid of the live ACharBase characters, for AI target selection and ability queries that would otherwise
+ * walk every actor. Locations are refreshed once per frame and a character only changes buckets when it leaves its
+ * cell. Characters count as alive from IsAlive() and the State.Dead tag, and Die() takes them out right away.
+ * Enemies are characters on the other side of player control.
+ */
+UCLASS(Config = Game)
+class WB2023_API UCharacterSpatialHashSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual void Deinitialize() override;
+
+	void RegisterCharacter(ACharBase* Character);
+	void UnregisterCharacter(ACharBase* Character);
+
+	// Called from ACharBase::Die so queries skip the character before the next refresh
+	void MarkDead(ACharBase* Character);
+
+	/// <summary>
+	/// Closest alive enemy of Querier within MaxRadius, or null. Only looks at the cells within MaxRadius
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category = "WB2023|SpatialHash")
+	ACharBase* FindNearestEnemy(const ACharBase* Querier, float MaxRadius = 5000.0f) const;
+
+	/// <summary>
+	/// Alive enemies of Querier within Radius of Center
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category = "WB2023|SpatialHash")
+	void FindEnemiesInRadius(const ACharBase* Querier, const FVector& Center, float Radius, TArray<ACharBase*>& OutEnemies) const;
+
+	/// <summary>
+	/// Every character within Radius of Center, dead ones only when bIncludeDead
+	/// </summary>
+	UFUNCTION(BlueprintCallable, Category = "WB2023|SpatialHash")
+	void FindCharactersInRadius(const FVector& Center, float Radius, TArray<ACharBase*>& OutCharacters, bool bIncludeDead = false) const;
+
+	int32 GetNumCharacters() const { return Entries.Num(); }
+
+	// Times a nearest character query from every character against the same query over every ACharBase actor,
+	// with 100 and then 1000 characters of CharacterClass
+	void RunBenchmark(TSubclassOf<ACharBase> CharacterClass);
+
+	UPROPERTY(Config)
+	float CellSize = 1000.0f;
+
+private:
+	struct FCharacterEntry
+	{
+		ACharBase* Character = nullptr;
+		FVector Location = FVector::ZeroVector;
+		FIntPoint Cell = FIntPoint::ZeroValue;
+		bool bAlive = false;
+		bool bPlayerControlled = false;
+	};
+
+	void RefreshEntry(int32 Index);
+
+	FIntPoint GetCell(const FVector& Location) const;
+	void AddToCell(const FIntPoint& Cell, int32 Index);
+	void RemoveFromCell(const FIntPoint& Cell, int32 Index);
+
+	// Calls Function(Entry) for every entry in the cells overlapping the circle, Function checks the distance
+	template<typename FunctionType>
+	void ForEachEntryInCells(const FVector& Center, float Radius, FunctionType Function) const;
+
+	// Searches rings of cells outwards and stops once no closer entry can be in the next ring
+	template<typename PredicateType>
+	ACharBase* FindNearest(const FVector& Location, float MaxRadius, PredicateType Predicate) const;
+
+	TArray<FCharacterEntry> Entries;
+
+	// Indices into Entries
+	TMap<FIntPoint, TArray<int32, TInlineAllocator<8>>> Cells;
+};
@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "GameplayAbilitySpec.h"
+#include "CharacterTickSubsystem.generated.h"
+
+class ACharBase;
+class UCharacterAbilitySystemComponent;
+class UCharacterAttributeSetBase;
+class AWB2023PlayerState;
+
+/**
+ * Runs the per frame character work (death checks, regen, cooldown UI) for every ACharBase in one loop,
+ * so characters don't need their own tick functions.
+ */
+UCLASS()
+class WB2023_API UCharacterTickSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterCharacter(ACharBase* Character);
+	void UnregisterCharacter(ACharBase* Character);
+
+	// Refreshes the cached ASC, attributes and regen rates, call once the character's ability system is initialized
+	void RefreshCharacter(ACharBase* Character);
+
+	int32 GetNumCharacters() const { return Entries.Num(); }
+
+	// Regen is accumulated and applied at this interval to avoid dirtying Health/Mana every frame
+	static constexpr float RegenInterval = 0.25f;
+
+	// How often a character's cooldowns are pushed to its AWB2023PlayerState::OnAbilityCooldownChanged
+	static constexpr float CooldownRefreshInterval = 0.1f;
+
+private:
+	// Everything the loop needs, packed so it doesn't have to chase pointers into the character
+	struct FCharacterTickEntry
+	{
+		ACharBase* Character = nullptr;
+		TWeakObjectPtr<UCharacterAbilitySystemComponent> AbilitySystemComponent;
+		TWeakObjectPtr<UCharacterAttributeSetBase> AttributeSet;
+		float HealthRegenRate = 0.0f;
+		float ManaRegenRate = 0.0f;
+		float RegenAccumulator = 0.0f;
+		bool bHasAuthority = false;
+
+		// Set for characters with a player state (players and AI with bWantsPlayerState), UI shows their cooldowns
+		TWeakObjectPtr<AWB2023PlayerState> CooldownPlayerState;
+		float CooldownAccumulator = 0.0f;
+		// Abilities that were cooling down at the last refresh
+		TArray<FGameplayAbilitySpecHandle> ActiveCooldowns;
+	};
+
+	void TickEntry(FCharacterTickEntry& Entry, float DeltaTime);
+	void RefreshCooldowns(FCharacterTickEntry& Entry, float DeltaTime);
+
+	TArray<FCharacterTickEntry> Entries;
+
+	// Characters unregistered mid loop are cleared and compacted after it
+	bool bTicking = false;
+	bool bNeedsCompaction = false;
+};
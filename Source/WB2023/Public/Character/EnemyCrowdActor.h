@@ -0,0 +1,154 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "EnemyCrowdActor.generated.h"
+
+class ACharBase;
+class UInstancedStaticMeshComponent;
+class UStaticMesh;
+
+/**
+ * One kind of crowd enemy: what it looks like while it's an instance and what it turns into in combat range
+ */
+USTRUCT(BlueprintType)
+struct FEnemyCrowdType
+{
+	GENERATED_BODY()
+
+	// Acquired from the UCharacterPoolSubsystem when an agent of this type is promoted
+	UPROPERTY(EditAnywhere, Category = "Crowd")
+	TSubclassOf<ACharBase> CharacterClass;
+
+	// Drawn as an instance while the agent is in the crowd, pivot at the feet.
+	// Vertex animated materials read their animation time offset from per instance custom data 0
+	UPROPERTY(EditAnywhere, Category = "Crowd")
+	TObjectPtr<UStaticMesh> Mesh;
+
+	UPROPERTY(EditAnywhere, Category = "Crowd")
+	float MoveSpeed = 200.0f;
+
+	// Agents wander this far around where they were spawned
+	UPROPERTY(EditAnywhere, Category = "Crowd")
+	float WanderRadius = 1500.0f;
+
+	// Agents of this type spawned around the crowd actor on BeginPlay
+	UPROPERTY(EditAnywhere, Category = "Crowd")
+	int32 InitialCount = 0;
+};
+
+struct FEnemyCrowdAgentArray;
+
+/**
+ * A crowd agent as it replicates. Agents walk straight legs at their type's MoveSpeed, so only a new leg
+ * has to be sent and clients work the location out from the leg and the server time
+ */
+USTRUCT()
+struct FEnemyCrowdAgent : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector_NetQuantize LegStart = FVector::ZeroVector;
+
+	UPROPERTY()
+	FVector_NetQuantize LegEnd = FVector::ZeroVector;
+
+	// Server world time the leg started at
+	UPROPERTY()
+	float LegStartTime = 0.0f;
+
+	// Index into AEnemyCrowdActor::CrowdTypes
+	UPROPERTY()
+	uint8 TypeIndex = 0;
+
+	// Server only, where the agent wanders around
+	FVector Home = FVector::ZeroVector;
+
+	FVector GetLocation(float ServerTime, float MoveSpeed) const;
+
+	// Server time the agent reaches LegEnd
+	float GetLegEndTime(float MoveSpeed) const;
+};
+
+USTRUCT()
+struct FEnemyCrowdAgentArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FEnemyCrowdAgent> Items;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FEnemyCrowdAgent, FEnemyCrowdAgentArray>(Items, DeltaParms, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FEnemyCrowdAgentArray> : public TStructOpsTypeTraitsBase2<FEnemyCrowdAgentArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true
+	};
+};
+
+/**
+ * The enemy crowd of a level: enemies too far from every player to need an ACharBase, drawn with one instanced
+ * static mesh per type. UEnemyCrowdSubsystem moves them and swaps them with pooled characters in combat range.
+ * Place one per level and fill in CrowdTypes.
+ */
+UCLASS()
+class WB2023_API AEnemyCrowdActor : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AEnemyCrowdActor();
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	UPROPERTY(EditAnywhere, Category = "Crowd")
+	TArray<FEnemyCrowdType> CrowdTypes;
+
+	// InitialCount agents are spawned this far around the actor
+	UPROPERTY(EditAnywhere, Category = "Crowd")
+	float InitialSpawnRadius = 10000.0f;
+
+	const FEnemyCrowdType* FindCrowdType(uint8 TypeIndex) const { return CrowdTypes.IsValidIndex(TypeIndex) ? &CrowdTypes[TypeIndex] : nullptr; }
+
+	FEnemyCrowdAgentArray& GetAgents() { return Agents; }
+	const FEnemyCrowdAgentArray& GetAgents() const { return Agents; }
+
+	// Call after changing an agent's leg or adding it
+	void MarkAgentDirty(FEnemyCrowdAgent& Agent);
+
+	// Call after removing agents
+	void MarkAgentsRemoved();
+
+	/// <summary>
+	/// Moves the instances to the agents' locations, Locations is in the same order as the agent items.
+	/// Instances are rebuilt when agents were added or removed
+	/// </summary>
+	void UpdateInstances(TArrayView<const FVector> Locations);
+
+protected:
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY(Replicated)
+	FEnemyCrowdAgentArray Agents;
+
+	// One per crowd type, not created on dedicated servers
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UInstancedStaticMeshComponent>> InstanceComponents;
+
+private:
+	// Per type instance transforms, kept to avoid reallocating every frame
+	TArray<TArray<FTransform>> InstanceTransforms;
+};
@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "EnemyCrowdSubsystem.generated.h"
+
+class ACharBase;
+class AEnemyCrowdActor;
+struct FEnemyCrowdAgent;
+struct FEnemyCrowdType;
+
+/**
+ * Runs the AEnemyCrowdActor of the world. Every frame the agent locations are worked out in one parallel pass and
+ * pushed to the instances. On the server, agents that come within PromotionRadius of a player are swapped for a
+ * pooled ACharBase with its AI controller and ASC, and promoted characters out of combat and farther than
+ * DemotionRadius from every player go back to the pool and into the crowd.
+ */
+UCLASS(Config = Game)
+class WB2023_API UEnemyCrowdSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+	virtual void Deinitialize() override;
+
+	void RegisterCrowd(AEnemyCrowdActor* CrowdActor);
+	void UnregisterCrowd(AEnemyCrowdActor* CrowdActor);
+
+	/// <summary>
+	/// Server only. Adds Count agents of the crowd type at random points within Radius of Center
+	/// </summary>
+	void SpawnAgents(int32 TypeIndex, const FVector& Center, float Radius, int32 Count);
+
+	int32 GetNumAgents() const { return Locations.Num(); }
+	int32 GetNumPromoted() const { return Promoted.Num(); }
+
+	void LogStats() const;
+
+	// Records frame times for Seconds, then logs them and appends them to Saved/Benchmarks/CrowdLoad.csv
+	void StartBenchmark(float Seconds);
+
+	// Agents this close to a player become characters
+	UPROPERTY(Config)
+	float PromotionRadius = 3000.0f;
+
+	// Promoted characters go back into the crowd once every player is farther than this.
+	// Larger than PromotionRadius so characters at the edge don't flip back and forth
+	UPROPERTY(Config)
+	float DemotionRadius = 4500.0f;
+
+	// Promoted characters that dealt or took damage this recently stay characters
+	UPROPERTY(Config)
+	float CombatWindow = 5.0f;
+
+	// How often the server starts new legs and checks for promotion and demotion
+	UPROPERTY(Config)
+	float ServerUpdateInterval = 0.2f;
+
+	// Spreads pool acquires over several updates when a player runs into a large group
+	UPROPERTY(Config)
+	int32 MaxPromotionsPerUpdate = 8;
+
+	// Agents wait this long at the end of a leg before starting the next one
+	UPROPERTY(Config)
+	float IdleTime = 2.0f;
+
+private:
+	void UpdateLocations(const AEnemyCrowdActor& CrowdActor, float ServerTime);
+	void UpdateServer(AEnemyCrowdActor& CrowdActor, float ServerTime);
+	void GatherPlayerLocations();
+	bool IsNearPlayer(const FVector& Location, float RadiusSquared) const;
+
+	void AddAgent(AEnemyCrowdActor& CrowdActor, int32 TypeIndex, const FVector& Location, const FVector& Home, float ServerTime);
+	void StartLeg(FEnemyCrowdAgent& Agent, const FVector& Location, const FEnemyCrowdType& CrowdType, float ServerTime) const;
+	bool PromoteAgent(const AEnemyCrowdActor& CrowdActor, const FEnemyCrowdAgent& Agent, const FVector& Location);
+	void DemoteCharacters(AEnemyCrowdActor& CrowdActor, float ServerTime);
+
+	float GetServerTime() const;
+
+	void TickBenchmark(float DeltaTime, double CrowdSeconds);
+
+	TWeakObjectPtr<AEnemyCrowdActor> Crowd;
+
+	// Location of every agent this frame, in the same order as the crowd's agent items
+	TArray<FVector> Locations;
+
+	TArray<FVector> PlayerLocations;
+
+	struct FPromotedAgent
+	{
+		TWeakObjectPtr<ACharBase> Character;
+		FVector Home = FVector::ZeroVector;
+		int32 TypeIndex = 0;
+	};
+
+	TArray<FPromotedAgent> Promoted;
+
+	float ServerUpdateAccumulator = 0.0f;
+
+	struct FBenchmarkState
+	{
+		float TimeLeft = 0.0f;
+		TArray<float> FrameMs;
+		TArray<float> GameThreadMs;
+		double CrowdSeconds = 0.0;
+	};
+
+	FBenchmarkState Benchmark;
+};
@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/EngineSubsystem.h"
+#include "MetricsExporterSubsystem.generated.h"
+
+class FRunnable;
+class FRunnableThread;
+
+/**
+ * Writes the WB2023 metrics to a file in the Prometheus text exposition format from a background thread.
+ * On by default on dedicated servers, elsewhere with -WB2023Metrics. Point a node exporter textfile collector
+ * (or anything that tails the file) at OutputFile.
+ */
+UCLASS(Config = Engine)
+class WB2023_API UMetricsExporterSubsystem : public UEngineSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	UPROPERTY(Config)
+	bool bEnableOnDedicatedServer = true;
+
+	UPROPERTY(Config)
+	float FlushIntervalSeconds = 10.0f;
+
+	// Relative to the project's Saved directory
+	UPROPERTY(Config)
+	FString OutputFile = TEXT("Metrics/wb2023.prom");
+
+private:
+	FRunnable* FlushRunnable = nullptr;
+	FRunnableThread* FlushThread = nullptr;
+};
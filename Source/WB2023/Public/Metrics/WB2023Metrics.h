@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+/**
+ * Process wide metric. Metrics are globals that link themselves into the registry when constructed,
+ * recording is a relaxed atomic add so any thread can record without locking.
+ */
+class WB2023_API FWB2023Metric
+{
+public:
+	FWB2023Metric(const TCHAR* InName, const TCHAR* InHelp);
+	virtual ~FWB2023Metric() = default;
+
+	// Appends the metric in the Prometheus text exposition format
+	virtual void Write(FString& Out) const = 0;
+
+	const TCHAR* GetName() const { return Name; }
+	const FWB2023Metric* GetNext() const { return Next; }
+
+	static const FWB2023Metric* GetFirst();
+
+	// Every registered metric in the text exposition format
+	static FString WriteAll();
+
+protected:
+	void WriteHeader(FString& Out, const TCHAR* Type) const;
+
+	const TCHAR* Name;
+	const TCHAR* Help;
+
+private:
+	FWB2023Metric* Next = nullptr;
+};
+
+class WB2023_API FWB2023MetricCounter : public FWB2023Metric
+{
+public:
+	using FWB2023Metric::FWB2023Metric;
+
+	void Add(int64 Amount = 1) { Value.fetch_add(Amount, std::memory_order_relaxed); }
+
+	virtual void Write(FString& Out) const override;
+
+private:
+	std::atomic<int64> Value{ 0 };
+};
+
+class WB2023_API FWB2023MetricGauge : public FWB2023Metric
+{
+public:
+	using FWB2023Metric::FWB2023Metric;
+
+	void Add(int64 Amount) { Value.fetch_add(Amount, std::memory_order_relaxed); }
+	void Set(int64 NewValue) { Value.store(NewValue, std::memory_order_relaxed); }
+
+	virtual void Write(FString& Out) const override;
+
+private:
+	std::atomic<int64> Value{ 0 };
+};
+
+class WB2023_API FWB2023MetricHistogram : public FWB2023Metric
+{
+public:
+	static constexpr int32 MaxBuckets = 16;
+
+	// UpperBounds must be ascending, at most MaxBuckets of them. Values above the last bound go to +Inf
+	FWB2023MetricHistogram(const TCHAR* InName, const TCHAR* InHelp, std::initializer_list<double> UpperBounds);
+
+	void Observe(double Value);
+
+	virtual void Write(FString& Out) const override;
+
+private:
+	double Bounds[MaxBuckets] = {};
+	int32 NumBounds = 0;
+
+	// Per bucket, not cumulative. The last slot is +Inf
+	std::atomic<uint64> BucketCounts[MaxBuckets + 1] = {};
+	std::atomic<uint64> Count{ 0 };
+
+	// Sum in thousandths so it can be added atomically
+	std::atomic<int64> SumMilli{ 0 };
+};
+
+namespace WB2023Metrics
+{
+	extern WB2023_API FWB2023MetricCounter AbilitiesActivated;
+	extern WB2023_API FWB2023MetricCounter AbilitiesCanceled;
+	extern WB2023_API FWB2023MetricCounter EffectsApplied;
+	extern WB2023_API FWB2023MetricCounter DamageEvents;
+	extern WB2023_API FWB2023MetricHistogram DamageTaken;
+	extern WB2023_API FWB2023MetricCounter Deaths;
+	extern WB2023_API FWB2023MetricGauge PlayerStates;
+	extern WB2023_API FWB2023MetricCounter PlayerStateForcedNetUpdates;
+	extern WB2023_API FWB2023MetricGauge CrowdAgents;
+	extern WB2023_API FWB2023MetricCounter CrowdPromotions;
+	extern WB2023_API FWB2023MetricCounter CrowdDemotions;
+	extern WB2023_API FWB2023MetricCounter PathQueries;
+	extern WB2023_API FWB2023MetricCounter PathsShared;
+	extern WB2023_API FWB2023MetricCounter KitPreloads;
+	extern WB2023_API FWB2023MetricHistogram KitPreloadTime;
+}
@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ReplicationSoakTestSubsystem.generated.h"
+
+class UNetConnection;
+
+/**
+ * Replication soak test, only created when the process is started with -WB2023Soak (server) or -WB2023SoakBot (client).
+ *
+ * Server: UnrealEditor WB2023.uproject /Game/Map?listen -server -nullrhi -WB2023Soak [-SoakClients=8] [-SoakDuration=120]
+ *         [-SoakLag=100] [-SoakLoss=1] [-SoakCrowd=1000] [-trace=net -NetTrace=1]
+ * Launches SoakClients headless bot clients over loopback, applies the network emulation to server and clients, samples
+ * the bytes sent to every connection each second and writes Saved/Benchmarks/ReplicationSoak.csv. The process exits with
+ * code 1 when a connection goes over the bandwidth thresholds or the clients don't all join within ConnectTimeoutSeconds.
+ * Per class and per property breakdowns come from the net trace (-trace=net -NetTrace=1) in Networking Insights.
+ * -SoakCrowd=1000 spawns that many UEnemyCrowdSubsystem agents once every client joined, and server and bots record
+ * their frame times to Saved/Benchmarks/CrowdLoad.csv over the measured time. The level needs an AEnemyCrowdActor.
+ *
+ * Client: -WB2023SoakBot makes the local player wander and activate its abilities.
+ */
+UCLASS(Config = Engine)
+class WB2023_API UReplicationSoakTestSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	// Fails the run when a connection averages more than this many bytes per second
+	UPROPERTY(Config)
+	int32 MaxAverageBytesPerConnection = 16000;
+
+	// Fails the run when a connection peaks above this many bytes per second
+	UPROPERTY(Config)
+	int32 MaxPeakBytesPerConnection = 48000;
+
+	// Samples taken before every client has joined and this long after are not counted
+	UPROPERTY(Config)
+	float WarmupSeconds = 10.0f;
+
+	// Fails the run when not every client has joined after this long
+	UPROPERTY(Config)
+	float ConnectTimeoutSeconds = 120.0f;
+
+private:
+	struct FConnectionSamples
+	{
+		FString Name;
+		int64 TotalBytes = 0;
+		int32 PeakBytesPerSecond = 0;
+		int32 NumSamples = 0;
+	};
+
+	void LaunchClients();
+	void SampleConnections();
+	void FinishSoak();
+	void FailSoak(const FString& Reason);
+	void TickBot(float DeltaTime);
+
+	bool bServer = false;
+	bool bFinished = false;
+
+	int32 NumClients = 0;
+	float Duration = 120.0f;
+	int32 LagMs = 0;
+	int32 LossPercent = 0;
+	int32 NumCrowdAgents = 0;
+
+	bool bCrowdSpawned = false;
+	bool bCrowdBenchmarkStarted = false;
+
+	// Bots start their crowd benchmark this long after joining, counting down
+	float BotCrowdBenchmarkDelay = 0.0f;
+
+	// Set once every client joined
+	bool bStarted = false;
+	float ConnectSeconds = 0.0f;
+
+	// Time since every client joined, negative during the warmup
+	float MeasuredSeconds = 0.0f;
+	float SampleAccumulator = 0.0f;
+
+	TMap<TWeakObjectPtr<UNetConnection>, FConnectionSamples> ConnectionSamples;
+	TArray<FProcHandle> ClientProcesses;
+
+	// Bot state
+	FVector BotMoveDirection = FVector::ForwardVector;
+	float BotMoveTimeLeft = 0.0f;
+	float BotAbilityTimeLeft = 0.0f;
+};
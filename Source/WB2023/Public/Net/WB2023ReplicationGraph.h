@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BasicReplicationGraph.h"
+#include "WB2023ReplicationGraph.generated.h"
+
+class ACharBase;
+class UReplicationGraphNode_PlayerStateFrequencyLimiter;
+
+/**
+ * Replication graph for WB2023.
+ * ACharBase pawns live in the spatial grid and are culled by distance instead of being always relevant.
+ * Each connection gets its own always relevant node that carries its controller, pawn and owning AWB2023PlayerState,
+ * every other PlayerState goes through the frequency limiter.
+ */
+UCLASS(Transient, Config = Engine)
+class WB2023_API UWB2023ReplicationGraph : public UBasicReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+
+	const FActorRepListRefView& GetCharacterList() const { return CharacterList; }
+
+	// Converts an actor's NetUpdateFrequency into a replication period for the graph
+	uint32 GetPeriodFrameForFrequency(float Frequency) const { return GetReplicationPeriodFrameForFrequency(Frequency); }
+
+	// Spawns 16, 64 and 128 characters of CharacterClass in turn and logs replication CPU time and bytes sent for each count
+	void StartBenchmark(TSubclassOf<ACharBase> CharacterClass);
+
+	// Size of a grid cell
+	UPROPERTY(Config)
+	float CellSize = 10000.0f;
+
+	// Characters farther than this from every viewer of a connection are not replicated to it
+	UPROPERTY(Config)
+	float CharacterCullDistance = 15000.0f;
+
+	// Characters farther than this from every viewer of a connection replicate at DistantCharacterReplicationPeriodFrame
+	UPROPERTY(Config)
+	float DistantCharacterDistance = 5000.0f;
+
+	// Replicate distant characters only every Nth replication frame
+	UPROPERTY(Config)
+	int32 DistantCharacterReplicationPeriodFrame = 6;
+
+	// Replication period of nearby characters, derived from ACharBase's NetUpdateFrequency
+	uint32 CharacterReplicationPeriodFrame = 1;
+
+protected:
+	UPROPERTY()
+	TObjectPtr<UReplicationGraphNode_PlayerStateFrequencyLimiter> PlayerStateNode;
+
+	// Every replicated ACharBase, used to adjust per connection replication rates
+	FActorRepListRefView CharacterList;
+
+private:
+	void TickBenchmark(double ReplicateSeconds, uint32 BytesSent);
+	void DestroyBenchmarkCharacters();
+
+	struct FBenchmarkState
+	{
+		TSubclassOf<ACharBase> CharacterClass;
+		TArray<TWeakObjectPtr<ACharBase>> Characters;
+		int32 StepIndex = INDEX_NONE;
+		int32 FramesInStep = 0;
+		double ReplicateSeconds = 0.0;
+		uint64 BytesSent = 0;
+	};
+
+	FBenchmarkState Benchmark;
+};
+
+/**
+ * Always relevant node for a single connection.
+ * Adds the connection's own PlayerState on top of its controller and view target, at the rate its adaptive
+ * NetUpdateFrequency asks for, and lowers the replication rate of characters that are far from every viewer of the connection.
+ */
+UCLASS()
+class WB2023_API UWB2023ReplicationGraphNode_AlwaysRelevant_ForConnection : public UReplicationGraphNode_AlwaysRelevant_ForConnection
+{
+	GENERATED_BODY()
+
+public:
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+	// How often, in replication frames, the distance based rates are refreshed
+	static constexpr uint32 CharacterRateUpdatePeriod = 10;
+
+private:
+	void UpdateCharacterReplicationRates(const FConnectionGatherActorListParameters& Params);
+
+	FActorRepListRefView PlayerStateList;
+
+	uint32 NextCharacterRateUpdateFrame = 0;
+};
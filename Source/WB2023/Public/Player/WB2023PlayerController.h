@@ -16,5 +16,8 @@ class WB2023_API AWB2023PlayerController : public APlayerController
 
 protected:
 	virtual void OnPossess(APawn* InPawn) override;
+
+	// Drives the character significance manager from this player's view
+	virtual void PlayerTick(float DeltaTime) override;
 	
 };
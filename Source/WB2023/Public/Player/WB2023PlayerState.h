@@ -8,6 +8,13 @@
 #include "GameplayEffectTypes.h"
 #include "WB2023PlayerState.generated.h"
 
+struct FGameplayEffectSpec;
+struct FActiveGameplayEffect;
+struct FCharacterAttributeChange;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FAbilityConfirmCancelTextDelegate, bool, bShowText);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_ThreeParams(FAbilityCooldownChangedDelegate, int32, AbilityInputID, float, TimeRemaining, float, Duration);
+
 /**
  * 
  */
@@ -33,6 +40,15 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "WB2023|WB2023PlayerState|UI")
 	void ShowAbilityConfirmCancelText(bool ShowText);
 
+	// Bound by the HUD, broadcast while an ability waits for confirm/cancel input (AoE placement)
+	UPROPERTY(BlueprintAssignable, Category = "WB2023|WB2023PlayerState|UI")
+	FAbilityConfirmCancelTextDelegate OnShowAbilityConfirmCancelText;
+
+	// Bound by the HUD, broadcast by the UCharacterTickSubsystem while an ability of this player state's character cools
+	// down and once with TimeRemaining 0 when it's ready again. AbilityInputID is the ability's CharAbilityID
+	UPROPERTY(BlueprintAssignable, Category = "WB2023|WB2023PlayerState|UI")
+	FAbilityCooldownChangedDelegate OnAbilityCooldownChanged;
+
 	UFUNCTION(BlueprintCallable, Category = "WB2023|WB2023PlayerState|Attributes")
 	float GetHealth() const;
 
@@ -48,7 +64,46 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "WB2023|WB2023PlayerState|Attributes")
 	int32 GetCharacterLevel() const;
 
+	virtual void Tick(float DeltaSeconds) override;
+
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+
+	/// <summary>
+	/// Raises NetUpdateFrequency back to ActiveNetUpdateFrequency, it decays again once the PlayerState is idle
+	/// </summary>
+	void MarkNetActive();
+
+	/// <summary>
+	/// Marks the PlayerState active and replicates it on the next net update (combat events)
+	/// </summary>
+	void FlushNetUpdate();
+
+	// How many times per second the PlayerState actually replicated, measured over the last second
+	UFUNCTION(BlueprintCallable, Category = "WB2023|WB2023PlayerState|Net")
+	float GetMeasuredNetUpdateRate() const { return MeasuredNetUpdateRate; }
+
+	int32 GetNumForcedNetUpdates() const { return NumForcedNetUpdates; }
+
 protected:
+	// Lower NetUpdateFrequency while nothing is happening on the ASC
+	UPROPERTY(EditDefaultsOnly, Category = "WB2023|Net")
+	bool bAdaptiveNetUpdateFrequency = true;
+
+	UPROPERTY(EditDefaultsOnly, Category = "WB2023|Net", meta = (EditCondition = "bAdaptiveNetUpdateFrequency"))
+	float ActiveNetUpdateFrequency = 100.0f;
+
+	// Floor the frequency decays to while idle
+	UPROPERTY(EditDefaultsOnly, Category = "WB2023|Net", meta = (EditCondition = "bAdaptiveNetUpdateFrequency"))
+	float IdleNetUpdateFrequency = 4.0f;
+
+	// Seconds without activity before the frequency starts to decay
+	UPROPERTY(EditDefaultsOnly, Category = "WB2023|Net", meta = (EditCondition = "bAdaptiveNetUpdateFrequency"))
+	float NetUpdateIdleDelay = 1.0f;
+
+	// Seconds for the frequency to halve once idle
+	UPROPERTY(EditDefaultsOnly, Category = "WB2023|Net", meta = (EditCondition = "bAdaptiveNetUpdateFrequency"))
+	float NetUpdateDecayHalfLife = 0.5f;
+
 	UPROPERTY()
 	class UCharacterAbilitySystemComponent* AbilitySystemComponent;	
 
@@ -57,19 +112,38 @@ protected:
 
 	FGameplayTag DeadTag;	// is dead or alive
 
-	FDelegateHandle HealthChangedDelegateHandle;
-	FDelegateHandle MaxHealthChangedDelegateHandle;
-	FDelegateHandle ManaChangedDelegateHandle;
-	FDelegateHandle MaxManaChangedDelegateHandle;
-	FDelegateHandle CharacterLevelChangedDelegateHandle;
+	// Listener on the ASC's attribute change bus, one call per frame for all attributes below
+	FDelegateHandle AttributesChangedDelegateHandle;
 
 	virtual void BeginPlay() override;
 
-	virtual void HealthChanged(const FOnAttributeChangeData& Data);
-	virtual void MaxHealthChanged(const FOnAttributeChangeData& Data);
-	virtual void ManaChanged(const FOnAttributeChangeData& Data);
-	virtual void MaxManaChanged(const FOnAttributeChangeData& Data);
-	virtual void CharacterLevelChanged(const FOnAttributeChangeData& Data);
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	// Dispatches the frame's coalesced changes to the handlers below
+	void AttributesChanged(const TArray<FCharacterAttributeChange>& Changes);
+
+	virtual void HealthChanged(const FCharacterAttributeChange& Change);
+	virtual void MaxHealthChanged(const FCharacterAttributeChange& Change);
+	virtual void ManaChanged(const FCharacterAttributeChange& Change);
+	virtual void MaxManaChanged(const FCharacterAttributeChange& Change);
+	virtual void CharacterLevelChanged(const FCharacterAttributeChange& Change);
 
 	virtual void StunTagChanged(const FGameplayTag CallbackTag, int32 NewCount);
+
+	// Activity sources for the adaptive net update frequency
+	void OnAnyTagChanged(const FGameplayTag Tag, int32 NewCount);
+	void OnGameplayEffectAppliedToSelf(UAbilitySystemComponent* Source, const FGameplayEffectSpec& Spec, FActiveGameplayEffectHandle Handle);
+	void OnGameplayEffectRemoved(const FActiveGameplayEffect& Effect);
+
+	UFUNCTION()
+	void OnReceivedDamage(class UCharacterAbilitySystemComponent* SourceASC, float UnmitigatedDamage, float MitigatedDamage);
+
+private:
+	float TimeSinceNetActivity = 0.0f;
+
+	// Replication counters for GetMeasuredNetUpdateRate
+	int32 NumReplicationsThisWindow = 0;
+	float ReplicationWindowTime = 0.0f;
+	float MeasuredNetUpdateRate = 0.0f;
+	int32 NumForcedNetUpdates = 0;
 };
@@ -6,8 +6,13 @@
 #include "Engine/AssetManager.h"
 #include "TheAssetManager.generated.h"
 
+class UCharacterAbilitySet;
+struct FStreamableHandle;
+
 /**
- * 
+ * Initializes the ability system globals and async preloads the asset bundles of character kits (UCharacterAbilitySet),
+ * so montages and effects are in memory before the first activation instead of loading on it.
+ * Kits are preloaded when a character is possessed and for the characters placed in a level once it is added to the world.
  */
 UCLASS()
 class WB2023_API UTheAssetManager : public UAssetManager
@@ -15,6 +20,31 @@ class WB2023_API UTheAssetManager : public UAssetManager
 	GENERATED_BODY()
 
 	public:
+	static UTheAssetManager& Get();
+
 	virtual void StartInitialLoading() override;
-	
+
+	/// <summary>
+	/// Starts loading the kit's Montages and Effects bundles, does nothing if they are already loaded or loading
+	/// </summary>
+	void PreloadCharacterKit(const UCharacterAbilitySet* AbilitySet);
+
+	// Logs every kit preload with its progress and load time
+	void LogPreloads() const;
+
+protected:
+	void OnLevelAddedToWorld(ULevel* Level, UWorld* World);
+	void OnPostLoadMap(UWorld* World);
+	void PreloadCharacterKitsInLevel(const ULevel* Level);
+
+	void OnKitPreloaded(FPrimaryAssetId AssetId);
+
+	struct FKitPreload
+	{
+		TSharedPtr<FStreamableHandle> Handle;
+		double StartTime = 0.0;
+		double LoadTime = -1.0;
+	};
+
+	TMap<FPrimaryAssetId, FKitPreload> KitPreloads;
 };
@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NativeGameplayTags.h"
+
+/**
+ * Every gameplay tag the project uses, registered natively when the module loads.
+ * Add new tags here rather than to DefaultGameplayTags.ini, the editor picks them up from this list.
+ * X(Identifier, "Tag.Name", "Dev comment")
+ */
+#define WB2023_GAMEPLAY_TAG_LIST(X) \
+	X(Ability, "Ability", "Root of every ability tag, canceled by stun") \
+	X(Ability_NotCanceledByStun, "Ability.NotCanceledByStun", "Ability keeps running when its owner is stunned") \
+	X(Ability_Skill_Ability1, "Ability.Skill.Ability1", "") \
+	X(Ability_Skill_BaseAttack, "Ability.Skill.BaseAttack", "") \
+	X(Cooldown_Skill_Ability1, "Cooldown.Skill.Ability1", "") \
+	X(Data_Ability1_Damage, "Data.Ability1.Damage", "") \
+	X(Data_Damage, "Data.Damage", "SetByCaller damage added by the DamageExecution") \
+	X(GameplayCue_Debuff_Ablaze, "GameplayCue.Debuff.Ablaze", "") \
+	X(GameplayCue_Debuff_BaseAttack, "GameplayCue.Debuff.BaseAttack", "") \
+	X(GameplayCue_Debuff_Stun, "GameplayCue.Debuff.Stun", "") \
+	X(GameplayCue_Debuff_Thunder, "GameplayCue.Debuff.Thunder", "") \
+	X(State_Buff_Wet, "State.Buff.Wet", "") \
+	X(State_Dead, "State.Dead", "Blocks ability activation") \
+	X(State_Debuff_Stun, "State.Debuff.Stun", "Blocks ability activation and cancels running abilities") \
+	X(State_RemoveOnDeath, "State.RemoveOnDeath", "Effects with this tag are removed when the character dies")
+
+namespace WB2023GameplayTags
+{
+#define WB2023_DECLARE_GAMEPLAY_TAG(Identifier, TagName, Comment) WB2023_API UE_DECLARE_GAMEPLAY_TAG_EXTERN(Identifier);
+	WB2023_GAMEPLAY_TAG_LIST(WB2023_DECLARE_GAMEPLAY_TAG)
+#undef WB2023_DECLARE_GAMEPLAY_TAG
+
+	// Abilities canceled when the owner is stunned
+	WB2023_API const FGameplayTagContainer& GetStunCancelTags();
+
+	// Abilities that keep running through a stun
+	WB2023_API const FGameplayTagContainer& GetStunIgnoreTags();
+}
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Trace/Trace.h"
+
+class AActor;
+class UGameplayAbility;
+struct FGameplayEffectSpec;
+
+/**
+ * Gameplay events for Unreal Insights. Enable with -trace=default,WB2023Gameplay
+ */
+UE_TRACE_CHANNEL_EXTERN(WB2023GameplayChannel, WB2023_API);
+
+#if UE_TRACE_ENABLED
+namespace WB2023Trace
+{
+	WB2023_API void OutputAbilityActivated(const AActor* Owner, const UGameplayAbility* Ability);
+	WB2023_API void OutputEffectApplied(const AActor* Target, const FGameplayEffectSpec& Spec);
+	WB2023_API void OutputDied(const AActor* Character);
+}
+
+#define WB2023_TRACE_ABILITY_ACTIVATED(Owner, Ability) WB2023Trace::OutputAbilityActivated(Owner, Ability)
+#define WB2023_TRACE_EFFECT_APPLIED(Target, Spec) WB2023Trace::OutputEffectApplied(Target, Spec)
+#define WB2023_TRACE_DIED(Character) WB2023Trace::OutputDied(Character)
+#else
+#define WB2023_TRACE_ABILITY_ACTIVATED(Owner, Ability)
+#define WB2023_TRACE_EFFECT_APPLIED(Target, Spec)
+#define WB2023_TRACE_DIED(Character)
+#endif
@@ -3,4 +3,24 @@
 #include "WB2023.h"
 #include "Modules/ModuleManager.h"
 
+DEFINE_LOG_CATEGORY(LogWB2023);
+DEFINE_LOG_CATEGORY(LogWB2023Ability);
+DEFINE_LOG_CATEGORY(LogWB2023Attribute);
+DEFINE_LOG_CATEGORY(LogWB2023Input);
+DEFINE_LOG_CATEGORY(LogWB2023Net);
+
+DEFINE_STAT(STAT_WB2023_GrantAbilities);
+DEFINE_STAT(STAT_WB2023_RevokeAbilities);
+DEFINE_STAT(STAT_WB2023_InitializeAttributes);
+DEFINE_STAT(STAT_WB2023_StartupEffects);
+DEFINE_STAT(STAT_WB2023_DamageExecution);
+DEFINE_STAT(STAT_WB2023_Die);
+DEFINE_STAT(STAT_WB2023_InputBinding);
+DEFINE_STAT(STAT_WB2023_PlayerStateCallbacks);
+DEFINE_STAT(STAT_WB2023_CrowdUpdate);
+DEFINE_STAT(STAT_WB2023_PathRequests);
+DEFINE_STAT(STAT_WB2023_SpatialHashUpdate);
+DEFINE_STAT(STAT_WB2023_CrowdAgents);
+DEFINE_STAT(STAT_WB2023_CrowdPromoted);
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, WB2023, "WB2023" );
@@ -3,6 +3,29 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogWB2023, Log, All);
+DECLARE_LOG_CATEGORY_EXTERN(LogWB2023Ability, Log, All);
+DECLARE_LOG_CATEGORY_EXTERN(LogWB2023Attribute, Log, All);
+DECLARE_LOG_CATEGORY_EXTERN(LogWB2023Input, Log, All);
+DECLARE_LOG_CATEGORY_EXTERN(LogWB2023Net, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("WB2023 Gameplay"), STATGROUP_WB2023Gameplay, STATCAT_Advanced);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Grant Abilities"), STAT_WB2023_GrantAbilities, STATGROUP_WB2023Gameplay, WB2023_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Revoke Abilities"), STAT_WB2023_RevokeAbilities, STATGROUP_WB2023Gameplay, WB2023_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Initialize Attributes"), STAT_WB2023_InitializeAttributes, STATGROUP_WB2023Gameplay, WB2023_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Startup Effects"), STAT_WB2023_StartupEffects, STATGROUP_WB2023Gameplay, WB2023_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Damage Execution"), STAT_WB2023_DamageExecution, STATGROUP_WB2023Gameplay, WB2023_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Die"), STAT_WB2023_Die, STATGROUP_WB2023Gameplay, WB2023_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Input Binding"), STAT_WB2023_InputBinding, STATGROUP_WB2023Gameplay, WB2023_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PlayerState Callbacks"), STAT_WB2023_PlayerStateCallbacks, STATGROUP_WB2023Gameplay, WB2023_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Crowd Update"), STAT_WB2023_CrowdUpdate, STATGROUP_WB2023Gameplay, WB2023_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Path Requests"), STAT_WB2023_PathRequests, STATGROUP_WB2023Gameplay, WB2023_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Spatial Hash Update"), STAT_WB2023_SpatialHashUpdate, STATGROUP_WB2023Gameplay, WB2023_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Crowd Agents"), STAT_WB2023_CrowdAgents, STATGROUP_WB2023Gameplay, WB2023_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Crowd Promoted Characters"), STAT_WB2023_CrowdPromoted, STATGROUP_WB2023Gameplay, WB2023_API);
 
 UENUM(BlueprintType)
 enum class CharAbilityID : uint8
@@ -10,5 +33,7 @@ enum class CharAbilityID : uint8
     None UMETA(DisplayName = "None"),
     Confirm UMETA(DisplayName = "Confirm"),
     Cancel UMETA(DisplayName = "Cancel"),
-    Ability1 UMETA(DisplayName = "Ability1")
+    Ability1 UMETA(DisplayName = "Ability1"),
+    // Keep last, input IDs handed out for input bindings start here
+    MAX UMETA(Hidden)
 };